@@ -0,0 +1,397 @@
+/*
+ * Transform micro-benchmark.
+ *
+ * Sweeps frame sizes (powers of two, the sizes used by the analyzers, primes)
+ * and times, in single and double precision:
+ * - the naive DFT (twiddles computed on the fly, as in spectral.c),
+ * - the DFT with a twiddle table,
+ * - FFTW,
+ * both complex to complex (c2c) and real to complex (r2c), and the Goertzel
+ * algorithm on a few bins (r2c).
+ *
+ * Each case is warmed up, then timed over many samples of back to back runs;
+ * the median and 99th percentile times per transform are written as CSV, with
+ * the throughput in GFLOP/s. Transforms count 5 N log2(N) flops for c2c and
+ * half of it for r2c (FFTW's convention, whatever the algorithm, so the numbers
+ * compare speeds); Goertzel counts its actual 3 N flops per bin.
+ */
+
+#include <complex.h>
+#include <fftw3.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fft.h"
+
+#define REPETITIONS 101
+#define SAMPLE_NS 50000. // Minimum duration of a timed sample.
+#define CASE_NS 2e9 // Time budget of a case, the repetitions are reduced past it.
+#define MAX_DFT_SIZE 4096 // The O(N^2) DFTs are skipped past this size.
+#define GOERTZEL_BINS 8
+
+static const int default_sizes[] = { 256, 512, 1024, 2048, 4096, 16384, 65536, 2646, 2867, 8820, 44100, 1021, 4093, 44101 };
+
+typedef void (*kernel)(void* const context);
+
+typedef struct benchmark_case {
+    const char* algorithm;
+    const char* layout;
+    const char* precision;
+    int size;
+    int bins; // Output bins per transform.
+    double flops; // Per transform.
+    kernel run;
+    void* context;
+} benchmark_case;
+
+/*
+ * Kernels, generated for both precisions.
+ */
+
+#define DEFINE_KERNELS(real, suffix, cosine, sine)                                             \
+    typedef struct dft_##suffix {                                                               \
+        int size;                                                                               \
+        real* signal; /* size real samples (r2c). */                                            \
+        real complex* input; /* size complex samples (c2c). */                                  \
+        real complex* output; /* size bins. */                                                  \
+        real complex* twiddles; /* size twiddles. */                                            \
+        int* bins; /* GOERTZEL_BINS bins (Goertzel). */                                         \
+        real* coefficients; /* GOERTZEL_BINS coefficients (Goertzel). */                        \
+    } dft_##suffix;                                                                             \
+                                                                                                \
+    static void naive_c2c_##suffix(void* const context)                                         \
+    {                                                                                           \
+        dft_##suffix* const t = context;                                                        \
+        for (int m = 0; m < t->size; m++) {                                                     \
+            real complex sum = 0;                                                               \
+            for (int n = 0; n < t->size; n++) {                                                 \
+                const real phase = -2 * (real)M_PI * ((long)n * m % t->size) / t->size;         \
+                sum += t->input[n] * (cosine(phase) + sine(phase) * I);                         \
+            }                                                                                   \
+            t->output[m] = sum;                                                                 \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    static void naive_r2c_##suffix(void* const context)                                         \
+    {                                                                                           \
+        dft_##suffix* const t = context;                                                        \
+        for (int m = 0; m < t->size / 2 + 1; m++) {                                             \
+            real complex sum = 0;                                                               \
+            for (int n = 0; n < t->size; n++) {                                                 \
+                const real phase = -2 * (real)M_PI * ((long)n * m % t->size) / t->size;         \
+                sum += t->signal[n] * (cosine(phase) + sine(phase) * I);                        \
+            }                                                                                   \
+            t->output[m] = sum;                                                                 \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    static void table_c2c_##suffix(void* const context)                                         \
+    {                                                                                           \
+        dft_##suffix* const t = context;                                                        \
+        for (int m = 0; m < t->size; m++) {                                                     \
+            real complex sum = 0;                                                               \
+            for (int n = 0, k = 0; n < t->size; n++, k = k + m < t->size ? k + m : k + m - t->size) \
+                sum += t->input[n] * t->twiddles[k];                                            \
+            t->output[m] = sum;                                                                 \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    static void table_r2c_##suffix(void* const context)                                         \
+    {                                                                                           \
+        dft_##suffix* const t = context;                                                        \
+        for (int m = 0; m < t->size / 2 + 1; m++) {                                             \
+            real complex sum = 0;                                                               \
+            for (int n = 0, k = 0; n < t->size; n++, k = k + m < t->size ? k + m : k + m - t->size) \
+                sum += t->signal[n] * t->twiddles[k];                                           \
+            t->output[m] = sum;                                                                 \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    static void goertzel_##suffix(void* const context)                                          \
+    {                                                                                           \
+        dft_##suffix* const t = context;                                                        \
+        for (int bin = 0; bin < GOERTZEL_BINS; bin++) {                                         \
+            const real coefficient = t->coefficients[bin];                                      \
+            real previous = 0, before = 0;                                                      \
+            for (int n = 0; n < t->size; n++) {                                                 \
+                const real current = t->signal[n] + coefficient * previous - before;            \
+                before = previous;                                                              \
+                previous = current;                                                             \
+            }                                                                                   \
+            const real phase = 2 * (real)M_PI * t->bins[bin] / t->size;                         \
+            t->output[bin] = previous - before * (cosine(phase) - sine(phase) * I);             \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    static dft_##suffix* dft_create_##suffix(const int size)                                    \
+    {                                                                                           \
+        dft_##suffix* const t = malloc(sizeof(dft_##suffix));                                   \
+        t->size = size;                                                                         \
+        t->signal = malloc(size * sizeof(real));                                                \
+        t->input = malloc(size * sizeof(real complex));                                         \
+        t->output = malloc(size * sizeof(real complex));                                        \
+        t->twiddles = malloc(size * sizeof(real complex));                                      \
+        t->bins = malloc(GOERTZEL_BINS * sizeof(int));                                          \
+        t->coefficients = malloc(GOERTZEL_BINS * sizeof(real));                                 \
+        for (int n = 0; n < size; n++) {                                                        \
+            t->signal[n] = (real)rand() / RAND_MAX - .5;                                        \
+            t->input[n] = t->signal[n] + ((real)rand() / RAND_MAX - .5) * I;                    \
+            t->twiddles[n] = cexp(-2. * M_PI * I * n / size);                                   \
+        }                                                                                       \
+        for (int bin = 0; bin < GOERTZEL_BINS; bin++) {                                         \
+            t->bins[bin] = (bin + 1) * (size / 2) / (GOERTZEL_BINS + 1);                        \
+            t->coefficients[bin] = 2 * cosine(2 * (real)M_PI * t->bins[bin] / size);            \
+        }                                                                                       \
+        return t;                                                                               \
+    }                                                                                           \
+                                                                                                \
+    static void dft_destroy_##suffix(dft_##suffix* const t)                                     \
+    {                                                                                           \
+        free(t->signal);                                                                        \
+        free(t->input);                                                                         \
+        free(t->output);                                                                        \
+        free(t->twiddles);                                                                      \
+        free(t->bins);                                                                          \
+        free(t->coefficients);                                                                  \
+        free(t);                                                                                \
+    }
+
+DEFINE_KERNELS(double, double, cos, sin)
+DEFINE_KERNELS(float, float, cosf, sinf)
+
+/*
+ * FFTW, through the planner of the analyzers in double precision.
+ */
+
+typedef struct fftw_transform {
+    int size;
+    void* input;
+    void* output;
+    fftw_plan plan; // Double precision.
+    fftwf_plan plan_float; // Single precision.
+} fftw_transform;
+
+static fftw_plan plan_c2c(const unsigned flags, void* const context)
+{
+    fftw_transform* const t = context;
+    return fftw_plan_dft_1d(t->size, t->input, t->output, FFTW_FORWARD, flags);
+}
+
+static fftw_plan plan_r2c(const unsigned flags, void* const context)
+{
+    fftw_transform* const t = context;
+    return fftw_plan_dft_r2c_1d(t->size, t->input, t->output, flags);
+}
+
+static void fftw_run(void* const context)
+{
+    fftw_execute(((fftw_transform*)context)->plan);
+}
+
+static void fftwf_run(void* const context)
+{
+    fftwf_execute(((fftw_transform*)context)->plan_float);
+}
+
+static fftw_transform* fftw_transform_create(const int size, const int real_input, const int single)
+{
+    fftw_transform* const t = malloc(sizeof(fftw_transform));
+    const size_t real_size = single ? sizeof(float) : sizeof(double);
+    t->size = size;
+    t->input = fftw_malloc(size * (real_input ? 1 : 2) * real_size);
+    t->output = fftw_malloc(size * 2 * real_size);
+    t->plan = NULL;
+    t->plan_float = NULL;
+
+    char key[32];
+    snprintf(key, sizeof(key), "%s-%d", real_input ? "r2c" : "c2c", size);
+    // Float plans are not cached, but are made as rigorously as the double ones.
+    if (!single)
+        t->plan = fft_plan(key, real_input ? plan_r2c : plan_c2c, t);
+    else if (real_input)
+        t->plan_float = fftwf_plan_dft_r2c_1d(size, t->input, t->output, fft_planner_flags());
+    else
+        t->plan_float = fftwf_plan_dft_1d(size, t->input, t->output, FFTW_FORWARD, fft_planner_flags());
+
+    // Planning overwrites the buffers.
+    for (int n = 0; n < size * (real_input ? 1 : 2); n++) {
+        const double value = (double)rand() / RAND_MAX - .5;
+        if (single)
+            ((float*)t->input)[n] = value;
+        else
+            ((double*)t->input)[n] = value;
+    }
+    return t;
+}
+
+static void fftw_transform_destroy(fftw_transform* const t)
+{
+    fft_plan_destroy(t->plan);
+    if (t->plan_float != NULL)
+        fftwf_destroy_plan(t->plan_float);
+    fftw_free(t->input);
+    fftw_free(t->output);
+    free(t);
+}
+
+/*
+ * Timing.
+ */
+
+static double now_ns()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static int compare_doubles(const void* const a, const void* const b)
+{
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void measure(FILE* const output, const benchmark_case* const bench, const int repetitions)
+{
+    // Warm up (caches, branch predictors, frequency), and size the samples.
+    double start = now_ns();
+    bench->run(bench->context);
+    double single_ns = now_ns() - start;
+    int warmups = 1;
+    while (warmups < 1000 && now_ns() - start < 1e7)
+        bench->run(bench->context), warmups++;
+    single_ns = (now_ns() - start) / warmups > 1. ? (now_ns() - start) / warmups : 1.;
+
+    const int iterations = single_ns < SAMPLE_NS ? (int)ceil(SAMPLE_NS / single_ns) : 1;
+    int samples = repetitions;
+    if (samples * iterations * single_ns > CASE_NS)
+        samples = fmax(5., CASE_NS / (iterations * single_ns));
+
+    double* const times = malloc(samples * sizeof(double));
+    for (int sample = 0; sample < samples; sample++) {
+        start = now_ns();
+        for (int iteration = 0; iteration < iterations; iteration++)
+            bench->run(bench->context);
+        times[sample] = (now_ns() - start) / iterations;
+    }
+    qsort(times, samples, sizeof(double), compare_doubles);
+
+    const double median = samples % 2 ? times[samples / 2] : (times[samples / 2 - 1] + times[samples / 2]) / 2.;
+    const double p99 = times[(int)ceil(.99 * samples) - 1];
+    fprintf(output, "%s,%s,%s,%d,%d,%d,%.1lf,%.1lf,%.3lf\n", bench->algorithm, bench->layout, bench->precision,
+        bench->size, bench->bins, samples, median, p99, bench->flops / median);
+    fflush(output);
+    free(times);
+}
+
+static double transform_flops(const int size, const int real_input)
+{
+    const double flops = 5. * size * log2(size);
+    return real_input ? flops / 2. : flops;
+}
+
+static void benchmark_size(FILE* const output, const int size, const int repetitions, const int max_dft_size)
+{
+    const int bins = size / 2 + 1;
+
+    for (int single = 0; single < 2; single++) {
+        const char* const precision = single ? "float" : "double";
+
+        for (int real_input = 0; real_input < 2; real_input++) {
+            const char* const layout = real_input ? "r2c" : "c2c";
+            const int transform_bins = real_input ? bins : size;
+            const double flops = transform_flops(size, real_input);
+
+            fftw_transform* const t = fftw_transform_create(size, real_input, single);
+            const benchmark_case fftw_case = { "fftw", layout, precision, size, transform_bins, flops, single ? fftwf_run : fftw_run, t };
+            measure(output, &fftw_case, repetitions);
+            fftw_transform_destroy(t);
+
+            if (size > max_dft_size)
+                continue;
+
+            void* const dft = single ? (void*)dft_create_float(size) : (void*)dft_create_double(size);
+            const benchmark_case naive_case = { "dft", layout, precision, size, transform_bins, flops,
+                single ? (real_input ? naive_r2c_float : naive_c2c_float) : (real_input ? naive_r2c_double : naive_c2c_double), dft };
+            const benchmark_case table_case = { "dft-table", layout, precision, size, transform_bins, flops,
+                single ? (real_input ? table_r2c_float : table_c2c_float) : (real_input ? table_r2c_double : table_c2c_double), dft };
+            measure(output, &naive_case, repetitions);
+            measure(output, &table_case, repetitions);
+            if (single)
+                dft_destroy_float(dft);
+            else
+                dft_destroy_double(dft);
+        }
+
+        // Goertzel is cheap whatever the size, for a few bins.
+        void* const dft = single ? (void*)dft_create_float(size) : (void*)dft_create_double(size);
+        const benchmark_case goertzel_case = { "goertzel", "r2c", precision, size, GOERTZEL_BINS, 3. * size * GOERTZEL_BINS,
+            single ? goertzel_float : goertzel_double, dft };
+        measure(output, &goertzel_case, repetitions);
+        if (single)
+            dft_destroy_float(dft);
+        else
+            dft_destroy_double(dft);
+    }
+}
+
+static void print_usage(const char* const progname)
+{
+    fprintf(stderr, "Usage: %s [-o output.csv] [-r repetitions] [-d max_dft_size] [size…]\n", progname);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    const char* output_name = NULL;
+    int repetitions = REPETITIONS;
+    int max_dft_size = MAX_DFT_SIZE;
+
+    int option;
+    while ((option = getopt(argc, argv, "o:r:d:")) != -1) {
+        switch (option) {
+        case 'o':
+            output_name = optarg;
+            break;
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'd':
+            max_dft_size = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+        }
+    }
+    if (repetitions < 1)
+        print_usage(argv[0]);
+
+    FILE* const output = output_name == NULL ? stdout : fopen(output_name, "w");
+    if (output == NULL) {
+        fprintf(stderr, "Not able to open output file %s.\n", output_name);
+        exit(EXIT_FAILURE);
+    }
+
+    srand(0);
+    fft_planner_init();
+
+    fprintf(output, "algorithm,layout,precision,size,bins,samples,median_ns,p99_ns,gflops\n");
+    if (optind < argc)
+        for (int arg = optind; arg < argc; arg++) {
+            const int size = atoi(argv[arg]);
+            if (size < 2)
+                print_usage(argv[0]);
+            benchmark_size(output, size, repetitions, max_dft_size);
+        }
+    else
+        for (unsigned int i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++)
+            benchmark_size(output, default_sizes[i], repetitions, max_dft_size);
+
+    if (output != stdout)
+        fclose(output);
+    return EXIT_SUCCESS;
+}
@@ -8,13 +8,15 @@
 #include <string.h>
 #include <time.h>
 
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
 
 #define FRAME_SIZE 1024
 #define HOP_SIZE 1024
 
 static gnuplot_ctrl* h;
-static fftw_plan plan;
+static real_fft* transform;
 
 static void print_usage(char* progname)
 {
@@ -22,20 +24,6 @@ static void print_usage(char* progname)
     puts("\n");
 }
 
-static void fill_buffer(double* buffer, double* new_buffer)
-{
-    double tmp[FRAME_SIZE - HOP_SIZE];
-
-    for (int i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
-
-    for (int i = 0; i < (FRAME_SIZE - HOP_SIZE); i++)
-        buffer[i] = tmp[i];
-
-    for (int i = 0; i < HOP_SIZE; i++)
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-}
-
 static int read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
 {
 
@@ -81,22 +69,20 @@ static void dft(const double s[FRAME_SIZE], double complex S[FRAME_SIZE])
 //     }
 // }
 
-static void fft_init(fftw_complex data_in[FRAME_SIZE], fftw_complex data_out[FRAME_SIZE])
+static void fft_init()
 {
-    plan = fftw_plan_dft_1d(FRAME_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    transform = real_fft_create(FRAME_SIZE, REAL_FFT_FORWARD);
 }
 
-static void fft(const double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
+static void fft(const double s[FRAME_SIZE])
 {
-    for (unsigned int i = 0; i < FRAME_SIZE; i++)
-        data_in[i] = s[i];
-
-    fftw_execute(plan);
+    real_fft_load(transform, s, FRAME_SIZE);
+    real_fft_forward(transform);
 }
 
 static void fft_exit()
 {
-    fftw_destroy_plan(plan);
+    real_fft_destroy(transform);
 }
 
 int main(int argc, char** argv)
@@ -123,14 +109,14 @@ int main(int argc, char** argv)
 
     int nb_frames = 0;
     double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
+    frame_assembler* const frames = frame_assembler_create(FRAME_SIZE);
 
     h = gnuplot_init();
     gnuplot_setstyle(h, "lines");
 
     for (int i = 0; i < (FRAME_SIZE / HOP_SIZE - 1); i++) {
         if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
+            frame_assembler_push(frames, new_buffer, HOP_SIZE);
         else {
             printf("not enough samples !!\n");
             return 1;
@@ -144,9 +130,9 @@ int main(int argc, char** argv)
     // For the DFT
     double complex S[FRAME_SIZE];
 
-    // For the FFT
-    fftw_complex data_in[FRAME_SIZE], data_out[FRAME_SIZE];
-    fft_init(data_in, data_out);
+    // For the FFT (FRAME_SIZE / 2 + 1 bins)
+    fft_planner_init();
+    fft_init();
 
     // The results
     // double amp[FRAME_SIZE], phs[FRAME_SIZE];
@@ -157,7 +143,8 @@ int main(int argc, char** argv)
     while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
         printf("Processing frame %d…\n", nb_frames);
 
-        fill_buffer(buffer, new_buffer);
+        frame_assembler_push(frames, new_buffer, HOP_SIZE);
+        const double* const buffer = frame_assembler_get_frame(frames);
 
         // DFT
         dft_single_duration = clock();
@@ -169,11 +156,11 @@ int main(int argc, char** argv)
 
         // FFT
         fft_single_duration = clock();
-        fft(buffer, data_in);
+        fft(buffer);
         fft_single_duration = clock() - fft_single_duration;
         fft_full_duration += fft_single_duration;
         printf("FFT Duration: %fs.\n", (double)fft_single_duration / CLOCKS_PER_SEC);
-        // cartesian_to_polar(data_out, amp, phs);
+        // cartesian_to_polar(transform->spectrum, amp, phs);
 
         // Plot
         // gnuplot_resetplot(h);
@@ -190,6 +177,7 @@ int main(int argc, char** argv)
     printf("Average FFT Duration: %fs.\n", ((double)fft_full_duration / CLOCKS_PER_SEC) / nb_frames);
 
     fft_exit();
+    frame_assembler_destroy(frames);
     sf_close(infile);
     return EXIT_SUCCESS;
 }
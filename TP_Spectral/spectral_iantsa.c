@@ -10,15 +10,19 @@
 
 #include <math.h>
 
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
 
 /* taille de la fenetre */
 #define	FRAME_SIZE 1024
 /* avancement */
 #define HOP_SIZE 1024
+/* nombre de bins du demi-spectre */
+#define BINS (FRAME_SIZE / 2 + 1)
 
 static gnuplot_ctrl *h;
-static fftw_plan plan;
+static real_fft *transform;
 
 static void
 print_usage (char *progname)
@@ -27,28 +31,6 @@ print_usage (char *progname)
 		) ;
 
 } 
-static void
-fill_buffer(double *buffer, double *new_buffer)
-{
-  int i;
-  double tmp[FRAME_SIZE-HOP_SIZE];
-  
-  /* save */
-  for (i=0;i<FRAME_SIZE-HOP_SIZE;i++)
-    tmp[i] = buffer[i+HOP_SIZE];
-  
-  /* save offset */
-  for (i=0;i<(FRAME_SIZE-HOP_SIZE);i++)
-    {
-      buffer[i] = tmp[i];
-    }
-  
-  for (i=0;i<HOP_SIZE;i++)
-    {
-      buffer[FRAME_SIZE-HOP_SIZE+i] = new_buffer[i];
-    }
-}
-
 static int
 read_n_samples (SNDFILE * infile, double * buffer, int channels, int n)
 {
@@ -89,7 +71,7 @@ read_samples (SNDFILE * infile, double * buffer, int channels)
 }
 
 static void
-dft (double s[FRAME_SIZE], double complex S[FRAME_SIZE])
+dft (const double s[FRAME_SIZE], double complex S[FRAME_SIZE])
 {
 	for (int m = 0; m < FRAME_SIZE; m++)
 	{
@@ -100,9 +82,9 @@ dft (double s[FRAME_SIZE], double complex S[FRAME_SIZE])
 }
 
 static void
-cartesian_to_polar (double complex S[FRAME_SIZE], double amp[FRAME_SIZE], double phs[FRAME_SIZE])
+cartesian_to_polar (const double complex S[BINS], double amp[BINS], double phs[BINS])
 {
-	for (int n = 0; n < FRAME_SIZE; n++)
+	for (int n = 0; n < BINS; n++)
 	{
 		amp[n] = cabs(S[n]);
 		phs[n] = carg(S[n]);
@@ -110,24 +92,22 @@ cartesian_to_polar (double complex S[FRAME_SIZE], double amp[FRAME_SIZE], double
 }
 
 static void
-fft_init(fftw_complex data_in[FRAME_SIZE], fftw_complex data_out[FRAME_SIZE])
+fft_init()
 {
-	plan = fftw_plan_dft_1d(FRAME_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+	transform = real_fft_create(FRAME_SIZE, REAL_FFT_FORWARD);
 }
 
 static void
-fft(double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
+fft(const double s[FRAME_SIZE])
 {
-	for (int i = 0; i < FRAME_SIZE; i++)
-		data_in[i] = s[i];
-
-	fftw_execute(plan);
+	real_fft_load(transform, s, FRAME_SIZE);
+	real_fft_forward(transform);
 }
 
 static void
 fft_exit()
 {
-	fftw_destroy_plan(plan);
+	real_fft_destroy(transform);
 }
 
 int
@@ -155,7 +135,7 @@ main (int argc, char * argv [])
 	/* Read WAV */
 	int nb_frames = 0;
 	double new_buffer[HOP_SIZE];
-	double buffer[FRAME_SIZE];
+	frame_assembler *frames = frame_assembler_create (FRAME_SIZE);
 
 	/* Plot Init */
 	h=gnuplot_init();
@@ -165,7 +145,7 @@ main (int argc, char * argv [])
 	for (i=0;i<(FRAME_SIZE/HOP_SIZE-1);i++)
 	  {
 	    if (read_samples (infile, new_buffer, sfinfo.channels)==1)
-	      fill_buffer(buffer, new_buffer);
+	      frame_assembler_push (frames, new_buffer, HOP_SIZE);
 	    else
 	      {
 		printf("not enough samples !!\n");
@@ -182,22 +162,23 @@ main (int argc, char * argv [])
 	double complex S[FRAME_SIZE];
 
 	// FFT
-	fftw_complex data_in[FRAME_SIZE], data_out[FRAME_SIZE];
-	fft_init(data_in, data_out);
+	fft_planner_init();
+	fft_init();
 
     // DFT vs FFT
     clock_t t1, t2;
     double delta_t;
     double delta_t_sum = 0;
 	  	
-    double amp[FRAME_SIZE], phs[FRAME_SIZE];
+    double amp[BINS], phs[BINS];
 	while (read_samples (infile, new_buffer, sfinfo.channels)==1)
 	  {
 	    /* Process Samples */
 	    printf("Processing frame %d\n",nb_frames);
 
 	    /* hop size */
-	    fill_buffer(buffer, new_buffer);
+	    frame_assembler_push (frames, new_buffer, HOP_SIZE);
+	    const double *buffer = frame_assembler_get_frame (frames);
 
 
 	    // DFT
@@ -211,12 +192,12 @@ main (int argc, char * argv [])
 
 		//FFT
         t1 = clock();
-		fft(buffer, data_in);
+		fft(buffer);
         t2 = clock();
         delta_t = t2 - t1;
         delta_t_sum += delta_t;
         // printf ("FFT: %f secondes\n", delta_t / CLOCKS_PER_SEC);
-		//cartesian_to_polar(data_out, amp, phs);
+		//cartesian_to_polar(transform->spectrum, amp, phs);
 
 	    /* PLOT */
 	    // gnuplot_resetplot(h);
@@ -230,6 +211,7 @@ main (int argc, char * argv [])
 
 	sf_close (infile) ;
 	fft_exit();
+	frame_assembler_destroy (frames);
 
 	return 0 ;
 } /* main */
@@ -0,0 +1,212 @@
+#include "batch.h"
+
+#include <glob.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct share {
+    pthread_mutex_t mutex;
+    int next; // First file left.
+    int end; // Past the last file left.
+} share;
+
+typedef struct result {
+    char* text;
+    size_t size;
+    int done;
+} result;
+
+typedef struct batch {
+    const char* const* paths;
+    int count;
+    int threads;
+    batch_job job;
+    void* context;
+    FILE* output;
+    share* shares; // threads shares.
+    result* results; // count results.
+    pthread_mutex_t output_mutex;
+    int written; // Number of results written to the output.
+    int failures;
+} batch;
+
+typedef struct worker {
+    batch* batch;
+    int id;
+} worker;
+
+// Takes the next file of a share, or steals the last file of the largest other share.
+static int
+take(batch* const runner, const int id)
+{
+    share* const own = &runner->shares[id];
+    pthread_mutex_lock(&own->mutex);
+    const int file = own->next < own->end ? own->next++ : -1;
+    pthread_mutex_unlock(&own->mutex);
+    if (file >= 0)
+        return file;
+
+    for (;;) {
+        int victim = -1, most = 0;
+        for (int other = 0; other < runner->threads; other++) {
+            if (other == id)
+                continue;
+            pthread_mutex_lock(&runner->shares[other].mutex);
+            const int left = runner->shares[other].end - runner->shares[other].next;
+            pthread_mutex_unlock(&runner->shares[other].mutex);
+            if (left > most)
+                victim = other, most = left;
+        }
+        if (victim < 0)
+            return -1;
+
+        share* const stolen = &runner->shares[victim];
+        pthread_mutex_lock(&stolen->mutex);
+        const int file = stolen->next < stolen->end ? --stolen->end : -1;
+        pthread_mutex_unlock(&stolen->mutex);
+        if (file >= 0)
+            return file;
+    }
+}
+
+// Stores the result of a file, then writes all the results now in order.
+static void
+publish(batch* const runner, const int file, char* const text, const size_t size, const int status)
+{
+    pthread_mutex_lock(&runner->output_mutex);
+    runner->results[file].text = text;
+    runner->results[file].size = size;
+    runner->results[file].done = 1;
+    if (status != 0)
+        runner->failures++;
+
+    while (runner->written < runner->count && runner->results[runner->written].done) {
+        result* const next = &runner->results[runner->written];
+        if (next->text != NULL)
+            fwrite(next->text, 1, next->size, runner->output);
+        free(next->text);
+        next->text = NULL;
+        runner->written++;
+    }
+    fflush(runner->output);
+    pthread_mutex_unlock(&runner->output_mutex);
+}
+
+static void*
+work(void* const argument)
+{
+    const worker* const self = argument;
+    batch* const runner = self->batch;
+
+    for (int file; (file = take(runner, self->id)) >= 0;) {
+        char* text = NULL;
+        size_t size = 0;
+        FILE* const stream = open_memstream(&text, &size);
+        if (stream == NULL) {
+            fprintf(stderr, "Not able to buffer the results of %s.\n", runner->paths[file]);
+            publish(runner, file, NULL, 0, -1);
+            continue;
+        }
+
+        const int status = runner->job(runner->paths[file], stream, runner->context);
+        fclose(stream);
+        publish(runner, file, text, size, status);
+    }
+    return NULL;
+}
+
+int batch_threads(void)
+{
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+char** batch_expand(const char* const* const patterns, const int count, int* const paths_count)
+{
+    *paths_count = 0;
+    if (count == 0)
+        return NULL;
+
+    glob_t matches;
+    for (int i = 0; i < count; i++)
+        if (glob(patterns[i], GLOB_NOCHECK | (i > 0 ? GLOB_APPEND : 0), NULL, &matches) != 0) {
+            fprintf(stderr, "Not able to expand %s.\n", patterns[i]);
+            if (i > 0)
+                globfree(&matches);
+            return NULL;
+        }
+
+    char** const paths = malloc(matches.gl_pathc * sizeof(char*));
+    if (paths != NULL) {
+        for (size_t i = 0; i < matches.gl_pathc; i++)
+            paths[i] = strdup(matches.gl_pathv[i]);
+        *paths_count = matches.gl_pathc;
+    }
+    globfree(&matches);
+    return paths;
+}
+
+void batch_free_paths(char** const paths, const int count)
+{
+    if (paths == NULL)
+        return;
+
+    for (int i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+}
+
+int batch_run(const char* const* const paths, const int count, const int threads, const batch_job job, void* const context, FILE* const output)
+{
+    if (count <= 0)
+        return 0;
+
+    batch runner = {
+        .paths = paths,
+        .count = count,
+        .threads = threads < 1 ? 1 : threads > count ? count : threads,
+        .job = job,
+        .context = context,
+        .output = output,
+    };
+    runner.shares = malloc(runner.threads * sizeof(share));
+    runner.results = calloc(count, sizeof(result));
+    worker* const workers = malloc(runner.threads * sizeof(worker));
+    pthread_t* const ids = malloc(runner.threads * sizeof(pthread_t));
+    if (runner.shares == NULL || runner.results == NULL || workers == NULL || ids == NULL) {
+        fprintf(stderr, "Not able to allocate the batch.\n");
+        free(runner.shares);
+        free(runner.results);
+        free(workers);
+        free(ids);
+        return count;
+    }
+
+    pthread_mutex_init(&runner.output_mutex, NULL);
+    for (int id = 0; id < runner.threads; id++) {
+        pthread_mutex_init(&runner.shares[id].mutex, NULL);
+        runner.shares[id].next = (long)count * id / runner.threads;
+        runner.shares[id].end = (long)count * (id + 1) / runner.threads;
+        workers[id] = (worker) { &runner, id };
+    }
+
+    // The calling thread is the first worker.
+    int started = 1;
+    for (int id = 1; id < runner.threads; id++, started++)
+        if (pthread_create(&ids[id], NULL, work, &workers[id]) != 0)
+            break;
+    work(&workers[0]);
+    for (int id = 1; id < started; id++)
+        pthread_join(ids[id], NULL);
+
+    for (int id = 0; id < runner.threads; id++)
+        pthread_mutex_destroy(&runner.shares[id].mutex);
+    pthread_mutex_destroy(&runner.output_mutex);
+    free(runner.shares);
+    free(runner.results);
+    free(workers);
+    free(ids);
+    return runner.failures;
+}
@@ -0,0 +1,67 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/*
+ * Parallel batch runner.
+ *
+ * Runs a job on each input file, on a pool of threads. Each thread starts with
+ * its own contiguous share of the files and, once done, steals files from the
+ * end of the busiest shares. A job writes its results to a stream of its own,
+ * which is copied to the output as soon as the results of all the previous
+ * files are, so the output is the same whatever the number of threads.
+ *
+ * Jobs run concurrently: their state has to be local (or thread-local), and
+ * FFT plans made through fft_plan() (see fft.h), which serializes the planner.
+ */
+
+/**
+ * @brief Processes an input file.
+ *
+ * @param path The path of the input file.
+ * @param output The stream to write the results to.
+ * @param context The context given to the batch.
+ * @return 0 on success, anything else on failure.
+ */
+typedef int (*batch_job)(const char* const path, FILE* const output, void* const context);
+
+/**
+ * @brief Gets the default number of threads: the number of online cores.
+ *
+ * @return The number of threads.
+ */
+int batch_threads(void);
+
+/**
+ * @brief Expands glob patterns into a list of paths (patterns matching nothing are kept as is).
+ *
+ * @param patterns The patterns.
+ * @param count The number of patterns.
+ * @param paths_count The number of paths.
+ * @return The paths, to free with batch_free_paths().
+ */
+char** batch_expand(const char* const* const patterns, const int count, int* const paths_count);
+
+/**
+ * @brief Frees a list of paths returned by batch_expand().
+ *
+ * @param paths The paths.
+ * @param count The number of paths.
+ */
+void batch_free_paths(char** const paths, const int count);
+
+/**
+ * @brief Runs a job on each input file, in parallel, writing the results in order.
+ *
+ * @param paths The paths of the input files.
+ * @param count The number of input files.
+ * @param threads The number of threads (at most one per file is started).
+ * @param job The job.
+ * @param context The context passed to the job.
+ * @param output The output stream.
+ * @return The number of failed jobs.
+ */
+int batch_run(const char* const* const paths, const int count, const int threads, const batch_job job, void* const context, FILE* const output);
+
+#endif // BATCH_H
@@ -0,0 +1,98 @@
+#include "cepstrum.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "spectrum.h"
+
+static fftw_plan
+plan_analysis(const unsigned flags, void* const context)
+{
+    cepstrum* const analysis = context;
+    return fftw_plan_r2r_1d(analysis->bins, analysis->log_magnitudes, analysis->coefficients, FFTW_REDFT00, flags);
+}
+
+static fftw_plan
+plan_synthesis(const unsigned flags, void* const context)
+{
+    cepstrum* const analysis = context;
+    return fftw_plan_r2r_1d(analysis->bins, analysis->liftered, analysis->envelope, FFTW_REDFT00, flags);
+}
+
+cepstrum* cepstrum_create(const int fft_size, const int order)
+{
+    cepstrum* const analysis = malloc(sizeof(cepstrum));
+    if (analysis == NULL)
+        return NULL;
+
+    const int bins = fft_size / 2 + 1;
+    analysis->fft_size = fft_size;
+    analysis->bins = bins;
+    analysis->order = order;
+    analysis->log_magnitudes = fftw_alloc_real(bins);
+    analysis->coefficients = fftw_alloc_real(bins);
+    analysis->liftered = fftw_alloc_real(bins);
+    analysis->envelope = fftw_alloc_real(bins);
+    analysis->lifter = malloc(bins * sizeof(double));
+    analysis->analysis_plan = NULL;
+    analysis->synthesis_plan = NULL;
+    if (analysis->log_magnitudes == NULL || analysis->coefficients == NULL || analysis->liftered == NULL || analysis->envelope == NULL || analysis->lifter == NULL) {
+        cepstrum_destroy(analysis);
+        return NULL;
+    }
+
+    // The even cepstrum keeps [-order / 2, order / 2], the two ends of which
+    // fold on the same bin. The inverse DCT normalization is folded in.
+    const double half_order = order / 2.;
+    for (int quefrency = 0; quefrency < bins; quefrency++)
+        analysis->lifter[quefrency] = (quefrency < half_order ? 1. : quefrency == half_order ? .5 : 0.) / fft_size;
+
+    char key[32];
+    snprintf(key, sizeof(key), "redft00-%d", bins);
+    analysis->analysis_plan = fft_plan(key, plan_analysis, analysis);
+    analysis->synthesis_plan = fft_plan(key, plan_synthesis, analysis);
+    return analysis;
+}
+
+void cepstrum_envelope(cepstrum* const analysis, const fftw_complex* const spectrum)
+{
+    spectrum_log_magnitude(analysis->log_magnitudes, spectrum, analysis->bins, 1.);
+    fftw_execute(analysis->analysis_plan);
+
+    for (int quefrency = 0; quefrency < analysis->bins; quefrency++)
+        analysis->liftered[quefrency] = analysis->coefficients[quefrency] * analysis->lifter[quefrency];
+    fftw_execute(analysis->synthesis_plan);
+}
+
+bool cepstrum_write_header(const cepstrum* const analysis, FILE* const file, const double sample_rate)
+{
+    const int32_t bins = analysis->bins;
+    const float rate = sample_rate;
+    return fwrite(CEPSTRUM_MAGIC, 1, sizeof(CEPSTRUM_MAGIC), file) == sizeof(CEPSTRUM_MAGIC)
+        && fwrite(&bins, sizeof(bins), 1, file) == 1
+        && fwrite(&rate, sizeof(rate), 1, file) == 1;
+}
+
+bool cepstrum_write_envelope(const cepstrum* const analysis, FILE* const file)
+{
+    float values[analysis->bins];
+    for (int bin = 0; bin < analysis->bins; bin++)
+        values[bin] = analysis->envelope[bin];
+    return fwrite(values, sizeof(float), analysis->bins, file) == (size_t)analysis->bins;
+}
+
+void cepstrum_destroy(cepstrum* const analysis)
+{
+    if (analysis == NULL)
+        return;
+
+    fft_plan_destroy(analysis->analysis_plan);
+    fft_plan_destroy(analysis->synthesis_plan);
+    fftw_free(analysis->log_magnitudes);
+    fftw_free(analysis->coefficients);
+    fftw_free(analysis->liftered);
+    fftw_free(analysis->envelope);
+    free(analysis->lifter);
+    free(analysis);
+}
@@ -0,0 +1,82 @@
+#ifndef CEPSTRUM_H
+#define CEPSTRUM_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "fft.h"
+
+/*
+ * Real cepstrum and spectral envelope.
+ *
+ * The log-magnitude spectrum of a real frame is real and even, and so is its
+ * cepstrum: both transforms of the analysis are type I DCTs (REDFT00) over
+ * the fft_size / 2 + 1 bins, instead of complex FFTs over fft_size points.
+ * The envelope is the spectrum of the cepstrum low-passed by a tabulated
+ * lifter (quefrencies below order / 2, the 1 / fft_size normalization folded
+ * in), so a frame costs a log per bin and two half-size real transforms.
+ *
+ * Envelopes can be written to a binary file: a header (CEPSTRUM_MAGIC, the
+ * number of bins as an int32 and the sample rate as a float32), then the bins
+ * of each frame as float32 natural logs of amplitudes, in native byte order.
+ */
+
+#define CEPSTRUM_MAGIC "TSMENV1" // 8 bytes with the terminating 0.
+
+typedef struct cepstrum {
+    int fft_size;
+    int bins; // fft_size / 2 + 1.
+    int order; // Lifter order.
+    double* log_magnitudes; // bins log-magnitudes of the current frame.
+    double* coefficients; // bins real cepstrum coefficients c[0, fft_size / 2] of the current frame (times fft_size).
+    double* liftered; // bins liftered coefficients.
+    double* envelope; // bins log-amplitudes of the spectral envelope of the current frame.
+    double* lifter; // bins lifter weights.
+    fftw_plan analysis_plan; // From log_magnitudes to coefficients.
+    fftw_plan synthesis_plan; // From liftered to envelope.
+} cepstrum;
+
+/**
+ * @brief Creates a cepstral analysis.
+ *
+ * @param fft_size The FFT size of the spectra.
+ * @param order The lifter order: quefrencies below order / 2 are kept (at most fft_size).
+ * @return The cepstral analysis, or NULL if the allocation failed.
+ */
+cepstrum* cepstrum_create(const int fft_size, const int order);
+
+/**
+ * @brief Computes the cepstrum and the spectral envelope of a frame.
+ *
+ * @param analysis The cepstral analysis.
+ * @param spectrum The fft_size / 2 + 1 bins of the frame.
+ */
+void cepstrum_envelope(cepstrum* const analysis, const fftw_complex* const spectrum);
+
+/**
+ * @brief Writes the header of an envelope file.
+ *
+ * @param analysis The cepstral analysis.
+ * @param file The envelope file.
+ * @param sample_rate The sample rate (Hz).
+ * @return True if the header was written.
+ */
+bool cepstrum_write_header(const cepstrum* const analysis, FILE* const file, const double sample_rate);
+
+/**
+ * @brief Writes the spectral envelope of the current frame to an envelope file.
+ *
+ * @param analysis The cepstral analysis.
+ * @param file The envelope file.
+ * @return True if the envelope was written.
+ */
+bool cepstrum_write_envelope(const cepstrum* const analysis, FILE* const file);
+
+/**
+ * @brief Destroys a cepstral analysis.
+ *
+ * @param analysis The cepstral analysis.
+ */
+void cepstrum_destroy(cepstrum* const analysis);
+
+#endif // CEPSTRUM_H
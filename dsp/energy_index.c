@@ -0,0 +1,310 @@
+#include "energy_index.h"
+
+#include <math.h>
+#include <sndfile.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define SIDECAR_EXTENSION ".tsmidx"
+#define SIDECAR_MAGIC "TSMIDX1"
+
+// Everything the sidecar depends on, written first.
+typedef struct sidecar_header {
+    char magic[8];
+    int64_t file_size;
+    int64_t file_time;
+    int64_t frames;
+    int32_t sample_rate;
+    int32_t block_size;
+    double silence_energy;
+    int32_t block_count;
+    int32_t span_count;
+} sidecar_header;
+
+// Sums the squares and finds the highest absolute value of n samples.
+static void
+block_stats(const double* const samples, const int n, double* const squares, double* const peak)
+{
+    int sample = 0;
+    double sum = 0., highest = 0.;
+
+#if defined(__SSE2__)
+    const __m128d sign = _mm_set1_pd(-0.);
+    __m128d sums = _mm_setzero_pd(), highests = _mm_setzero_pd();
+    for (; sample + 2 <= n; sample += 2) {
+        const __m128d values = _mm_loadu_pd(samples + sample);
+        sums = _mm_add_pd(sums, _mm_mul_pd(values, values));
+        highests = _mm_max_pd(highests, _mm_andnot_pd(sign, values));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, sums);
+    sum = lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, highests);
+    highest = fmax(lanes[0], lanes[1]);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t sums = vdupq_n_f64(0.), highests = vdupq_n_f64(0.);
+    for (; sample + 2 <= n; sample += 2) {
+        const float64x2_t values = vld1q_f64(samples + sample);
+        sums = vfmaq_f64(sums, values, values);
+        highests = vmaxq_f64(highests, vabsq_f64(values));
+    }
+    sum = vaddvq_f64(sums);
+    highest = vmaxvq_f64(highests);
+#endif
+
+    for (; sample < n; sample++) {
+        sum += samples[sample] * samples[sample];
+        highest = fmax(highest, fabs(samples[sample]));
+    }
+    *squares = sum;
+    *peak = highest;
+}
+
+static void
+sidecar_path(char* const sidecar, const size_t size, const char* const path)
+{
+    snprintf(sidecar, size, "%s" SIDECAR_EXTENSION, path);
+}
+
+// Fills the header with the key of the sound file, false if it cannot be stat'ed.
+static bool
+sidecar_key(sidecar_header* const header, const char* const path)
+{
+    struct stat status;
+    if (stat(path, &status) != 0)
+        return false;
+
+    memset(header, 0, sizeof(sidecar_header));
+    memcpy(header->magic, SIDECAR_MAGIC, sizeof(header->magic));
+    header->file_size = status.st_size;
+    header->file_time = status.st_mtime;
+    return true;
+}
+
+static energy_index*
+index_create(const long frames, const int sample_rate, const int block_size, const double silence_energy, const int block_count)
+{
+    energy_index* const index = malloc(sizeof(energy_index));
+    if (index == NULL)
+        return NULL;
+
+    index->frames = frames;
+    index->sample_rate = sample_rate;
+    index->block_size = block_size;
+    index->silence_energy = silence_energy;
+    index->block_count = block_count;
+    index->blocks = malloc((block_count > 0 ? block_count : 1) * sizeof(energy_block));
+    index->span_count = 0;
+    index->spans = NULL;
+    if (index->blocks == NULL) {
+        energy_index_destroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+energy_index* energy_index_build(const char* const path, const int block_size, const double silence_energy)
+{
+    SF_INFO info = { 0 };
+    SNDFILE* const file = sf_open(path, SFM_READ, &info);
+    if (file == NULL)
+        return NULL;
+
+    const int block_count = (info.frames + block_size - 1) / block_size;
+    energy_index* const index = index_create(info.frames, info.samplerate, block_size, silence_energy, block_count);
+    double* const block = malloc(block_size * sizeof(double));
+    double* const interleaved = info.channels > 1 ? malloc(block_size * info.channels * sizeof(double)) : NULL;
+    // At most one span every other block.
+    silent_span* const spans = malloc((block_count / 2 + 1) * sizeof(silent_span));
+    if (index == NULL || block == NULL || (info.channels > 1 && interleaved == NULL) || spans == NULL) {
+        energy_index_destroy(index);
+        free(block);
+        free(interleaved);
+        free(spans);
+        sf_close(file);
+        return NULL;
+    }
+    index->spans = spans;
+
+    long position = 0;
+    int count = 0;
+    for (int read_count; count < block_count && (read_count = sf_readf_double(file, info.channels == 1 ? block : interleaved, block_size)) > 0; count++) {
+        if (info.channels > 1)
+            for (int sample = 0; sample < read_count; sample++) {
+                double sum = 0.;
+                for (int channel = 0; channel < info.channels; channel++)
+                    sum += interleaved[sample * info.channels + channel];
+                block[sample] = sum / info.channels;
+            }
+
+        double squares, peak;
+        block_stats(block, read_count, &squares, &peak);
+        index->blocks[count].rms = sqrt(squares / read_count);
+        index->blocks[count].peak = peak;
+
+        // Extend the last span, or start a new one.
+        if (squares / read_count <= silence_energy) {
+            if (index->span_count > 0 && spans[index->span_count - 1].end == position)
+                spans[index->span_count - 1].end = position + read_count;
+            else
+                spans[index->span_count++] = (silent_span) { position, position + read_count };
+        }
+        position += read_count;
+    }
+    index->block_count = count;
+    index->frames = position;
+
+    free(block);
+    free(interleaved);
+    sf_close(file);
+    return index;
+}
+
+bool energy_index_save(const energy_index* const index, const char* const path)
+{
+    sidecar_header header;
+    if (!sidecar_key(&header, path))
+        return false;
+    header.frames = index->frames;
+    header.sample_rate = index->sample_rate;
+    header.block_size = index->block_size;
+    header.silence_energy = index->silence_energy;
+    header.block_count = index->block_count;
+    header.span_count = index->span_count;
+
+    char sidecar[4096];
+    sidecar_path(sidecar, sizeof(sidecar), path);
+    FILE* const file = fopen(sidecar, "wb");
+    if (file == NULL)
+        return false;
+
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(index->blocks, sizeof(energy_block), index->block_count, file) == (size_t)index->block_count;
+    for (int span = 0; written && span < index->span_count; span++) {
+        const int64_t bounds[2] = { index->spans[span].start, index->spans[span].end };
+        written = fwrite(bounds, sizeof(bounds), 1, file) == 1;
+    }
+    written = fclose(file) == 0 && written;
+    if (!written)
+        remove(sidecar);
+    return written;
+}
+
+// Reads the sidecar of a sound file, NULL if missing or stale.
+static energy_index*
+read_sidecar(const char* const path, const int block_size, const double silence_energy)
+{
+    sidecar_header key, header;
+    if (!sidecar_key(&key, path))
+        return NULL;
+
+    char sidecar[4096];
+    sidecar_path(sidecar, sizeof(sidecar), path);
+    FILE* const file = fopen(sidecar, "rb");
+    if (file == NULL)
+        return NULL;
+
+    energy_index* index = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, key.magic, sizeof(key.magic)) == 0
+        && header.file_size == key.file_size && header.file_time == key.file_time
+        && header.block_size == block_size && header.silence_energy == silence_energy
+        && header.block_count >= 0 && header.span_count >= 0)
+        index = index_create(header.frames, header.sample_rate, header.block_size, header.silence_energy, header.block_count);
+
+    if (index != NULL) {
+        index->spans = malloc((header.span_count > 0 ? header.span_count : 1) * sizeof(silent_span));
+        bool valid = index->spans != NULL
+            && fread(index->blocks, sizeof(energy_block), header.block_count, file) == (size_t)header.block_count;
+        for (int span = 0; valid && span < header.span_count; span++) {
+            int64_t bounds[2];
+            valid = fread(bounds, sizeof(bounds), 1, file) == 1;
+            index->spans[span] = (silent_span) { bounds[0], bounds[1] };
+        }
+        index->span_count = header.span_count;
+        if (!valid) {
+            energy_index_destroy(index);
+            index = NULL;
+        }
+    }
+
+    fclose(file);
+    return index;
+}
+
+energy_index* energy_index_load(const char* const path, const int block_size, const double silence_energy)
+{
+    energy_index* index = read_sidecar(path, block_size, silence_energy);
+    if (index != NULL)
+        return index;
+
+    index = energy_index_build(path, block_size, silence_energy);
+    if (index != NULL && !energy_index_save(index, path))
+        fprintf(stderr, "Not able to save the energy index of %s.\n", path);
+    return index;
+}
+
+// Index of the first silent span ending at or after a sample (span_count if none), by binary search.
+static int
+first_span_ending_at(const energy_index* const index, const long sample)
+{
+    int low = 0, high = index->span_count;
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (index->spans[middle].end < sample)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+bool energy_index_sound_frames(const energy_index* const index, const int frame_size, const int hop_size, const long from, long* const first, long* const end)
+{
+    const long frame_count = index->frames < frame_size ? 0 : (index->frames - frame_size) / hop_size + 1;
+    long frame = from;
+
+    // The spans before the first frame are not scanned again at every call.
+    int span = first_span_ending_at(index, from * hop_size + frame_size);
+
+    // Skip the frames lying entirely in a silent span.
+    for (;;) {
+        if (frame >= frame_count)
+            return false;
+        while (span < index->span_count && index->spans[span].end < frame * hop_size + frame_size)
+            span++;
+        if (span == index->span_count || index->spans[span].start > frame * hop_size)
+            break;
+        frame = (index->spans[span].end - frame_size) / hop_size + 1;
+    }
+    *first = frame;
+
+    // Up to the first frame lying entirely in the next silent span.
+    *end = frame_count;
+    for (; span < index->span_count; span++) {
+        const long start = (index->spans[span].start + hop_size - 1) / hop_size;
+        if (start * hop_size + frame_size <= index->spans[span].end) {
+            *end = start < frame_count ? start : frame_count;
+            break;
+        }
+    }
+    return true;
+}
+
+void energy_index_destroy(energy_index* const index)
+{
+    if (index == NULL)
+        return;
+
+    free(index->blocks);
+    free(index->spans);
+    free(index);
+}
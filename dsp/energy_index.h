@@ -0,0 +1,93 @@
+#ifndef ENERGY_INDEX_H
+#define ENERGY_INDEX_H
+
+#include <stdbool.h>
+
+/*
+ * Energy index of a sound file.
+ *
+ * One pass over the file (channels mixed down to mono) gives the RMS and
+ * peak of each block of samples, and the silent spans: runs of blocks whose
+ * mean energy (mean of x^2) is at most the silence threshold. The index is
+ * cached in a sidecar file next to the sound (<path>.tsmidx, native byte
+ * order), valid as long as the size and modification time of the sound and
+ * the block size and threshold stay the same.
+ *
+ * Analyzers then seek past the frames lying entirely in a silent span: such a
+ * frame is silent itself, exactly so when the frame and hop sizes are
+ * multiples of the block size.
+ */
+
+typedef struct energy_block {
+    float rms;
+    float peak; // Highest absolute sample.
+} energy_block;
+
+typedef struct silent_span {
+    long start; // First sample.
+    long end; // Sample after the last one.
+} silent_span;
+
+typedef struct energy_index {
+    long frames; // Number of samples (per channel) of the sound.
+    int sample_rate;
+    int block_size;
+    double silence_energy; // Highest mean energy of a silent block.
+    int block_count;
+    energy_block* blocks;
+    int span_count;
+    silent_span* spans; // In order, not adjacent.
+} energy_index;
+
+/**
+ * @brief Loads the energy index of a sound file from its sidecar, or builds it (and saves its sidecar).
+ *
+ * @param path The path of the sound file.
+ * @param block_size The block size.
+ * @param silence_energy The highest mean energy of a silent block.
+ * @return The index, or NULL if the sound file could not be read.
+ */
+energy_index* energy_index_load(const char* const path, const int block_size, const double silence_energy);
+
+/**
+ * @brief Builds the energy index of a sound file, in one pass.
+ *
+ * @param path The path of the sound file.
+ * @param block_size The block size.
+ * @param silence_energy The highest mean energy of a silent block.
+ * @return The index, or NULL if the sound file could not be read.
+ */
+energy_index* energy_index_build(const char* const path, const int block_size, const double silence_energy);
+
+/**
+ * @brief Saves the sidecar of an energy index.
+ *
+ * @param index The index.
+ * @param path The path of the sound file (not of the sidecar).
+ * @return True if the sidecar was written.
+ */
+bool energy_index_save(const energy_index* const index, const char* const path);
+
+/**
+ * @brief Finds the next run of frames not lying entirely in a silent span.
+ *
+ * Frame k covers the samples [k * hop_size, k * hop_size + frame_size).
+ *
+ * @param index The index.
+ * @param frame_size The frame size.
+ * @param hop_size The hop size.
+ * @param from The index of the first frame to look at.
+ * @param first The index of the first frame of the run.
+ * @param end The index of the frame after the last one of the run.
+ * @return False if there are no such frames left.
+ */
+bool energy_index_sound_frames(const energy_index* const index, const int frame_size, const int hop_size, const long from, long* const first, long* const end);
+
+/**
+ * @brief Destroys an energy index.
+ *
+ * @param index The index.
+ */
+void energy_index_destroy(energy_index* const index);
+
+#endif // ENERGY_INDEX_H
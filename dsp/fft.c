@@ -0,0 +1,198 @@
+#include "fft.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static unsigned planner_flags = FFTW_ESTIMATE;
+static char wisdom_directory[PATH_MAX] = "";
+
+// Only fftw_execute is thread safe, everything else touching plans goes through this lock.
+static pthread_mutex_t planner_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+make_directories(char* const path)
+{
+    for (char* separator = strchr(path + 1, '/'); separator != NULL; separator = strchr(separator + 1, '/')) {
+        *separator = '\0';
+        mkdir(path, 0755);
+        *separator = '/';
+    }
+    mkdir(path, 0755);
+}
+
+void fft_planner_init(void)
+{
+    const char* const mode = getenv("TSM_FFT_PLANNER");
+    planner_flags = FFTW_MEASURE;
+    if (mode != NULL) {
+        if (strcmp(mode, "estimate") == 0)
+            planner_flags = FFTW_ESTIMATE;
+        else if (strcmp(mode, "patient") == 0)
+            planner_flags = FFTW_PATIENT;
+        else if (strcmp(mode, "exhaustive") == 0)
+            planner_flags = FFTW_EXHAUSTIVE;
+        else if (strcmp(mode, "measure") != 0)
+            fprintf(stderr, "Unknown FFT planner %s, using measure.\n", mode);
+    }
+
+    // Estimated plans are cheap, there is nothing worth caching.
+    wisdom_directory[0] = '\0';
+    if (planner_flags == FFTW_ESTIMATE)
+        return;
+
+    const char* const directory = getenv("TSM_FFT_WISDOM");
+    const char* const cache = getenv("XDG_CACHE_HOME");
+    const char* const home = getenv("HOME");
+    int length = 0;
+    if (directory != NULL) {
+        if (strcmp(directory, "none") != 0)
+            length = snprintf(wisdom_directory, sizeof(wisdom_directory), "%s", directory);
+    } else if (cache != NULL && cache[0] != '\0')
+        length = snprintf(wisdom_directory, sizeof(wisdom_directory), "%s/tsm", cache);
+    else if (home != NULL && home[0] != '\0')
+        length = snprintf(wisdom_directory, sizeof(wisdom_directory), "%s/.cache/tsm", home);
+
+    // A directory too long to hold is not used.
+    if (length < 0 || length >= (int)sizeof(wisdom_directory))
+        wisdom_directory[0] = '\0';
+    if (wisdom_directory[0] != '\0')
+        make_directories(wisdom_directory);
+}
+
+unsigned fft_planner_flags(void)
+{
+    return planner_flags;
+}
+
+static fftw_plan
+plan_locked(const char* const key, const fft_planner planner, void* const context)
+{
+    if (wisdom_directory[0] == '\0')
+        return planner(planner_flags, context);
+
+    // A truncated path could be another transform's file, plan without the cache.
+    char path[PATH_MAX];
+    const int length = snprintf(path, sizeof(path), "%s/fftw-d-%s.wisdom", wisdom_directory, key);
+    if (length < 0 || length >= (int)sizeof(path))
+        return planner(planner_flags, context);
+
+    // Keep only the wisdom of this transform, so that each file stays small.
+    fftw_forget_wisdom();
+    if (fftw_import_wisdom_from_filename(path)) {
+        const fftw_plan plan = planner(planner_flags | FFTW_WISDOM_ONLY, context);
+        if (plan != NULL)
+            return plan;
+    }
+
+    const fftw_plan plan = planner(planner_flags, context);
+    if (plan == NULL)
+        return NULL;
+
+    // Write then rename, so that concurrent runs never read a partial file.
+    char temporary_path[PATH_MAX + 32];
+    snprintf(temporary_path, sizeof(temporary_path), "%s.%d", path, (int)getpid());
+    if (fftw_export_wisdom_to_filename(temporary_path))
+        rename(temporary_path, path);
+    else
+        fprintf(stderr, "Not able to save FFT wisdom to %s.\n", path);
+    return plan;
+}
+
+fftw_plan fft_plan(const char* const key, const fft_planner planner, void* const context)
+{
+    pthread_mutex_lock(&planner_mutex);
+    const fftw_plan plan = plan_locked(key, planner, context);
+    pthread_mutex_unlock(&planner_mutex);
+    return plan;
+}
+
+void fft_plan_destroy(const fftw_plan plan)
+{
+    if (plan == NULL)
+        return;
+
+    pthread_mutex_lock(&planner_mutex);
+    fftw_destroy_plan(plan);
+    pthread_mutex_unlock(&planner_mutex);
+}
+
+static fftw_plan
+plan_forward(const unsigned flags, void* const context)
+{
+    real_fft* const fft = context;
+    return fftw_plan_dft_r2c_1d(fft->size, fft->signal, fft->spectrum, flags);
+}
+
+static fftw_plan
+plan_inverse(const unsigned flags, void* const context)
+{
+    real_fft* const fft = context;
+    return fftw_plan_dft_c2r_1d(fft->size, fft->spectrum, fft->signal, flags);
+}
+
+real_fft* real_fft_create(const int size, const int directions)
+{
+    real_fft* const fft = malloc(sizeof(real_fft));
+    if (fft == NULL)
+        return NULL;
+
+    fft->size = size;
+    fft->bins = size / 2 + 1;
+    fft->signal = fftw_alloc_real(size);
+    fft->spectrum = fftw_alloc_complex(fft->bins);
+    fft->forward_plan = NULL;
+    fft->inverse_plan = NULL;
+
+    if (fft->signal == NULL || fft->spectrum == NULL) {
+        real_fft_destroy(fft);
+        return NULL;
+    }
+
+    char key[32];
+    if (directions & REAL_FFT_FORWARD) {
+        snprintf(key, sizeof(key), "r2c-%d", size);
+        fft->forward_plan = fft_plan(key, plan_forward, fft);
+    }
+    if (directions & REAL_FFT_INVERSE) {
+        snprintf(key, sizeof(key), "c2r-%d", size);
+        fft->inverse_plan = fft_plan(key, plan_inverse, fft);
+    }
+
+    // Measuring plans overwrites the buffers.
+    memset(fft->signal, 0, size * sizeof(double));
+    memset(fft->spectrum, 0, fft->bins * sizeof(fftw_complex));
+    return fft;
+}
+
+void real_fft_load(real_fft* const fft, const double* const samples, const int n)
+{
+    memcpy(fft->signal, samples, n * sizeof(double));
+    memset(fft->signal + n, 0, (fft->size - n) * sizeof(double));
+}
+
+void real_fft_forward(real_fft* const fft)
+{
+    fftw_execute(fft->forward_plan);
+}
+
+void real_fft_inverse(real_fft* const fft)
+{
+    fftw_execute(fft->inverse_plan);
+}
+
+void real_fft_destroy(real_fft* const fft)
+{
+    if (fft == NULL)
+        return;
+
+    fft_plan_destroy(fft->forward_plan);
+    fft_plan_destroy(fft->inverse_plan);
+    fftw_free(fft->signal);
+    fftw_free(fft->spectrum);
+    free(fft);
+}
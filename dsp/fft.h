@@ -0,0 +1,114 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex.h>
+#include <fftw3.h>
+
+/*
+ * Real-input FFT.
+ *
+ * The spectrum of a real signal of size N is Hermitian, so only its first
+ * N / 2 + 1 bins are computed (r2c) and synthesized back (c2r). This is about
+ * half the work and half the memory traffic of a complex transform.
+ *
+ * Plans are made by a shared planner. After fft_planner_init, plans are made
+ * with the quality requested in TSM_FFT_PLANNER (estimate, measure, patient
+ * or exhaustive, measure by default), and the resulting wisdom is cached in
+ * TSM_FFT_WISDOM (a directory, $XDG_CACHE_HOME/tsm or ~/.cache/tsm by default,
+ * "none" to disable the cache). There is one wisdom file per precision,
+ * transform kind and size, so only the first run of a tool pays for planning.
+ * Without fft_planner_init, plans are estimated and nothing is cached.
+ *
+ * Plans can be made and destroyed from several threads at once: fft_plan and
+ * fft_plan_destroy serialize the FFTW planner, which is not thread safe. Each
+ * thread then executes its own plans (and buffers) concurrently.
+ */
+
+#define REAL_FFT_FORWARD 1
+#define REAL_FFT_INVERSE 2
+
+typedef struct real_fft {
+    int size; // Signal size N.
+    int bins; // Number of spectrum bins, N / 2 + 1.
+    double* signal; // N samples.
+    fftw_complex* spectrum; // N / 2 + 1 bins.
+    fftw_plan forward_plan; // From signal to spectrum (NULL if not requested).
+    fftw_plan inverse_plan; // From spectrum to signal (NULL if not requested).
+} real_fft;
+
+/**
+ * @brief A function making an FFTW plan with the given planning flags.
+ */
+typedef fftw_plan (*fft_planner)(const unsigned flags, void* const context);
+
+/**
+ * @brief Initializes the shared planner from the environment.
+ * Call it once, at the start of the program, before creating any FFT.
+ */
+void fft_planner_init(void);
+
+/**
+ * @brief Gets the planning flags of the shared planner, for plans made outside of it.
+ *
+ * @return FFTW_ESTIMATE, FFTW_MEASURE, FFTW_PATIENT or FFTW_EXHAUSTIVE.
+ */
+unsigned fft_planner_flags(void);
+
+/**
+ * @brief Makes a plan with the shared planner, reusing the cached wisdom if any.
+ *
+ * @param key The key of the transform, unique for its kind and sizes (e.g. "r2c-1024").
+ * @param planner The planner function.
+ * @param context The context passed to the planner function.
+ * @return The plan, or NULL if FFTW cannot make it.
+ */
+fftw_plan fft_plan(const char* const key, const fft_planner planner, void* const context);
+
+/**
+ * @brief Destroys a plan made with fft_plan.
+ *
+ * @param plan The plan (may be NULL).
+ */
+void fft_plan_destroy(const fftw_plan plan);
+
+/**
+ * @brief Creates a real FFT, planning the requested directions.
+ *
+ * @param size The signal size N.
+ * @param directions REAL_FFT_FORWARD, REAL_FFT_INVERSE or both (bitwise or).
+ * @return The real FFT, or NULL if the allocation failed.
+ */
+real_fft* real_fft_create(const int size, const int directions);
+
+/**
+ * @brief Loads a signal into the FFT input, zero-padding it to the FFT size.
+ *
+ * @param fft The real FFT.
+ * @param samples The signal.
+ * @param n The number of samples in the signal (at most the FFT size).
+ */
+void real_fft_load(real_fft* const fft, const double* const samples, const int n);
+
+/**
+ * @brief Computes the N / 2 + 1 spectrum bins of the loaded signal.
+ *
+ * @param fft The real FFT (planned forward).
+ */
+void real_fft_forward(real_fft* const fft);
+
+/**
+ * @brief Synthesizes the real signal from the N / 2 + 1 spectrum bins.
+ * The result is not normalized (scaled by N), and the spectrum is destroyed.
+ *
+ * @param fft The real FFT (planned inverse).
+ */
+void real_fft_inverse(real_fft* const fft);
+
+/**
+ * @brief Destroys a real FFT.
+ *
+ * @param fft The real FFT.
+ */
+void real_fft_destroy(real_fft* const fft);
+
+#endif // FFT_H
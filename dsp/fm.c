@@ -0,0 +1,300 @@
+#include "fm.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define IDLE 0
+#define ATTACK 1
+#define DECAY 2
+#define SUSTAIN 3
+#define RELEASE 4
+
+#define OPERATOR(index) (1u << (index))
+
+// Operators 0 to 3, the modulators of an operator always come after it.
+const fm_algorithm fm_algorithms[FM_ALGORITHMS] = {
+    { { OPERATOR(1), OPERATOR(2), OPERATOR(3), 0 }, OPERATOR(0) }, // 3 > 2 > 1 > 0.
+    { { OPERATOR(1), OPERATOR(2) | OPERATOR(3), 0, 0 }, OPERATOR(0) }, // (2 + 3) > 1 > 0.
+    { { OPERATOR(1) | OPERATOR(3), OPERATOR(2), 0, 0 }, OPERATOR(0) }, // (2 > 1 + 3) > 0.
+    { { OPERATOR(1) | OPERATOR(2), 0, OPERATOR(3), 0 }, OPERATOR(0) }, // (1 + 3 > 2) > 0.
+    { { OPERATOR(1), 0, OPERATOR(3), 0 }, OPERATOR(0) | OPERATOR(2) }, // 1 > 0, 3 > 2.
+    { { OPERATOR(3), OPERATOR(3), OPERATOR(3), 0 }, OPERATOR(0) | OPERATOR(1) | OPERATOR(2) }, // 3 > 0, 1, 2.
+    { { OPERATOR(1), 0, 0, 0 }, OPERATOR(0) | OPERATOR(2) | OPERATOR(3) }, // 1 > 0, 2, 3.
+    { { 0, 0, 0, 0 }, OPERATOR(0) | OPERATOR(1) | OPERATOR(2) | OPERATOR(3) }, // Additive.
+};
+
+// Taylor series of sin(2 pi x) on [-1 / 4, 1 / 4], up to x^13.
+#define S1 (2. * M_PI)
+#define S3 (-1. / 6.)
+#define S5 (1. / 120.)
+#define S7 (-1. / 5040.)
+#define S9 (1. / 362880.)
+#define S11 (-1. / 39916800.)
+#define S13 (1. / 6227020800.)
+
+// Renders a sample of an operator for all the voices: gain sin(2 pi (phase + modulation / 2 pi)).
+static void
+render_operator(double* const outputs, double* const phases, const double* const increments, double* const gains, const double* const gain_steps, const double* const modulations, const int voices)
+{
+    const double turns = 1. / (2. * M_PI);
+    int voice = 0;
+
+#if defined(__SSE2__)
+    const __m128d one = _mm_set1_pd(1.), half = _mm_set1_pd(.5), minus_half = _mm_set1_pd(-.5);
+    for (; voice + 2 <= voices; voice += 2) {
+        const __m128d phase = _mm_loadu_pd(phases + voice);
+        __m128d x = _mm_add_pd(phase, _mm_mul_pd(_mm_loadu_pd(modulations + voice), _mm_set1_pd(turns)));
+        x = _mm_sub_pd(x, _mm_cvtepi32_pd(_mm_cvtpd_epi32(x))); // [-1 / 2, 1 / 2].
+        x = _mm_min_pd(x, _mm_sub_pd(half, x)); // Folded on [-1 / 4, 1 / 4].
+        x = _mm_max_pd(x, _mm_sub_pd(minus_half, x));
+        const __m128d z = _mm_mul_pd(x, _mm_set1_pd(S1)), z2 = _mm_mul_pd(z, z);
+        __m128d sine = _mm_add_pd(_mm_set1_pd(S11), _mm_mul_pd(z2, _mm_set1_pd(S13)));
+        sine = _mm_add_pd(_mm_set1_pd(S9), _mm_mul_pd(z2, sine));
+        sine = _mm_add_pd(_mm_set1_pd(S7), _mm_mul_pd(z2, sine));
+        sine = _mm_add_pd(_mm_set1_pd(S5), _mm_mul_pd(z2, sine));
+        sine = _mm_add_pd(_mm_set1_pd(S3), _mm_mul_pd(z2, sine));
+        sine = _mm_mul_pd(z, _mm_add_pd(one, _mm_mul_pd(z2, sine)));
+
+        const __m128d gain = _mm_loadu_pd(gains + voice);
+        _mm_storeu_pd(outputs + voice, _mm_mul_pd(gain, sine));
+        _mm_storeu_pd(gains + voice, _mm_add_pd(gain, _mm_loadu_pd(gain_steps + voice)));
+        const __m128d next = _mm_add_pd(phase, _mm_loadu_pd(increments + voice));
+        _mm_storeu_pd(phases + voice, _mm_sub_pd(next, _mm_and_pd(_mm_cmpge_pd(next, one), one)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t one = vdupq_n_f64(1.), half = vdupq_n_f64(.5), minus_half = vdupq_n_f64(-.5);
+    for (; voice + 2 <= voices; voice += 2) {
+        const float64x2_t phase = vld1q_f64(phases + voice);
+        float64x2_t x = vfmaq_n_f64(phase, vld1q_f64(modulations + voice), turns);
+        x = vsubq_f64(x, vrndnq_f64(x)); // [-1 / 2, 1 / 2].
+        x = vminq_f64(x, vsubq_f64(half, x)); // Folded on [-1 / 4, 1 / 4].
+        x = vmaxq_f64(x, vsubq_f64(minus_half, x));
+        const float64x2_t z = vmulq_n_f64(x, S1), z2 = vmulq_f64(z, z);
+        float64x2_t sine = vfmaq_n_f64(vdupq_n_f64(S11), z2, S13);
+        sine = vfmaq_f64(vdupq_n_f64(S9), z2, sine);
+        sine = vfmaq_f64(vdupq_n_f64(S7), z2, sine);
+        sine = vfmaq_f64(vdupq_n_f64(S5), z2, sine);
+        sine = vfmaq_f64(vdupq_n_f64(S3), z2, sine);
+        sine = vmulq_f64(z, vfmaq_f64(one, z2, sine));
+
+        const float64x2_t gain = vld1q_f64(gains + voice);
+        vst1q_f64(outputs + voice, vmulq_f64(gain, sine));
+        vst1q_f64(gains + voice, vaddq_f64(gain, vld1q_f64(gain_steps + voice)));
+        const float64x2_t next = vaddq_f64(phase, vld1q_f64(increments + voice));
+        vst1q_f64(phases + voice, vbslq_f64(vcgeq_f64(next, one), vsubq_f64(next, one), next));
+    }
+#endif
+
+    for (; voice < voices; voice++) {
+        double x = phases[voice] + modulations[voice] * turns;
+        x -= nearbyint(x);
+        x = fmin(x, .5 - x);
+        x = fmax(x, -.5 - x);
+        const double z = S1 * x, z2 = z * z;
+        const double sine = z * (1. + z2 * (S3 + z2 * (S5 + z2 * (S7 + z2 * (S9 + z2 * (S11 + z2 * S13))))));
+        outputs[voice] = gains[voice] * sine;
+        gains[voice] += gain_steps[voice];
+        phases[voice] += increments[voice];
+        if (phases[voice] >= 1.)
+            phases[voice] -= 1.;
+    }
+}
+
+// Moves an envelope forward by some time (seconds).
+static double
+advance_envelope(const fm_operator* const operator, int* const stage, double level, double time)
+{
+    while (time > 0.) {
+        double left; // Time to the end of the stage.
+        switch (*stage) {
+        case ATTACK:
+            left = (1. - level) * operator->attack;
+            if (left > time) {
+                level += time / operator->attack;
+                return level;
+            }
+            level = 1.;
+            *stage = DECAY;
+            break;
+        case DECAY:
+            left = operator->sustain < 1. ? (level - operator->sustain) / (1. - operator->sustain) * operator->decay : 0.;
+            if (left > time) {
+                level -= time * (1. - operator->sustain) / operator->decay;
+                return level;
+            }
+            level = operator->sustain;
+            *stage = SUSTAIN;
+            break;
+        case RELEASE:
+            left = level * operator->release;
+            if (left > time) {
+                level -= time / operator->release;
+                return level;
+            }
+            level = 0.;
+            *stage = IDLE;
+            break;
+        default: // Held.
+            return *stage == SUSTAIN ? operator->sustain : 0.;
+        }
+        time -= left;
+    }
+    return level;
+}
+
+// Evaluates the envelopes at the end of a block, and sets the gain ramps to them.
+static void
+prepare_block(fm_engine* const engine, const int n)
+{
+    const fm_algorithm* const algorithm = &fm_algorithms[engine->patch.algorithm];
+    const double time = n / engine->sample_rate;
+    for (int op = 0; op < FM_OPERATORS; op++) {
+        const fm_operator* const operator = &engine->patch.operators[op];
+        const int carrier = (algorithm->carriers & OPERATOR(op)) != 0;
+        for (int voice = 0; voice < engine->voices; voice++) {
+            const int i = op * engine->voices + voice;
+            engine->envelopes[i] = advance_envelope(operator, &engine->stages[i], engine->envelopes[i], time);
+            const double gain = engine->envelopes[i] * operator->level * (carrier ? engine->velocities[voice] : 1.);
+            engine->gain_steps[i] = (gain - engine->gains[i]) / n;
+        }
+    }
+}
+
+static double
+render_sample(fm_engine* const engine)
+{
+    const fm_algorithm* const algorithm = &fm_algorithms[engine->patch.algorithm];
+    const int voices = engine->voices;
+    double* const modulations = engine->modulations;
+    double value = 0.;
+
+    for (int op = FM_OPERATORS - 1; op >= 0; op--) {
+        double* const outputs = engine->outputs + op * voices;
+        if (op == FM_OPERATORS - 1) {
+            const double feedback = .5 * engine->patch.feedback;
+            for (int voice = 0; voice < voices; voice++) {
+                modulations[voice] = feedback * (outputs[voice] + engine->feedbacks[voice]);
+                engine->feedbacks[voice] = outputs[voice];
+            }
+        } else {
+            memset(modulations, 0, voices * sizeof(double));
+            for (int modulator = op + 1; modulator < FM_OPERATORS; modulator++)
+                if (algorithm->modulators[op] & OPERATOR(modulator))
+                    for (int voice = 0; voice < voices; voice++)
+                        modulations[voice] += engine->outputs[modulator * voices + voice];
+        }
+
+        const int i = op * voices;
+        render_operator(outputs, engine->phases + i, engine->increments + i, engine->gains + i, engine->gain_steps + i, modulations, voices);
+        if (algorithm->carriers & OPERATOR(op))
+            for (int voice = 0; voice < voices; voice++)
+                value += outputs[voice];
+    }
+    return value;
+}
+
+fm_engine* fm_engine_create(const fm_patch* const patch, const int voices, const double sample_rate)
+{
+    fm_engine* const engine = malloc(sizeof(fm_engine));
+    if (engine == NULL)
+        return NULL;
+
+    const int values = FM_OPERATORS * voices;
+    engine->patch = *patch;
+    engine->voices = voices;
+    engine->sample_rate = sample_rate;
+    engine->notes = 0;
+    engine->velocities = calloc(voices, sizeof(double));
+    engine->starts = calloc(voices, sizeof(long));
+    engine->phases = calloc(values, sizeof(double));
+    engine->increments = calloc(values, sizeof(double));
+    engine->envelopes = calloc(values, sizeof(double));
+    engine->stages = calloc(values, sizeof(int)); // IDLE.
+    engine->gains = calloc(values, sizeof(double));
+    engine->gain_steps = calloc(values, sizeof(double));
+    engine->outputs = calloc(values, sizeof(double));
+    engine->feedbacks = calloc(voices, sizeof(double));
+    engine->modulations = calloc(voices, sizeof(double));
+    if (engine->velocities == NULL || engine->starts == NULL || engine->phases == NULL || engine->increments == NULL
+        || engine->envelopes == NULL || engine->stages == NULL || engine->gains == NULL || engine->gain_steps == NULL
+        || engine->outputs == NULL || engine->feedbacks == NULL || engine->modulations == NULL) {
+        fm_engine_destroy(engine);
+        return NULL;
+    }
+    return engine;
+}
+
+int fm_engine_note_on(fm_engine* const engine, const double frequency, const double velocity)
+{
+    // A voice all the operators of which are idle, or the oldest one.
+    int chosen = 0;
+    for (int voice = 0; voice < engine->voices; voice++) {
+        int idle = 1;
+        for (int op = 0; op < FM_OPERATORS; op++)
+            if (engine->stages[op * engine->voices + voice] != IDLE)
+                idle = 0;
+        if (idle) {
+            chosen = voice;
+            break;
+        }
+        if (engine->starts[voice] < engine->starts[chosen])
+            chosen = voice;
+    }
+
+    engine->velocities[chosen] = velocity;
+    engine->starts[chosen] = engine->notes++;
+    engine->feedbacks[chosen] = 0.;
+    for (int op = 0; op < FM_OPERATORS; op++) {
+        const int i = op * engine->voices + chosen;
+        engine->phases[i] = 0.;
+        engine->increments[i] = fmod(engine->patch.operators[op].ratio * frequency / engine->sample_rate, 1.);
+        engine->stages[i] = ATTACK;
+        engine->outputs[i] = 0.;
+    }
+    return chosen;
+}
+
+void fm_engine_note_off(fm_engine* const engine, const int voice)
+{
+    for (int op = 0; op < FM_OPERATORS; op++) {
+        int* const stage = &engine->stages[op * engine->voices + voice];
+        if (*stage != IDLE)
+            *stage = RELEASE;
+    }
+}
+
+void fm_engine_render(fm_engine* const engine, double* const output, const int n)
+{
+    for (int start = 0; start < n; start += FM_BLOCK_SIZE) {
+        const int size = n - start < FM_BLOCK_SIZE ? n - start : FM_BLOCK_SIZE;
+        prepare_block(engine, size);
+        for (int sample = 0; sample < size; sample++)
+            output[start + sample] = render_sample(engine);
+    }
+}
+
+void fm_engine_destroy(fm_engine* const engine)
+{
+    if (engine == NULL)
+        return;
+
+    free(engine->velocities);
+    free(engine->starts);
+    free(engine->phases);
+    free(engine->increments);
+    free(engine->envelopes);
+    free(engine->stages);
+    free(engine->gains);
+    free(engine->gain_steps);
+    free(engine->outputs);
+    free(engine->feedbacks);
+    free(engine->modulations);
+    free(engine);
+}
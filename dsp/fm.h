@@ -0,0 +1,112 @@
+#ifndef FM_H
+#define FM_H
+
+/*
+ * Polyphonic FM (phase modulation) synthesizer.
+ *
+ * Each voice runs FM_OPERATORS sine operators, wired by an algorithm as in
+ * the 4-operator Yamaha synthesizers: an operator is phase modulated by the
+ * sum of the outputs of its modulators (always operators of higher index, so
+ * operators are computed from the last to the first), and the voice outputs
+ * the sum of its carriers. The last operator can modulate itself (feedback,
+ * through the average of its last two outputs). The output level of a
+ * modulator is its modulation index (radians), the one of a carrier its
+ * amplitude. Every operator has its own linear ADSR envelope.
+ *
+ * Voices are stored as arrays of each operator field, and each sample of an
+ * operator is computed for all the voices at once (SSE2 or NEON, 2 voices at a
+ * time), with a polynomial sine (error below 1e-9) since phase modulation rules
+ * out rotating phasors. Phases are continuous across blocks. Envelopes are
+ * evaluated every FM_BLOCK_SIZE samples, and ramped linearly in between.
+ */
+
+#define FM_OPERATORS 4
+#define FM_ALGORITHMS 8
+#define FM_BLOCK_SIZE 64 // Samples between envelope evaluations.
+
+typedef struct fm_algorithm {
+    unsigned modulators[FM_OPERATORS]; // Bit mask of the modulators of each operator.
+    unsigned carriers; // Bit mask of the operators heard.
+} fm_algorithm;
+
+extern const fm_algorithm fm_algorithms[FM_ALGORITHMS];
+
+typedef struct fm_operator {
+    double ratio; // Frequency, relative to the note.
+    double level; // Modulation index (radians) or amplitude.
+    double attack; // Seconds from 0 to 1.
+    double decay; // Seconds from 1 to the sustain level.
+    double sustain; // Level held until the note is released.
+    double release; // Seconds from 1 to 0.
+} fm_operator;
+
+typedef struct fm_patch {
+    int algorithm; // Index in fm_algorithms.
+    double feedback; // Self modulation index of the last operator.
+    fm_operator operators[FM_OPERATORS];
+} fm_patch;
+
+typedef struct fm_engine {
+    fm_patch patch;
+    int voices; // Number of voices.
+    double sample_rate;
+    long notes; // Number of notes started.
+    double* velocities; // voices values.
+    long* starts; // voices note numbers, to steal the oldest voice.
+    // FM_OPERATORS * voices values, operator by operator.
+    double* phases; // Fractions of a period.
+    double* increments;
+    double* envelopes;
+    int* stages;
+    double* gains; // Per block state.
+    double* gain_steps;
+    double* outputs; // Last output of each operator.
+    double* feedbacks; // voices outputs of the last operator before the last one.
+    double* modulations; // voices values, scratch.
+} fm_engine;
+
+/**
+ * @brief Creates an FM engine, all the voices silent.
+ *
+ * @param patch The patch (copied).
+ * @param voices The number of voices.
+ * @param sample_rate The sample rate (Hz).
+ * @return The engine, or NULL if the allocation failed.
+ */
+fm_engine* fm_engine_create(const fm_patch* const patch, const int voices, const double sample_rate);
+
+/**
+ * @brief Starts a note, on a silent voice or else on the oldest one.
+ *
+ * @param engine The engine.
+ * @param frequency The frequency of the note (Hz).
+ * @param velocity The gain of the carriers.
+ * @return The voice playing the note.
+ */
+int fm_engine_note_on(fm_engine* const engine, const double frequency, const double velocity);
+
+/**
+ * @brief Releases the note of a voice.
+ *
+ * @param engine The engine.
+ * @param voice The voice.
+ */
+void fm_engine_note_off(fm_engine* const engine, const int voice);
+
+/**
+ * @brief Renders the sum of all the voices.
+ *
+ * @param engine The engine.
+ * @param output The samples (n values, overwritten).
+ * @param n The number of samples.
+ */
+void fm_engine_render(fm_engine* const engine, double* const output, const int n);
+
+/**
+ * @brief Destroys an FM engine.
+ *
+ * @param engine The engine.
+ */
+void fm_engine_destroy(fm_engine* const engine);
+
+#endif // FM_H
@@ -0,0 +1,57 @@
+#include "frame.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void
+write_span(frame_assembler* const assembler, const double* const samples, const int n)
+{
+    memcpy(assembler->samples + assembler->position, samples, n * sizeof(double));
+    memcpy(assembler->samples + assembler->position + assembler->frame_size, samples, n * sizeof(double));
+
+    assembler->position += n;
+    if (assembler->position == assembler->frame_size)
+        assembler->position = 0;
+}
+
+frame_assembler* frame_assembler_create(const int frame_size)
+{
+    frame_assembler* const assembler = malloc(sizeof(frame_assembler));
+    if (assembler == NULL)
+        return NULL;
+
+    assembler->samples = calloc(2 * frame_size, sizeof(double));
+    if (assembler->samples == NULL) {
+        free(assembler);
+        return NULL;
+    }
+
+    assembler->frame_size = frame_size;
+    assembler->position = 0;
+    return assembler;
+}
+
+void frame_assembler_push(frame_assembler* const assembler, const double* const samples, const int n)
+{
+    // Only the last frame_size samples can still be part of the frame.
+    const int skipped = n > assembler->frame_size ? n - assembler->frame_size : 0;
+    const int count = n - skipped;
+
+    const int head = count < assembler->frame_size - assembler->position ? count : assembler->frame_size - assembler->position;
+    write_span(assembler, samples + skipped, head);
+    write_span(assembler, samples + skipped + head, count - head);
+}
+
+const double* frame_assembler_get_frame(const frame_assembler* const assembler)
+{
+    return assembler->samples + assembler->position;
+}
+
+void frame_assembler_destroy(frame_assembler* const assembler)
+{
+    if (assembler == NULL)
+        return;
+
+    free(assembler->samples);
+    free(assembler);
+}
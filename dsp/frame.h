@@ -0,0 +1,52 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+/*
+ * Overlapped frame assembler.
+ *
+ * The last frame_size samples pushed are kept in a mirrored ring buffer: each
+ * sample is stored twice, frame_size apart, so the current frame is always a
+ * contiguous view into the buffer. A hop only costs the new samples, whatever
+ * the hop/frame ratio.
+ */
+
+typedef struct frame_assembler {
+    double* samples; // Mirrored ring buffer of 2 * frame_size samples.
+    int frame_size;
+    int position; // Index of the oldest sample of the current frame.
+} frame_assembler;
+
+/**
+ * @brief Creates a frame assembler, with a frame full of zeros.
+ *
+ * @param frame_size The frame size.
+ * @return The frame assembler, or NULL if the allocation failed.
+ */
+frame_assembler* frame_assembler_create(const int frame_size);
+
+/**
+ * @brief Pushes new samples into the frame, dropping the oldest ones.
+ *
+ * @param assembler The frame assembler.
+ * @param samples The new samples (usually a hop).
+ * @param n The number of new samples, any value (not only the hop size).
+ */
+void frame_assembler_push(frame_assembler* const assembler, const double* const samples, const int n);
+
+/**
+ * @brief Gets the current frame.
+ *
+ * @param assembler The frame assembler.
+ * @return A read-only view of the last frame_size samples pushed, oldest first,
+ * valid until the next push.
+ */
+const double* frame_assembler_get_frame(const frame_assembler* const assembler);
+
+/**
+ * @brief Destroys a frame assembler.
+ *
+ * @param assembler The frame assembler.
+ */
+void frame_assembler_destroy(frame_assembler* const assembler);
+
+#endif // FRAME_H
@@ -0,0 +1,59 @@
+#include "goertzel.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+goertzel_bank* goertzel_bank_create(const double* const frequencies, const int count, const double sample_rate)
+{
+    goertzel_bank* const bank = malloc(sizeof(goertzel_bank));
+    if (bank == NULL)
+        return NULL;
+
+    bank->count = count;
+    bank->frequencies = malloc(count * sizeof(double));
+    bank->coefficients = malloc(count * sizeof(double));
+    if (bank->frequencies == NULL || bank->coefficients == NULL) {
+        goertzel_bank_destroy(bank);
+        return NULL;
+    }
+
+    memcpy(bank->frequencies, frequencies, count * sizeof(double));
+    for (int i = 0; i < count; i++)
+        bank->coefficients[i] = 2. * cos(2. * M_PI * frequencies[i] / sample_rate);
+    return bank;
+}
+
+void goertzel_bank_power(const goertzel_bank* const bank, double* const powers, const double* const frame, const int n)
+{
+    const int count = bank->count;
+    const double* const coefficients = bank->coefficients;
+    double previous[count], before[count];
+    for (int i = 0; i < count; i++)
+        previous[i] = before[i] = 0.;
+
+    // The resonators are independent, so the inner loop vectorizes.
+    for (int sample = 0; sample < n; sample++) {
+        const double x = frame[sample];
+        for (int i = 0; i < count; i++) {
+            const double current = x + coefficients[i] * previous[i] - before[i];
+            before[i] = previous[i];
+            previous[i] = current;
+        }
+    }
+
+    // |X|^2 = s1^2 + s2^2 - c s1 s2, scaled so a sinusoid of amplitude A gives A^2 / 2.
+    const double scale = 2. / ((double)n * n);
+    for (int i = 0; i < count; i++)
+        powers[i] = scale * (previous[i] * previous[i] + before[i] * before[i] - coefficients[i] * previous[i] * before[i]);
+}
+
+void goertzel_bank_destroy(goertzel_bank* const bank)
+{
+    if (bank == NULL)
+        return;
+
+    free(bank->frequencies);
+    free(bank->coefficients);
+    free(bank);
+}
@@ -0,0 +1,50 @@
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+/*
+ * Goertzel filter bank.
+ *
+ * Measures the power of a signal at a few given frequencies, each through a
+ * second order resonator: N multiply-adds per frequency instead of a whole
+ * N log N transform (worth it below ~log2(N) frequencies). Frequencies do not
+ * have to fall on an FFT bin. All the resonators run in the same pass over the
+ * frame.
+ */
+
+typedef struct goertzel_bank {
+    int count; // Number of frequencies.
+    double* frequencies; // count frequencies (Hz).
+    double* coefficients; // count 2 cos(2 pi f / sample_rate) coefficients.
+} goertzel_bank;
+
+/**
+ * @brief Creates a Goertzel filter bank.
+ *
+ * @param frequencies The frequencies (Hz), count values copied.
+ * @param count The number of frequencies.
+ * @param sample_rate The sample rate (Hz).
+ * @return The filter bank, or NULL if the allocation failed.
+ */
+goertzel_bank* goertzel_bank_create(const double* const frequencies, const int count, const double sample_rate);
+
+/**
+ * @brief Computes the power of a frame at each frequency of the bank.
+ *
+ * The power is normalized as an energy: a sinusoid of amplitude A at one of the
+ * frequencies gives A^2 / 2, like its share of sum(x^2) / n.
+ *
+ * @param bank The filter bank.
+ * @param powers The powers (count values).
+ * @param frame The frame.
+ * @param n The number of samples of the frame.
+ */
+void goertzel_bank_power(const goertzel_bank* const bank, double* const powers, const double* const frame, const int n);
+
+/**
+ * @brief Destroys a Goertzel filter bank.
+ *
+ * @param bank The filter bank.
+ */
+void goertzel_bank_destroy(goertzel_bank* const bank);
+
+#endif // GOERTZEL_H
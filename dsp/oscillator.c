@@ -0,0 +1,186 @@
+#include "oscillator.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define FIELDS 11 // Arrays of the bank, allocated at once.
+
+oscillator_bank* oscillator_bank_create(const int capacity, const double sample_rate)
+{
+    oscillator_bank* const bank = malloc(sizeof(oscillator_bank));
+    if (bank == NULL)
+        return NULL;
+
+    double* const fields = malloc(FIELDS * capacity * sizeof(double));
+    if (fields == NULL) {
+        free(bank);
+        return NULL;
+    }
+
+    bank->count = 0;
+    bank->capacity = capacity;
+    bank->sample_rate = sample_rate;
+    double** const arrays[FIELDS] = {
+        &bank->amplitudes, &bank->frequencies, &bank->target_amplitudes, &bank->target_frequencies,
+        &bank->cosines, &bank->sines, &bank->step_cosines, &bank->step_sines,
+        &bank->amplitude_steps, &bank->glide_cosines, &bank->glide_sines
+    };
+    for (int field = 0; field < FIELDS; field++)
+        *arrays[field] = fields + field * capacity;
+    return bank;
+}
+
+int oscillator_bank_add(oscillator_bank* const bank, const double amplitude, const double frequency, const double phase)
+{
+    if (bank->count == bank->capacity)
+        return -1;
+
+    const int index = bank->count++;
+    const double step = 2. * M_PI * frequency / bank->sample_rate;
+    bank->amplitudes[index] = bank->target_amplitudes[index] = amplitude;
+    bank->frequencies[index] = bank->target_frequencies[index] = frequency;
+    bank->cosines[index] = cos(phase);
+    bank->sines[index] = sin(phase);
+    bank->step_cosines[index] = cos(step);
+    bank->step_sines[index] = sin(step);
+    return index;
+}
+
+void oscillator_bank_set(oscillator_bank* const bank, const int index, const double amplitude, const double frequency)
+{
+    bank->target_amplitudes[index] = amplitude;
+    bank->target_frequencies[index] = frequency;
+}
+
+void oscillator_bank_tune(oscillator_bank* const bank, const int index, const double frequency)
+{
+    const double step = 2. * M_PI * frequency / bank->sample_rate;
+    bank->frequencies[index] = bank->target_frequencies[index] = frequency;
+    bank->step_cosines[index] = cos(step);
+    bank->step_sines[index] = sin(step);
+}
+
+void oscillator_bank_clear(oscillator_bank* const bank)
+{
+    bank->count = 0;
+}
+
+// Computes the current sample of all the partials, then moves them to the next one.
+static double
+render_sample(oscillator_bank* const bank, const int gliding)
+{
+    double* const amplitudes = bank->amplitudes;
+    double* const cosines = bank->cosines;
+    double* const sines = bank->sines;
+    double* const step_cosines = bank->step_cosines;
+    double* const step_sines = bank->step_sines;
+    const double* const amplitude_steps = bank->amplitude_steps;
+    const double* const glide_cosines = bank->glide_cosines;
+    const double* const glide_sines = bank->glide_sines;
+    const int count = bank->count;
+    double value = 0.;
+    int partial = 0;
+
+#if defined(__SSE2__)
+    __m128d sum = _mm_setzero_pd();
+    for (; partial + 2 <= count; partial += 2) {
+        const __m128d amplitude = _mm_loadu_pd(amplitudes + partial);
+        const __m128d c = _mm_loadu_pd(cosines + partial), s = _mm_loadu_pd(sines + partial);
+        const __m128d step_c = _mm_loadu_pd(step_cosines + partial), step_s = _mm_loadu_pd(step_sines + partial);
+        sum = _mm_add_pd(sum, _mm_mul_pd(amplitude, s));
+        _mm_storeu_pd(cosines + partial, _mm_sub_pd(_mm_mul_pd(c, step_c), _mm_mul_pd(s, step_s)));
+        _mm_storeu_pd(sines + partial, _mm_add_pd(_mm_mul_pd(s, step_c), _mm_mul_pd(c, step_s)));
+        _mm_storeu_pd(amplitudes + partial, _mm_add_pd(amplitude, _mm_loadu_pd(amplitude_steps + partial)));
+        if (gliding) {
+            const __m128d glide_c = _mm_loadu_pd(glide_cosines + partial), glide_s = _mm_loadu_pd(glide_sines + partial);
+            _mm_storeu_pd(step_cosines + partial, _mm_sub_pd(_mm_mul_pd(step_c, glide_c), _mm_mul_pd(step_s, glide_s)));
+            _mm_storeu_pd(step_sines + partial, _mm_add_pd(_mm_mul_pd(step_s, glide_c), _mm_mul_pd(step_c, glide_s)));
+        }
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, sum);
+    value = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t sum = vdupq_n_f64(0.);
+    for (; partial + 2 <= count; partial += 2) {
+        const float64x2_t amplitude = vld1q_f64(amplitudes + partial);
+        const float64x2_t c = vld1q_f64(cosines + partial), s = vld1q_f64(sines + partial);
+        const float64x2_t step_c = vld1q_f64(step_cosines + partial), step_s = vld1q_f64(step_sines + partial);
+        sum = vfmaq_f64(sum, amplitude, s);
+        vst1q_f64(cosines + partial, vfmsq_f64(vmulq_f64(c, step_c), s, step_s));
+        vst1q_f64(sines + partial, vfmaq_f64(vmulq_f64(s, step_c), c, step_s));
+        vst1q_f64(amplitudes + partial, vaddq_f64(amplitude, vld1q_f64(amplitude_steps + partial)));
+        if (gliding) {
+            const float64x2_t glide_c = vld1q_f64(glide_cosines + partial), glide_s = vld1q_f64(glide_sines + partial);
+            vst1q_f64(step_cosines + partial, vfmsq_f64(vmulq_f64(step_c, glide_c), step_s, glide_s));
+            vst1q_f64(step_sines + partial, vfmaq_f64(vmulq_f64(step_s, glide_c), step_c, glide_s));
+        }
+    }
+    value = vaddvq_f64(sum);
+#endif
+
+    for (; partial < count; partial++) {
+        const double c = cosines[partial], s = sines[partial];
+        const double step_c = step_cosines[partial], step_s = step_sines[partial];
+        value += amplitudes[partial] * s;
+        cosines[partial] = c * step_c - s * step_s;
+        sines[partial] = s * step_c + c * step_s;
+        amplitudes[partial] += amplitude_steps[partial];
+        if (gliding) {
+            step_cosines[partial] = step_c * glide_cosines[partial] - step_s * glide_sines[partial];
+            step_sines[partial] = step_s * glide_cosines[partial] + step_c * glide_sines[partial];
+        }
+    }
+    return value;
+}
+
+void oscillator_bank_render(oscillator_bank* const bank, double* const output, const int n)
+{
+    if (n <= 0)
+        return;
+
+    // Linear ramps: the amplitude moves by a step, the rotation step by a rotation, every sample.
+    int gliding = 0;
+    for (int partial = 0; partial < bank->count; partial++) {
+        bank->amplitude_steps[partial] = (bank->target_amplitudes[partial] - bank->amplitudes[partial]) / n;
+        const double glide = 2. * M_PI * (bank->target_frequencies[partial] - bank->frequencies[partial]) / bank->sample_rate / n;
+        bank->glide_cosines[partial] = cos(glide);
+        bank->glide_sines[partial] = sin(glide);
+        if (glide != 0.)
+            gliding = 1;
+    }
+
+    for (int sample = 0; sample < n; sample++)
+        output[sample] = render_sample(bank, gliding);
+
+    for (int partial = 0; partial < bank->count; partial++) {
+        bank->amplitudes[partial] = bank->target_amplitudes[partial];
+        if (bank->frequencies[partial] != bank->target_frequencies[partial]) {
+            const double step = 2. * M_PI * bank->target_frequencies[partial] / bank->sample_rate;
+            bank->frequencies[partial] = bank->target_frequencies[partial];
+            bank->step_cosines[partial] = cos(step);
+            bank->step_sines[partial] = sin(step);
+        }
+
+        // Back on the unit circle, to first order: 1 / sqrt(x) ~ (3 - x) / 2 near 1.
+        const double c = bank->cosines[partial], s = bank->sines[partial];
+        const double gain = .5 * (3. - (c * c + s * s));
+        bank->cosines[partial] = gain * c;
+        bank->sines[partial] = gain * s;
+    }
+}
+
+void oscillator_bank_destroy(oscillator_bank* const bank)
+{
+    if (bank == NULL)
+        return;
+
+    free(bank->amplitudes); // All the arrays.
+    free(bank);
+}
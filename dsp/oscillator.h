@@ -0,0 +1,98 @@
+#ifndef OSCILLATOR_H
+#define OSCILLATOR_H
+
+/*
+ * Sinusoidal oscillator bank.
+ *
+ * Each partial is a phasor (cos, sin) rotated by a fixed step every sample:
+ * 4 multiplies and 2 adds instead of a sin() call, and no phase recomputed
+ * from the sample index. The partials are stored as arrays of each field
+ * (structure of arrays), so one sample of all the partials is computed with
+ * vector instructions (SSE2 or NEON), 2 partials at a time.
+ *
+ * Amplitudes and frequencies change through targets, reached by a linear ramp
+ * over the next rendered block. A frequency ramp rotates the step itself every
+ * sample, so the phase stays continuous. The phasors drift by a few ulps per
+ * sample, and are renormalized after each block.
+ */
+
+typedef struct oscillator_bank {
+    int count; // Number of partials.
+    int capacity; // Largest number of partials.
+    double sample_rate;
+    double* amplitudes;
+    double* frequencies; // Hz.
+    double* target_amplitudes; // Reached at the end of the next block.
+    double* target_frequencies;
+    double* cosines; // Phasors.
+    double* sines;
+    double* step_cosines; // Rotations per sample.
+    double* step_sines;
+    double* amplitude_steps; // Per block state.
+    double* glide_cosines;
+    double* glide_sines;
+} oscillator_bank;
+
+/**
+ * @brief Creates an empty oscillator bank.
+ *
+ * @param capacity The largest number of partials.
+ * @param sample_rate The sample rate (Hz).
+ * @return The oscillator bank, or NULL if the allocation failed.
+ */
+oscillator_bank* oscillator_bank_create(const int capacity, const double sample_rate);
+
+/**
+ * @brief Adds a partial to the bank.
+ *
+ * @param bank The oscillator bank.
+ * @param amplitude The amplitude.
+ * @param frequency The frequency (Hz).
+ * @param phase The initial phase (radians, 0 starts as a sine).
+ * @return The index of the partial, or -1 if the bank is full.
+ */
+int oscillator_bank_add(oscillator_bank* const bank, const double amplitude, const double frequency, const double phase);
+
+/**
+ * @brief Sets the amplitude and frequency a partial ramps to over the next block.
+ *
+ * @param bank The oscillator bank.
+ * @param index The index of the partial.
+ * @param amplitude The target amplitude.
+ * @param frequency The target frequency (Hz).
+ */
+void oscillator_bank_set(oscillator_bank* const bank, const int index, const double amplitude, const double frequency);
+
+/**
+ * @brief Changes the frequency of a partial at once, without a glide (e.g. for a silent partial starting a new note).
+ *
+ * @param bank The oscillator bank.
+ * @param index The index of the partial.
+ * @param frequency The frequency (Hz).
+ */
+void oscillator_bank_tune(oscillator_bank* const bank, const int index, const double frequency);
+
+/**
+ * @brief Removes all the partials of the bank.
+ *
+ * @param bank The oscillator bank.
+ */
+void oscillator_bank_clear(oscillator_bank* const bank);
+
+/**
+ * @brief Renders a block: the sum of all the partials.
+ *
+ * @param bank The oscillator bank.
+ * @param output The samples (n values, overwritten).
+ * @param n The number of samples.
+ */
+void oscillator_bank_render(oscillator_bank* const bank, double* const output, const int n);
+
+/**
+ * @brief Destroys an oscillator bank.
+ *
+ * @param bank The oscillator bank.
+ */
+void oscillator_bank_destroy(oscillator_bank* const bank);
+
+#endif // OSCILLATOR_H
@@ -0,0 +1,179 @@
+#include "pitch.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define MIN_PEAK .3 // Lowest normalized autocorrelation of a periodic frame.
+#define OCTAVE_RATIO .9 // Share of the highest peak enough for an earlier peak.
+#define MIN_WINDOW_AUTOCORRELATION 1e-3
+
+#define A4_NOTE 57. // MIDI-like note number of A4, from C0.
+#define A4_FREQUENCY 440.
+
+// Turns the spectrum into its power, then into the autocorrelation (scaled by fft_size) in fft->signal.
+static void
+autocorrelate(real_fft* const fft)
+{
+    for (int bin = 0; bin < fft->bins; bin++) {
+        const double complex value = fft->spectrum[bin];
+        fft->spectrum[bin] = creal(value) * creal(value) + cimag(value) * cimag(value);
+    }
+    real_fft_inverse(fft);
+}
+
+pitch_tracker* pitch_tracker_create(const int frame_size, const int fft_size, const window* const window)
+{
+    pitch_tracker* const tracker = malloc(sizeof(pitch_tracker));
+    if (tracker == NULL)
+        return NULL;
+
+    tracker->frame_size = frame_size;
+    tracker->fft_size = fft_size;
+    tracker->max_lag = frame_size / 2;
+    tracker->fft = real_fft_create(fft_size, REAL_FFT_FORWARD | REAL_FFT_INVERSE);
+    tracker->window_autocorrelation = malloc((tracker->max_lag + 1) * sizeof(double));
+    tracker->lags = malloc((tracker->max_lag + 1) * sizeof(double));
+    tracker->energies = malloc((frame_size + 1) * sizeof(double));
+    if (tracker->fft == NULL || tracker->window_autocorrelation == NULL || tracker->lags == NULL || tracker->energies == NULL) {
+        pitch_tracker_destroy(tracker);
+        return NULL;
+    }
+
+    // The autocorrelation of the window, the same way as the frames'.
+    for (int sample = 0; sample < fft_size; sample++)
+        tracker->fft->signal[sample] = sample >= frame_size ? 0. : window != NULL ? window->weights[sample] : 1.;
+    real_fft_forward(tracker->fft);
+    autocorrelate(tracker->fft);
+    for (int lag = 0; lag <= tracker->max_lag; lag++)
+        tracker->window_autocorrelation[lag] = tracker->fft->signal[lag] / tracker->fft->signal[0];
+    return tracker;
+}
+
+void pitch_autocorrelation(pitch_tracker* const tracker, double* const autocorrelation, const fftw_complex* const spectrum)
+{
+    real_fft* const fft = tracker->fft;
+    for (int bin = 0; bin < fft->bins; bin++)
+        fft->spectrum[bin] = spectrum[bin];
+    autocorrelate(fft);
+
+    const double energy = fft->signal[0];
+    for (int lag = 0; lag <= tracker->max_lag; lag++) {
+        const double weight = tracker->window_autocorrelation[lag];
+        autocorrelation[lag] = energy > 0. && weight > MIN_WINDOW_AUTOCORRELATION ? fft->signal[lag] / (energy * weight) : 0.;
+    }
+}
+
+// Offset of the extremum of the parabola through three values, in [-.5, .5].
+static double
+parabolic_offset(const double left, const double center, const double right)
+{
+    const double curvature = left - 2. * center + right;
+    if (curvature == 0.)
+        return 0.;
+    const double offset = .5 * (left - right) / curvature;
+    return offset < -.5 ? -.5 : offset > .5 ? .5 : offset;
+}
+
+// Clamps the lags of a frequency range to [1, max_lag - 1], so each lag has two neighbours.
+static void
+lag_range(const pitch_tracker* const tracker, const double sample_rate, const double min_frequency, const double max_frequency, int* const min_lag, int* const max_lag)
+{
+    *min_lag = (int)ceil(sample_rate / max_frequency);
+    *max_lag = (int)floor(sample_rate / min_frequency);
+    if (*min_lag < 1)
+        *min_lag = 1;
+    if (*max_lag > tracker->max_lag - 1)
+        *max_lag = tracker->max_lag - 1;
+}
+
+double pitch_autocorrelation_estimate(pitch_tracker* const tracker, const fftw_complex* const spectrum, const double sample_rate, const double min_frequency, const double max_frequency)
+{
+    double* const r = tracker->lags;
+    pitch_autocorrelation(tracker, r, spectrum);
+
+    int min_lag, max_lag;
+    lag_range(tracker, sample_rate, min_frequency, max_frequency, &min_lag, &max_lag);
+
+    // Skip the main lobe around lag 0, up to its first minimum.
+    int start = 1;
+    while (start < max_lag && r[start + 1] < r[start])
+        start++;
+    if (start < min_lag)
+        start = min_lag;
+
+    int highest = -1;
+    for (int lag = start; lag <= max_lag; lag++)
+        if (r[lag] >= r[lag - 1] && r[lag] > r[lag + 1] && (highest < 0 || r[lag] > r[highest]))
+            highest = lag;
+    if (highest < 0 || r[highest] < MIN_PEAK)
+        return 0.;
+
+    // The period is the first peak almost as high, its multiples being as high.
+    int period = highest;
+    for (int lag = start; lag < highest; lag++)
+        if (r[lag] >= r[lag - 1] && r[lag] > r[lag + 1] && r[lag] >= OCTAVE_RATIO * r[highest]) {
+            period = lag;
+            break;
+        }
+
+    return sample_rate / (period + parabolic_offset(r[period - 1], r[period], r[period + 1]));
+}
+
+double pitch_yin(pitch_tracker* const tracker, const double* const frame, const double sample_rate, const double min_frequency, const double max_frequency, const double threshold)
+{
+    const int n = tracker->frame_size;
+    real_fft* const fft = tracker->fft;
+    double* const d = tracker->lags;
+    double* const energies = tracker->energies;
+
+    real_fft_load(fft, frame, n);
+    real_fft_forward(fft);
+    autocorrelate(fft);
+
+    energies[0] = 0.;
+    for (int sample = 0; sample < n; sample++)
+        energies[sample + 1] = energies[sample] + frame[sample] * frame[sample];
+
+    // Difference d(tau) = sum (x[j] - x[j + tau])^2 = energy of x[0, n - tau) + energy of x[tau, n) - 2 r(tau),
+    // normalized by its mean over the lower lags.
+    double sum = 0.;
+    d[0] = 1.;
+    for (int lag = 1; lag <= tracker->max_lag; lag++) {
+        const double difference = energies[n - lag] + energies[n] - energies[lag] - 2. * fft->signal[lag] / tracker->fft_size;
+        sum += difference;
+        d[lag] = sum > 0. ? difference * lag / sum : 1.;
+    }
+
+    int min_lag, max_lag;
+    lag_range(tracker, sample_rate, min_frequency, max_frequency, &min_lag, &max_lag);
+
+    // The period is the bottom of the first dip below the threshold.
+    for (int lag = min_lag; lag <= max_lag; lag++)
+        if (d[lag] < threshold) {
+            while (lag < max_lag && d[lag + 1] < d[lag])
+                lag++;
+            return sample_rate / (lag + parabolic_offset(d[lag - 1], d[lag], d[lag + 1]));
+        }
+    return 0.;
+}
+
+int pitch_class(const double frequency)
+{
+    if (frequency <= 0.)
+        return -1;
+
+    const int note = (int)round(A4_NOTE + 12. * log2(frequency / A4_FREQUENCY));
+    return (note % 12 + 12) % 12;
+}
+
+void pitch_tracker_destroy(pitch_tracker* const tracker)
+{
+    if (tracker == NULL)
+        return;
+
+    real_fft_destroy(tracker->fft);
+    free(tracker->window_autocorrelation);
+    free(tracker->lags);
+    free(tracker->energies);
+    free(tracker);
+}
@@ -0,0 +1,92 @@
+#ifndef PITCH_H
+#define PITCH_H
+
+#include "fft.h"
+#include "window.h"
+
+/*
+ * Pitch tracker.
+ *
+ * Both estimators work on lags up to frame_size / 2 and get the correlations
+ * they need in O(N log N) (Wiener-Khinchin: the autocorrelation is the inverse
+ * FFT of the power spectrum, linear rather than circular once the frame is
+ * zero-padded to at least 2 * frame_size):
+ * - autocorrelation: reuses the spectrum of the windowed frame (e.g. from an
+ *   STFT), and divides its autocorrelation by the window's to undo the taper
+ *   (Boersma). The period is the first peak close to the highest one, past the
+ *   first minimum.
+ * - YIN: the cumulative mean normalized difference of the raw frame, whose
+ *   first dip below a threshold is the period. Less prone to octave errors.
+ * Both refine the period with a parabola through the neighbouring lags.
+ */
+
+typedef struct pitch_tracker {
+    int frame_size;
+    int fft_size; // At least 2 * frame_size.
+    int max_lag; // frame_size / 2.
+    real_fft* fft; // Forward (YIN) and inverse (power spectrum to autocorrelation).
+    double* window_autocorrelation; // max_lag + 1 normalized lags of the window.
+    double* lags; // max_lag + 1 lags of the current frame.
+    double* energies; // frame_size + 1 cumulative energies of the current frame (YIN).
+} pitch_tracker;
+
+/**
+ * @brief Creates a pitch tracker.
+ *
+ * @param frame_size The frame size.
+ * @param fft_size The FFT size of the spectra given to the tracker (at least 2 * frame_size).
+ * @param window The window applied to the frames of the spectra (NULL for a rectangular window).
+ * @return The pitch tracker, or NULL if the allocation failed.
+ */
+pitch_tracker* pitch_tracker_create(const int frame_size, const int fft_size, const window* const window);
+
+/**
+ * @brief Computes the normalized autocorrelation of a frame from its spectrum.
+ *
+ * @param tracker The pitch tracker.
+ * @param autocorrelation The autocorrelation (max_lag + 1 lags, 1 at lag 0, 0 for a silent frame).
+ * @param spectrum The fft_size / 2 + 1 bins of the windowed, zero-padded frame.
+ */
+void pitch_autocorrelation(pitch_tracker* const tracker, double* const autocorrelation, const fftw_complex* const spectrum);
+
+/**
+ * @brief Estimates the fundamental frequency of a frame from the autocorrelation of its spectrum.
+ *
+ * @param tracker The pitch tracker.
+ * @param spectrum The fft_size / 2 + 1 bins of the windowed, zero-padded frame.
+ * @param sample_rate The sample rate (Hz).
+ * @param min_frequency The lowest frequency searched (Hz).
+ * @param max_frequency The highest frequency searched (Hz).
+ * @return The fundamental frequency (Hz), or 0 if the frame is not periodic enough.
+ */
+double pitch_autocorrelation_estimate(pitch_tracker* const tracker, const fftw_complex* const spectrum, const double sample_rate, const double min_frequency, const double max_frequency);
+
+/**
+ * @brief Estimates the fundamental frequency of a frame with YIN.
+ *
+ * @param tracker The pitch tracker.
+ * @param frame The frame_size samples of the frame (not windowed).
+ * @param sample_rate The sample rate (Hz).
+ * @param min_frequency The lowest frequency searched (Hz).
+ * @param max_frequency The highest frequency searched (Hz).
+ * @param threshold The highest normalized difference of a period (~.1 to .2).
+ * @return The fundamental frequency (Hz), or 0 if no period goes below the threshold.
+ */
+double pitch_yin(pitch_tracker* const tracker, const double* const frame, const double sample_rate, const double min_frequency, const double max_frequency, const double threshold);
+
+/**
+ * @brief Gets the pitch class of a frequency (0 for C, 9 for A, 11 for B).
+ *
+ * @param frequency The frequency (Hz).
+ * @return The pitch class, or -1 if the frequency is not positive.
+ */
+int pitch_class(const double frequency);
+
+/**
+ * @brief Destroys a pitch tracker.
+ *
+ * @param tracker The pitch tracker.
+ */
+void pitch_tracker_destroy(pitch_tracker* const tracker);
+
+#endif // PITCH_H
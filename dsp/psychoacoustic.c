@@ -0,0 +1,151 @@
+#include "psychoacoustic.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "spectrum.h"
+
+#define MIN_SPREAD -60. // Spreading below this level (dB) is dropped.
+#define MIN_POWER 1e-20 // Keeps silent bins off log(0).
+#define MIN_HEARING_FREQUENCY 20. // The threshold of hearing diverges at 0 Hz.
+
+static double
+frequency_to_bark(const double frequency)
+{
+    if (frequency <= 500.)
+        return frequency / 100.;
+    return 9. + 4. * log2(frequency / 1000.);
+}
+
+// Absolute threshold of hearing (Terhardt), in dB SPL.
+static double
+hearing_threshold(const double frequency)
+{
+    const double kilohertz = fmax(frequency, MIN_HEARING_FREQUENCY) / 1000.;
+    return 3.64 * pow(kilohertz, -.8) - 6.5 * exp(-.6 * pow(kilohertz - 3.3, 2.)) + 1e-3 * pow(kilohertz, 4.);
+}
+
+// Spreading of a masker over a band distance bark higher (Schroeder), in dB.
+static double
+spreading(const double bark)
+{
+    const double shifted = bark + .474;
+    return 15.81 + 7.5 * shifted - 17.5 * sqrt(1. + shifted * shifted);
+}
+
+psychoacoustic_model* psychoacoustic_model_create(const int fft_size, const double sample_rate)
+{
+    psychoacoustic_model* const model = calloc(1, sizeof(psychoacoustic_model));
+    if (model == NULL)
+        return NULL;
+
+    const int bins = fft_size / 2 + 1;
+    model->fft_size = fft_size;
+    model->bins = bins;
+    model->sample_rate = sample_rate;
+    model->bands = (int)frequency_to_bark(sample_rate / 2.) + 1;
+    const int bands = model->bands;
+
+    model->frequencies = malloc(bins * sizeof(double));
+    model->barks = malloc(bins * sizeof(double));
+    model->hearing_threshold = malloc(bins * sizeof(double));
+    model->band_of_bin = malloc(bins * sizeof(int));
+    model->band_sizes = calloc(bands, sizeof(int));
+    model->spread_offsets = malloc((bands + 1) * sizeof(int));
+    model->spread_maskers = malloc(bands * bands * sizeof(int)); // At most dense.
+    model->spread_weights = malloc(bands * bands * sizeof(double));
+    model->band_powers = malloc(bands * sizeof(double));
+    model->band_thresholds = malloc(bands * sizeof(double));
+    model->loudness = malloc(bins * sizeof(double));
+    model->masking_threshold = malloc(bins * sizeof(double));
+    if (model->frequencies == NULL || model->barks == NULL || model->hearing_threshold == NULL || model->band_of_bin == NULL || model->band_sizes == NULL
+        || model->spread_offsets == NULL || model->spread_maskers == NULL || model->spread_weights == NULL || model->band_powers == NULL || model->band_thresholds == NULL
+        || model->loudness == NULL || model->masking_threshold == NULL) {
+        psychoacoustic_model_destroy(model);
+        return NULL;
+    }
+
+    for (int bin = 0; bin < bins; bin++) {
+        model->frequencies[bin] = bin * sample_rate / fft_size;
+        model->barks[bin] = frequency_to_bark(model->frequencies[bin]);
+        model->hearing_threshold[bin] = hearing_threshold(model->frequencies[bin]);
+        model->band_of_bin[bin] = (int)model->barks[bin];
+        model->band_sizes[model->band_of_bin[bin]]++;
+    }
+
+    // Rows are maskee bands, normalized so that a flat spectrum spreads to itself.
+    int entries = 0;
+    for (int maskee = 0; maskee < bands; maskee++) {
+        model->spread_offsets[maskee] = entries;
+        double sum = 0.;
+        for (int masker = 0; masker < bands; masker++) {
+            const double level = spreading(maskee - masker);
+            if (level < MIN_SPREAD)
+                continue;
+            model->spread_maskers[entries] = masker;
+            model->spread_weights[entries] = pow(10., level / 10.);
+            sum += model->spread_weights[entries];
+            entries++;
+        }
+        for (int entry = model->spread_offsets[maskee]; entry < entries; entry++)
+            model->spread_weights[entry] /= sum;
+    }
+    model->spread_offsets[bands] = entries;
+    return model;
+}
+
+void psychoacoustic_model_analyze(psychoacoustic_model* const model, const fftw_complex* const spectrum, const double scale)
+{
+    const int bins = model->bins;
+    const int bands = model->bands;
+    double* const powers = model->masking_threshold; // Reused until the thresholds are computed.
+
+    // Loudness, band powers and spectral flatness (geometric over arithmetic mean).
+    spectrum_power(powers, spectrum, bins, scale * scale);
+    for (int band = 0; band < bands; band++)
+        model->band_powers[band] = 0.;
+    double log_sum = 0., sum = 0.;
+    for (int bin = 0; bin < bins; bin++) {
+        const double power = powers[bin] + MIN_POWER;
+        const double level = 10. * log10(power);
+        model->loudness[bin] = level;
+        model->band_powers[model->band_of_bin[bin]] += power;
+        log_sum += level;
+        sum += power;
+    }
+    const double flatness = log_sum / bins - 10. * log10(sum / bins); // dB, 0 for noise.
+    const double tonality = fmin(flatness / -60., 1.);
+
+    // Spread each band over the others, lower it by the masking offset, and share it out among its bins.
+    double* const band_thresholds = model->band_thresholds;
+    for (int maskee = 0; maskee < bands; maskee++) {
+        double spread = 0.;
+        for (int entry = model->spread_offsets[maskee]; entry < model->spread_offsets[maskee + 1]; entry++)
+            spread += model->spread_weights[entry] * model->band_powers[model->spread_maskers[entry]];
+        const double offset = tonality * (14.5 + maskee + 1) + (1. - tonality) * 5.5;
+        band_thresholds[maskee] = 10. * log10(spread / (model->band_sizes[maskee] > 0 ? model->band_sizes[maskee] : 1) + MIN_POWER) - offset;
+    }
+
+    for (int bin = 0; bin < bins; bin++)
+        model->masking_threshold[bin] = fmax(model->hearing_threshold[bin], band_thresholds[model->band_of_bin[bin]]);
+}
+
+void psychoacoustic_model_destroy(psychoacoustic_model* const model)
+{
+    if (model == NULL)
+        return;
+
+    free(model->frequencies);
+    free(model->barks);
+    free(model->hearing_threshold);
+    free(model->band_of_bin);
+    free(model->band_sizes);
+    free(model->spread_offsets);
+    free(model->spread_maskers);
+    free(model->spread_weights);
+    free(model->band_powers);
+    free(model->band_thresholds);
+    free(model->loudness);
+    free(model->masking_threshold);
+    free(model);
+}
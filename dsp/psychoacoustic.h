@@ -0,0 +1,68 @@
+#ifndef PSYCHOACOUSTIC_H
+#define PSYCHOACOUSTIC_H
+
+#include "fft.h"
+
+/*
+ * Psychoacoustic model.
+ *
+ * Everything that only depends on the FFT size and the sample rate is
+ * tabulated once: the frequency and Bark value of each bin, the absolute
+ * threshold of hearing (Terhardt, dB SPL) and the spreading of a masker over
+ * the critical bands (Schroeder), kept as a sparse matrix since a masker
+ * hardly reaches more than ~10 bands above -60 dB. Each frame then only costs
+ * its loudness and its global masking threshold (Johnston):
+ * - bin powers are summed per critical band, then spread across bands with
+ *   one sparse matrix-vector product,
+ * - the spread power is lowered by an offset between 14.5 + band dB (tonal
+ *   masker) and 5.5 dB (noise masker), depending on the spectral flatness,
+ *   then shared out among the bins of the band,
+ * - the global threshold is the highest of that and the threshold of hearing.
+ * Levels are in dB relative to the reference amplitude given to the model.
+ */
+
+typedef struct psychoacoustic_model {
+    int fft_size;
+    int bins; // fft_size / 2 + 1.
+    double sample_rate;
+    double* frequencies; // bins frequencies (Hz).
+    double* barks; // bins Bark values.
+    double* hearing_threshold; // bins absolute thresholds of hearing (dB).
+    int bands; // Number of 1 Bark wide critical bands.
+    int* band_of_bin; // bins band indices.
+    int* band_sizes; // bands numbers of bins.
+    int* spread_offsets; // bands + 1 offsets of the rows of the spreading matrix (CSR).
+    int* spread_maskers; // Masker band of each entry.
+    double* spread_weights; // Power weight of each entry, each row summing to 1.
+    double* band_powers; // bands powers of the current frame.
+    double* band_thresholds; // bands masking thresholds of the current frame (dB, per bin).
+    double* loudness; // bins levels of the current frame (dB).
+    double* masking_threshold; // bins global masking thresholds of the current frame (dB).
+} psychoacoustic_model;
+
+/**
+ * @brief Creates a psychoacoustic model.
+ *
+ * @param fft_size The FFT size.
+ * @param sample_rate The sample rate (Hz).
+ * @return The model, or NULL if the allocation failed.
+ */
+psychoacoustic_model* psychoacoustic_model_create(const int fft_size, const double sample_rate);
+
+/**
+ * @brief Computes the loudness and the global masking threshold of a frame (model->loudness and model->masking_threshold).
+ *
+ * @param model The model.
+ * @param spectrum The fft_size / 2 + 1 bins of the frame.
+ * @param scale The scale factor of the spectrum, the inverse of the reference amplitude.
+ */
+void psychoacoustic_model_analyze(psychoacoustic_model* const model, const fftw_complex* const spectrum, const double scale);
+
+/**
+ * @brief Destroys a psychoacoustic model.
+ *
+ * @param model The model.
+ */
+void psychoacoustic_model_destroy(psychoacoustic_model* const model);
+
+#endif // PSYCHOACOUSTIC_H
@@ -0,0 +1,157 @@
+#include "segment.h"
+
+#include <pthread.h>
+#include <sndfile.h>
+#include <stdlib.h>
+
+#include "frame.h"
+
+typedef struct segment {
+    const char* path;
+    int frame_size;
+    int hop_size;
+    const segment_pipeline* pipeline;
+    long first; // Index of the first frame.
+    long count; // Number of frames, -1 to read up to the end of the file.
+    long analyzed; // Number of frames analyzed, -1 on failure.
+    FILE* output;
+    char* text; // Output of the segment, if buffered.
+    size_t size;
+} segment;
+
+// Reads n samples mixed down to mono, returns the number of samples read.
+static int
+read_mono(SNDFILE* const file, const int channels, double* const samples, double* const interleaved, const int n)
+{
+    if (channels == 1)
+        return sf_readf_double(file, samples, n);
+
+    const int read_count = sf_readf_double(file, interleaved, n);
+    for (int sample = 0; sample < read_count; sample++) {
+        double sum = 0.;
+        for (int channel = 0; channel < channels; channel++)
+            sum += interleaved[sample * channels + channel];
+        samples[sample] = sum / channels;
+    }
+    return read_count;
+}
+
+static void*
+analyze(void* const argument)
+{
+    segment* const part = argument;
+    const segment_pipeline* const pipeline = part->pipeline;
+    const int overlap = part->frame_size - part->hop_size;
+    part->analyzed = -1;
+
+    SF_INFO info = { 0 };
+    SNDFILE* const file = sf_open(part->path, SFM_READ, &info);
+    if (file == NULL)
+        return NULL;
+    if (part->first > 0 && sf_seek(file, part->first * part->hop_size, SEEK_SET) < 0) {
+        sf_close(file);
+        return NULL;
+    }
+
+    frame_assembler* const frames = frame_assembler_create(part->frame_size);
+    double* const hop = malloc(part->frame_size * sizeof(double));
+    double* const interleaved = info.channels > 1 ? malloc(part->frame_size * info.channels * sizeof(double)) : NULL;
+    if (frames == NULL || hop == NULL || (info.channels > 1 && interleaved == NULL)) {
+        frame_assembler_destroy(frames);
+        free(hop);
+        free(interleaved);
+        sf_close(file);
+        return NULL;
+    }
+
+    if (pipeline->begin != NULL)
+        pipeline->begin(pipeline->context);
+
+    // The samples shared with the previous frame, then a hop per frame.
+    long analyzed = 0;
+    if (read_mono(file, info.channels, hop, interleaved, overlap) == overlap) {
+        frame_assembler_push(frames, hop, overlap);
+        while ((part->count < 0 || analyzed < part->count) && read_mono(file, info.channels, hop, interleaved, part->hop_size) == part->hop_size) {
+            frame_assembler_push(frames, hop, part->hop_size);
+            pipeline->frame(frame_assembler_get_frame(frames), part->first + analyzed, part->output, pipeline->context);
+            analyzed++;
+        }
+    }
+
+    if (pipeline->end != NULL)
+        pipeline->end(pipeline->context);
+
+    frame_assembler_destroy(frames);
+    free(hop);
+    free(interleaved);
+    sf_close(file);
+    part->analyzed = analyzed;
+    return NULL;
+}
+
+long segment_analyze(const char* const path, const int frame_size, const int hop_size, const int segments, const segment_pipeline* const pipeline, FILE* const output)
+{
+    SF_INFO info = { 0 };
+    SNDFILE* const file = sf_open(path, SFM_READ, &info);
+    if (file == NULL)
+        return -1;
+    sf_close(file);
+
+    // Only whole frames are analyzed.
+    const long frame_count = info.frames < frame_size ? 0 : (info.frames - frame_size) / hop_size + 1;
+    int count = segments;
+    if (count > frame_count)
+        count = frame_count;
+    if (count < 1 || !info.seekable)
+        count = 1;
+
+    if (count == 1) {
+        segment whole = { path, frame_size, hop_size, pipeline, 0, -1, 0, output, NULL, 0 };
+        analyze(&whole);
+        return whole.analyzed;
+    }
+
+    segment* const parts = calloc(count, sizeof(segment));
+    pthread_t* const threads = malloc(count * sizeof(pthread_t));
+    if (parts == NULL || threads == NULL) {
+        free(parts);
+        free(threads);
+        return -1;
+    }
+
+    // Each segment writes to its own stream, copied to the output in order once all are done.
+    int started = 0;
+    for (int i = 0; i < count; i++, started++) {
+        segment* const part = &parts[i];
+        part->path = path;
+        part->frame_size = frame_size;
+        part->hop_size = hop_size;
+        part->pipeline = pipeline;
+        part->first = frame_count * i / count;
+        part->count = frame_count * (i + 1) / count - part->first;
+        part->analyzed = -1;
+        part->output = open_memstream(&part->text, &part->size);
+        if (part->output == NULL || pthread_create(&threads[i], NULL, analyze, part) != 0) {
+            if (part->output != NULL)
+                fclose(part->output);
+            break;
+        }
+    }
+
+    long analyzed = started == count ? 0 : -1;
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        fclose(parts[i].output);
+        if (analyzed >= 0 && parts[i].analyzed >= 0) {
+            fwrite(parts[i].text, 1, parts[i].size, output);
+            analyzed += parts[i].analyzed;
+        } else
+            analyzed = -1;
+    }
+    for (int i = 0; i <= started && i < count; i++)
+        free(parts[i].text);
+
+    free(parts);
+    free(threads);
+    return analyzed;
+}
@@ -0,0 +1,42 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <stdio.h>
+
+/*
+ * Segmented analysis of a sound file.
+ *
+ * The frames of a file (frame k covers samples [k * hop_size, k * hop_size +
+ * frame_size), channels mixed down to mono) are split into contiguous
+ * segments, each analyzed by its own thread through its own handle on the
+ * file: the thread seeks to its first frame, reads the frame_size - hop_size
+ * samples it shares with the previous segment, then reads a hop per frame.
+ * Frames keep their index in the whole file, so time codes do not depend on
+ * the segmentation, and the outputs of the segments are written in order.
+ *
+ * Frames are handled concurrently: per-thread state (e.g. an FFT, see fft.h)
+ * is set up in begin and torn down in end, both run on each segment thread.
+ */
+
+typedef struct segment_pipeline {
+    void (*begin)(void* const context); // Before the first frame of a segment (may be NULL).
+    void (*frame)(const double* const frame, const long index, FILE* const output, void* const context);
+    void (*end)(void* const context); // After the last frame of a segment (may be NULL).
+    void* context;
+} segment_pipeline;
+
+/**
+ * @brief Analyzes the frames of a sound file, in parallel segments.
+ *
+ * @param path The path of the sound file.
+ * @param frame_size The frame size.
+ * @param hop_size The hop size (at most the frame size).
+ * @param segments The number of segments (one thread each). Unseekable files
+ * are analyzed in a single segment.
+ * @param pipeline The functions run on each frame.
+ * @param output The stream to write the outputs of the frames to.
+ * @return The number of frames analyzed, or -1 if the file could not be read.
+ */
+long segment_analyze(const char* const path, const int frame_size, const int hop_size, const int segments, const segment_pipeline* const pipeline, FILE* const output);
+
+#endif // SEGMENT_H
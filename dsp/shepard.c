@@ -0,0 +1,250 @@
+#include "shepard.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define TRACKS (SHEPARD_MAX_OCTAVES + 1) // A partial about to enter the span, and one per octave.
+
+// Taylor series of sin(2 pi x) on [-1 / 4, 1 / 4], up to x^13.
+#define S1 (2. * M_PI)
+#define S3 (-1. / 6.)
+#define S5 (1. / 120.)
+#define S7 (-1. / 5040.)
+#define S9 (1. / 362880.)
+#define S11 (-1. / 39916800.)
+#define S13 (1. / 6227020800.)
+
+typedef struct segment {
+    const shepard* glissando;
+    double* output;
+    long first;
+    int n;
+} segment;
+
+// Amplitude at a position within the span (octaves above the lowest frequency).
+static double
+envelope_at(const shepard* const glissando, const double position)
+{
+    if (position <= 0. || position >= glissando->octaves)
+        return 0.;
+
+    const double index = position / glissando->octaves * SHEPARD_ENVELOPE_SIZE;
+    const int i = (int)index;
+    return glissando->envelope[i] + (index - i) * (glissando->envelope[i + 1] - glissando->envelope[i]);
+}
+
+shepard* shepard_create(const double lowest, const int octaves, const double speed, const double width, const double sample_rate)
+{
+    if (octaves < 1 || octaves > SHEPARD_MAX_OCTAVES || lowest <= 0. || width <= 0.)
+        return NULL;
+
+    shepard* const glissando = malloc(sizeof(shepard));
+    if (glissando == NULL)
+        return NULL;
+
+    glissando->sample_rate = sample_rate;
+    glissando->lowest = lowest;
+    glissando->octaves = octaves;
+    glissando->speed = speed;
+
+    // A Gaussian around the middle of the span, shifted and scaled to go from 0 at the ends to 1.
+    const double middle = octaves / 2.;
+    const double edge = exp(-middle * middle / (2. * width * width));
+    for (int i = 0; i <= SHEPARD_ENVELOPE_SIZE; i++) {
+        const double distance = (double)i * octaves / SHEPARD_ENVELOPE_SIZE - middle;
+        const double value = (exp(-distance * distance / (2. * width * width)) - edge) / (1. - edge);
+        glissando->envelope[i] = value > 0. ? value : 0.;
+    }
+
+    // The partials are an octave apart: the amplitudes sum over positions one octave apart.
+    double peak = 0.;
+    for (int offset = 0; offset < 64; offset++) {
+        double sum = 0.;
+        for (int octave = 0; octave < octaves; octave++)
+            sum += envelope_at(glissando, octave + offset / 64.);
+        if (sum > peak)
+            peak = sum;
+    }
+    for (int i = 0; i <= SHEPARD_ENVELOPE_SIZE; i++)
+        glissando->envelope[i] /= peak;
+    return glissando;
+}
+
+// Position of a partial that travelled some octaves from where it entered the span.
+static double
+position_of(const shepard* const glissando, const double travel)
+{
+    return glissando->speed >= 0. ? travel : glissando->octaves - travel;
+}
+
+// Renders the samples skip to skip + count of the block starting at sample start.
+static void
+render_block(const shepard* const glissando, double* const output, const long start, const int skip, const int count)
+{
+    double phases[TRACKS], increments[TRACKS], amplitudes[TRACKS], amplitude_steps[TRACKS];
+    const int tracks = glissando->octaves + 1;
+    const double speed = glissando->speed;
+    const double log_speed = speed * M_LN2;
+    const double growth = exp2(speed / glissando->sample_rate);
+    const double step = speed != 0. ? expm1(log_speed / glissando->sample_rate) / log_speed : 1. / glissando->sample_rate;
+    const double entry = glissando->lowest * (speed >= 0. ? 1. : exp2(glissando->octaves));
+    const double travel = fabs(speed) * start / glissando->sample_rate;
+    const double block_travel = fabs(speed) * SHEPARD_BLOCK_SIZE / glissando->sample_rate;
+
+    // The closed form, at the start of the block.
+    for (int track = 0; track < tracks; track++) {
+        const double distance = track - 1 + (travel - floor(travel));
+        const double frequency = glissando->lowest * exp2(position_of(glissando, distance));
+        const double phase = speed != 0. ? (frequency - entry) / log_speed : frequency * start / glissando->sample_rate;
+        phases[track] = phase - floor(phase);
+        increments[track] = frequency * step;
+        amplitudes[track] = envelope_at(glissando, position_of(glissando, distance));
+        amplitude_steps[track] = (envelope_at(glissando, position_of(glissando, distance + block_travel)) - amplitudes[track]) / SHEPARD_BLOCK_SIZE;
+    }
+
+    for (int sample = 0; sample < skip + count; sample++) {
+        double value = 0.;
+        int track = 0;
+
+#if defined(__SSE2__)
+        const __m128d one = _mm_set1_pd(1.), half = _mm_set1_pd(.5), minus_half = _mm_set1_pd(-.5);
+        __m128d sum = _mm_setzero_pd();
+        for (; track + 2 <= tracks; track += 2) {
+            const __m128d phase = _mm_loadu_pd(phases + track);
+            __m128d x = _mm_sub_pd(phase, _mm_cvtepi32_pd(_mm_cvtpd_epi32(phase))); // [-1 / 2, 1 / 2].
+            x = _mm_min_pd(x, _mm_sub_pd(half, x)); // Folded on [-1 / 4, 1 / 4].
+            x = _mm_max_pd(x, _mm_sub_pd(minus_half, x));
+            const __m128d z = _mm_mul_pd(x, _mm_set1_pd(S1)), z2 = _mm_mul_pd(z, z);
+            __m128d sine = _mm_add_pd(_mm_set1_pd(S11), _mm_mul_pd(z2, _mm_set1_pd(S13)));
+            sine = _mm_add_pd(_mm_set1_pd(S9), _mm_mul_pd(z2, sine));
+            sine = _mm_add_pd(_mm_set1_pd(S7), _mm_mul_pd(z2, sine));
+            sine = _mm_add_pd(_mm_set1_pd(S5), _mm_mul_pd(z2, sine));
+            sine = _mm_add_pd(_mm_set1_pd(S3), _mm_mul_pd(z2, sine));
+            sine = _mm_mul_pd(z, _mm_add_pd(one, _mm_mul_pd(z2, sine)));
+
+            const __m128d amplitude = _mm_loadu_pd(amplitudes + track), increment = _mm_loadu_pd(increments + track);
+            sum = _mm_add_pd(sum, _mm_mul_pd(amplitude, sine));
+            _mm_storeu_pd(amplitudes + track, _mm_add_pd(amplitude, _mm_loadu_pd(amplitude_steps + track)));
+            _mm_storeu_pd(phases + track, _mm_add_pd(phase, increment));
+            _mm_storeu_pd(increments + track, _mm_mul_pd(increment, _mm_set1_pd(growth)));
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, sum);
+        value = lanes[0] + lanes[1];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const float64x2_t one = vdupq_n_f64(1.), half = vdupq_n_f64(.5), minus_half = vdupq_n_f64(-.5);
+        float64x2_t sum = vdupq_n_f64(0.);
+        for (; track + 2 <= tracks; track += 2) {
+            const float64x2_t phase = vld1q_f64(phases + track);
+            float64x2_t x = vsubq_f64(phase, vrndnq_f64(phase)); // [-1 / 2, 1 / 2].
+            x = vminq_f64(x, vsubq_f64(half, x)); // Folded on [-1 / 4, 1 / 4].
+            x = vmaxq_f64(x, vsubq_f64(minus_half, x));
+            const float64x2_t z = vmulq_n_f64(x, S1), z2 = vmulq_f64(z, z);
+            float64x2_t sine = vfmaq_n_f64(vdupq_n_f64(S11), z2, S13);
+            sine = vfmaq_f64(vdupq_n_f64(S9), z2, sine);
+            sine = vfmaq_f64(vdupq_n_f64(S7), z2, sine);
+            sine = vfmaq_f64(vdupq_n_f64(S5), z2, sine);
+            sine = vfmaq_f64(vdupq_n_f64(S3), z2, sine);
+            sine = vmulq_f64(z, vfmaq_f64(one, z2, sine));
+
+            const float64x2_t amplitude = vld1q_f64(amplitudes + track), increment = vld1q_f64(increments + track);
+            sum = vfmaq_f64(sum, amplitude, sine);
+            vst1q_f64(amplitudes + track, vaddq_f64(amplitude, vld1q_f64(amplitude_steps + track)));
+            vst1q_f64(phases + track, vaddq_f64(phase, increment));
+            vst1q_f64(increments + track, vmulq_n_f64(increment, growth));
+        }
+        value = vaddvq_f64(sum);
+#endif
+
+        for (; track < tracks; track++) {
+            double x = phases[track] - nearbyint(phases[track]);
+            x = fmin(x, .5 - x);
+            x = fmax(x, -.5 - x);
+            const double z = S1 * x, z2 = z * z;
+            const double sine = z * (1. + z2 * (S3 + z2 * (S5 + z2 * (S7 + z2 * (S9 + z2 * (S11 + z2 * S13))))));
+            value += amplitudes[track] * sine;
+            amplitudes[track] += amplitude_steps[track];
+            phases[track] += increments[track];
+            increments[track] *= growth;
+        }
+
+        if (sample >= skip)
+            output[sample - skip] = value;
+    }
+}
+
+void shepard_render(const shepard* const glissando, double* const output, const long first, const int n)
+{
+    long start = first - first % SHEPARD_BLOCK_SIZE;
+    for (int done = 0; done < n; start += SHEPARD_BLOCK_SIZE) {
+        const int skip = first + done - start;
+        const int count = n - done < SHEPARD_BLOCK_SIZE - skip ? n - done : SHEPARD_BLOCK_SIZE - skip;
+        render_block(glissando, output + done, start, skip, count);
+        done += count;
+    }
+}
+
+static void*
+render_segment(void* const argument)
+{
+    const segment* const job = argument;
+    shepard_render(job->glissando, job->output, job->first, job->n);
+    return NULL;
+}
+
+void shepard_render_parallel(const shepard* const glissando, double* const output, const long first, const int n, const int threads)
+{
+    // No more segments than blocks, a thread would have nothing to render.
+    const int blocks = (n + SHEPARD_BLOCK_SIZE - 1) / SHEPARD_BLOCK_SIZE;
+    int count = threads < blocks ? threads : blocks;
+    if (count < 1)
+        count = 1;
+
+    segment* const jobs = malloc(count * sizeof(segment));
+    pthread_t* const ids = malloc(count * sizeof(pthread_t));
+    long* const bounds = malloc((count + 1) * sizeof(long));
+    if (count == 1 || jobs == NULL || ids == NULL || bounds == NULL) {
+        free(jobs);
+        free(ids);
+        free(bounds);
+        shepard_render(glissando, output, first, n);
+        return;
+    }
+
+    // Segments cut on block starts, so no block is rendered twice.
+    bounds[0] = first;
+    bounds[count] = first + n;
+    for (int i = 1; i < count; i++) {
+        const long bound = first + (long)n * i / count;
+        bounds[i] = bound - bound % SHEPARD_BLOCK_SIZE > bounds[i - 1] ? bound - bound % SHEPARD_BLOCK_SIZE : bounds[i - 1];
+    }
+    for (int i = 0; i < count; i++)
+        jobs[i] = (segment) { glissando, output + (bounds[i] - first), bounds[i], bounds[i + 1] - bounds[i] };
+
+    // The calling thread renders the first segment.
+    int started = 1;
+    for (int i = 1; i < count; i++, started++)
+        if (pthread_create(&ids[i], NULL, render_segment, &jobs[i]) != 0)
+            break;
+    render_segment(&jobs[0]);
+    for (int i = 1; i < started; i++)
+        pthread_join(ids[i], NULL);
+    for (int i = started; i < count; i++)
+        render_segment(&jobs[i]);
+
+    free(jobs);
+    free(ids);
+    free(bounds);
+}
+
+void shepard_destroy(shepard* const glissando)
+{
+    free(glissando);
+}
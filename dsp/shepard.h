@@ -0,0 +1,77 @@
+#ifndef SHEPARD_H
+#define SHEPARD_H
+
+/*
+ * Shepard-Risset glissando.
+ *
+ * Octave-spaced partials spanning a number of octaves above the lowest
+ * frequency all glide at the same speed (octaves per second, up or down).
+ * A partial leaving the span at one end comes back at the other, and the
+ * amplitudes follow a precomputed Gaussian of the position within the span
+ * (log frequency), brought down to zero at both ends, so the pitch seems to
+ * rise or fall forever. A speed of 0 gives a static Shepard tone.
+ *
+ * The phase of a partial has a closed form: a partial gliding from F at r
+ * octaves per second has the frequency F 2^(r t) and the phase
+ * (F 2^(r t) - F) / (r ln 2) (in periods), whatever happened before. Samples
+ * are rendered in blocks of SHEPARD_BLOCK_SIZE aligned on the sample index:
+ * each block starts from the closed form, then steps the phases and the
+ * increments (multiplied by 2^(r / sample_rate) every sample). Any range of
+ * samples can thus be rendered on its own, and gives the same samples,
+ * bit for bit, as a render of the whole sound: long sounds are rendered in
+ * parallel segments.
+ */
+
+#define SHEPARD_MAX_OCTAVES 16
+#define SHEPARD_BLOCK_SIZE 1024
+#define SHEPARD_ENVELOPE_SIZE 1024 // Envelope values over the span.
+
+typedef struct shepard {
+    double sample_rate;
+    double lowest; // Lowest frequency of the span (Hz).
+    int octaves; // Span.
+    double speed; // Octaves per second, negative to go down.
+    double envelope[SHEPARD_ENVELOPE_SIZE + 1]; // Amplitudes over the span, normalized to a peak sum of 1.
+} shepard;
+
+/**
+ * @brief Creates a Shepard-Risset glissando.
+ *
+ * @param lowest The lowest frequency (Hz), lowest * 2^octaves has to stay below Nyquist.
+ * @param octaves The number of octaves spanned (at most SHEPARD_MAX_OCTAVES).
+ * @param speed The speed (octaves per second, negative to go down, 0 for a static tone).
+ * @param width The standard deviation of the Gaussian envelope (octaves).
+ * @param sample_rate The sample rate (Hz).
+ * @return The glissando, or NULL if the parameters are invalid or the allocation failed.
+ */
+shepard* shepard_create(const double lowest, const int octaves, const double speed, const double width, const double sample_rate);
+
+/**
+ * @brief Renders a range of samples.
+ *
+ * @param glissando The glissando (not modified, several threads can render at once).
+ * @param output The samples (n values, overwritten).
+ * @param first The index of the first sample.
+ * @param n The number of samples.
+ */
+void shepard_render(const shepard* const glissando, double* const output, const long first, const int n);
+
+/**
+ * @brief Renders a range of samples in parallel segments, one per thread.
+ *
+ * @param glissando The glissando.
+ * @param output The samples (n values, overwritten).
+ * @param first The index of the first sample.
+ * @param n The number of samples.
+ * @param threads The number of threads.
+ */
+void shepard_render_parallel(const shepard* const glissando, double* const output, const long first, const int n, const int threads);
+
+/**
+ * @brief Destroys a Shepard-Risset glissando.
+ *
+ * @param glissando The glissando.
+ */
+void shepard_destroy(shepard* const glissando);
+
+#endif // SHEPARD_H
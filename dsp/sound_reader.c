@@ -0,0 +1,107 @@
+#include "sound_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Averages interleaved stereo samples.
+static void
+mix_stereo(float* const samples, const float* const interleaved, const int n)
+{
+    int sample = 0;
+
+#if defined(__SSE__)
+    const __m128 half = _mm_set1_ps(.5f);
+    for (; sample + 4 <= n; sample += 4) {
+        const __m128 first = _mm_loadu_ps(interleaved + 2 * sample); // l0 r0 l1 r1
+        const __m128 second = _mm_loadu_ps(interleaved + 2 * sample + 4); // l2 r2 l3 r3
+        const __m128 lefts = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 rights = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(samples + sample, _mm_mul_ps(_mm_add_ps(lefts, rights), half));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t half = vdupq_n_f32(.5f);
+    for (; sample + 4 <= n; sample += 4) {
+        const float32x4x2_t pair = vld2q_f32(interleaved + 2 * sample); // Deinterleaved: lefts, rights.
+        vst1q_f32(samples + sample, vmulq_f32(vaddq_f32(pair.val[0], pair.val[1]), half));
+    }
+#endif
+
+    for (; sample < n; sample++)
+        samples[sample] = .5f * (interleaved[2 * sample] + interleaved[2 * sample + 1]);
+}
+
+// Averages interleaved samples of any number of channels.
+static void
+mix_channels(float* const samples, const float* const interleaved, const int n, const int channels)
+{
+    const float scale = 1.f / channels;
+    for (int sample = 0; sample < n; sample++) {
+        float sum = 0.f;
+        for (int channel = 0; channel < channels; channel++)
+            sum += interleaved[sample * channels + channel];
+        samples[sample] = sum * scale;
+    }
+}
+
+sound_reader* sound_reader_open(const char* const path, const int capacity)
+{
+    sound_reader* const reader = malloc(sizeof(sound_reader));
+    if (reader == NULL)
+        return NULL;
+
+    SF_INFO info = { 0 };
+    reader->file = sf_open(path, SFM_READ, &info);
+    reader->interleaved = NULL;
+    if (reader->file == NULL) {
+        fprintf(stderr, "Not able to open input file %s.\n%s\n", path, sf_strerror(NULL));
+        free(reader);
+        return NULL;
+    }
+
+    reader->channels = info.channels;
+    reader->sample_rate = info.samplerate;
+    reader->frames = info.frames;
+    reader->capacity = capacity;
+    if (info.channels > 1 && (reader->interleaved = malloc(capacity * info.channels * sizeof(float))) == NULL) {
+        sound_reader_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+int sound_reader_read(sound_reader* const reader, float* const samples, const int n)
+{
+    int read_count;
+    if (reader->channels == 1)
+        read_count = sf_readf_float(reader->file, samples, n);
+    else {
+        read_count = sf_readf_float(reader->file, reader->interleaved, n);
+        if (reader->channels == 2)
+            mix_stereo(samples, reader->interleaved, read_count);
+        else
+            mix_channels(samples, reader->interleaved, read_count, reader->channels);
+    }
+
+    if (read_count < 0)
+        read_count = 0;
+    memset(samples + read_count, 0, (n - read_count) * sizeof(float));
+    return read_count;
+}
+
+void sound_reader_close(sound_reader* const reader)
+{
+    if (reader == NULL)
+        return;
+
+    if (reader->file != NULL)
+        sf_close(reader->file);
+    free(reader->interleaved);
+    free(reader);
+}
@@ -0,0 +1,50 @@
+#ifndef SOUND_READER_H
+#define SOUND_READER_H
+
+#include <sndfile.h>
+
+/*
+ * Streaming sound reader.
+ *
+ * Decodes any format libsndfile knows, block by block, straight into mono
+ * float samples in [-1, 1]: libsndfile converts the samples to float while
+ * decoding, and the channels are averaged on the way (vectorized for stereo,
+ * SSE or NEON). Nothing is transcoded beforehand, and no file is written.
+ */
+
+typedef struct sound_reader {
+    SNDFILE* file;
+    int channels;
+    int sample_rate;
+    long frames; // Number of samples (per channel).
+    int capacity; // Largest block read at once.
+    float* interleaved; // capacity * channels samples (NULL for mono).
+} sound_reader;
+
+/**
+ * @brief Opens a sound file for reading.
+ *
+ * @param path The path of the sound file.
+ * @param capacity The largest number of samples read at once.
+ * @return The reader, or NULL if the file could not be opened.
+ */
+sound_reader* sound_reader_open(const char* const path, const int capacity);
+
+/**
+ * @brief Reads the next samples, mixed down to mono.
+ *
+ * @param reader The reader.
+ * @param samples The samples (n values, zero-padded past the end of the file).
+ * @param n The number of samples to read (at most the capacity).
+ * @return The number of samples read, 0 at the end of the file.
+ */
+int sound_reader_read(sound_reader* const reader, float* const samples, const int n);
+
+/**
+ * @brief Closes a sound file.
+ *
+ * @param reader The reader.
+ */
+void sound_reader_close(sound_reader* const reader);
+
+#endif // SOUND_READER_H
@@ -0,0 +1,135 @@
+#include "sound_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define FULL_SCALE 32768.
+
+// Converts samples to 16 bits, rounded to nearest, clipped to [-32768, 32767].
+static void
+convert(short* const output, const double* const samples, const int n)
+{
+    int sample = 0;
+
+#if defined(__SSE2__)
+    const __m128d scale = _mm_set1_pd(FULL_SCALE);
+    const __m128d low = _mm_set1_pd(-32768.), high = _mm_set1_pd(32767.);
+    for (; sample + 8 <= n; sample += 8) {
+        // Clipped before the conversion, which gives INT_MIN past the int32 range.
+        __m128i words[4];
+        for (int i = 0; i < 4; i++) {
+            const __m128d values = _mm_mul_pd(_mm_loadu_pd(samples + sample + 2 * i), scale);
+            words[i] = _mm_cvtpd_epi32(_mm_max_pd(_mm_min_pd(values, high), low));
+        }
+        const __m128i first = _mm_unpacklo_epi64(words[0], words[1]);
+        const __m128i second = _mm_unpacklo_epi64(words[2], words[3]);
+        _mm_storeu_si128((__m128i*)(output + sample), _mm_packs_epi32(first, second));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t scale = vdupq_n_f64(FULL_SCALE);
+    for (; sample + 4 <= n; sample += 4) {
+        // Each narrowing saturates.
+        const int32x2_t first = vqmovn_s64(vcvtnq_s64_f64(vmulq_f64(vld1q_f64(samples + sample), scale)));
+        const int32x2_t second = vqmovn_s64(vcvtnq_s64_f64(vmulq_f64(vld1q_f64(samples + sample + 2), scale)));
+        vst1_s16(output + sample, vqmovn_s32(vcombine_s32(first, second)));
+    }
+#endif
+
+    for (; sample < n; sample++) {
+        const double value = samples[sample] * FULL_SCALE;
+        output[sample] = value >= 32767. ? 32767 : value <= -32768. ? -32768 : (short)lrint(value);
+    }
+}
+
+// Hands the buffered samples to libsndfile.
+static int
+flush(sound_writer* const writer)
+{
+    const sf_count_t count = writer->count;
+    writer->count = 0;
+    return sf_writef_short(writer->file, writer->buffer, count) == count ? 0 : -1;
+}
+
+sound_writer* sound_writer_open(const char* const path, const int channels, const int sample_rate)
+{
+    sound_writer* const writer = malloc(sizeof(sound_writer));
+    if (writer == NULL)
+        return NULL;
+
+    const int standard_output = strcmp(path, "-") == 0;
+    const char* const extension = strrchr(path, '.');
+    SF_INFO info = {
+        .samplerate = sample_rate,
+        .channels = channels,
+        .format = SF_FORMAT_PCM_16,
+    };
+    if (standard_output)
+        info.format |= SF_FORMAT_AU;
+    else if (extension != NULL && strcasecmp(extension, ".flac") == 0)
+        info.format |= SF_FORMAT_FLAC;
+    else
+        info.format |= SF_FORMAT_WAV;
+
+    writer->file = standard_output ? sf_open_fd(STDOUT_FILENO, SFM_WRITE, &info, 0) : sf_open(path, SFM_WRITE, &info);
+    writer->buffer = NULL;
+    if (writer->file == NULL) {
+        fprintf(stderr, "Not able to open output file %s.\n%s\n", path, sf_strerror(NULL));
+        free(writer);
+        return NULL;
+    }
+
+    writer->channels = channels;
+    writer->count = 0;
+    if ((writer->buffer = malloc(SOUND_WRITER_BUFFER_SIZE * channels * sizeof(short))) == NULL) {
+        sound_writer_close(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+int sound_writer_write(sound_writer* const writer, const double* const samples, const int n)
+{
+    int written = 0;
+    while (written < n) {
+        const int space = SOUND_WRITER_BUFFER_SIZE - writer->count;
+        const int copied = n - written < space ? n - written : space;
+        convert(writer->buffer + writer->count * writer->channels, samples + written * writer->channels, copied * writer->channels);
+        writer->count += copied;
+        written += copied;
+
+        if (writer->count == SOUND_WRITER_BUFFER_SIZE && flush(writer) != 0) {
+            fprintf(stderr, "Not able to write the samples.\n%s\n", sf_strerror(writer->file));
+            // The buffer held the last samples, some of them possibly from previous calls.
+            return written > SOUND_WRITER_BUFFER_SIZE ? written - SOUND_WRITER_BUFFER_SIZE : 0;
+        }
+    }
+    return written;
+}
+
+int sound_writer_close(sound_writer* const writer)
+{
+    if (writer == NULL)
+        return 0;
+
+    int status = 0;
+    if (writer->file != NULL) {
+        if (writer->count > 0 && flush(writer) != 0) {
+            fprintf(stderr, "Not able to write the samples.\n%s\n", sf_strerror(writer->file));
+            status = -1;
+        }
+        sf_close(writer->file);
+    }
+    free(writer->buffer);
+    free(writer);
+    return status;
+}
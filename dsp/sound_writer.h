@@ -0,0 +1,54 @@
+#ifndef SOUND_WRITER_H
+#define SOUND_WRITER_H
+
+#include <sndfile.h>
+
+/*
+ * Buffered sound writer.
+ *
+ * Encodes 16-bit sounds straight through libsndfile: WAV, or FLAC for paths
+ * ending in .flac, or an AU stream on the standard output for "-" (WAV and
+ * FLAC need to seek back to their header, which a pipe cannot do). Samples in
+ * [-1, 1] are converted to 16 bits (vectorized, SSE2 or NEON) into a large
+ * buffer, with saturation: full scale is clipped to 32767 instead of wrapping
+ * around to -32768. The buffer is only handed to libsndfile once full.
+ */
+
+#define SOUND_WRITER_BUFFER_SIZE 65536 // Samples (per channel).
+
+typedef struct sound_writer {
+    SNDFILE* file;
+    int channels;
+    int count; // Samples buffered (per channel).
+    short* buffer; // SOUND_WRITER_BUFFER_SIZE * channels samples.
+} sound_writer;
+
+/**
+ * @brief Opens a sound file for writing.
+ *
+ * @param path The path of the sound file ("-" for the standard output).
+ * @param channels The number of channels.
+ * @param sample_rate The sample rate (Hz).
+ * @return The writer, or NULL if the file could not be opened.
+ */
+sound_writer* sound_writer_open(const char* const path, const int channels, const int sample_rate);
+
+/**
+ * @brief Writes samples, interleaved if there are several channels.
+ *
+ * @param writer The writer.
+ * @param samples The samples, in [-1, 1] (clipped beyond).
+ * @param n The number of samples (per channel).
+ * @return The number of samples written (per channel), less than n on failure.
+ */
+int sound_writer_write(sound_writer* const writer, const double* const samples, const int n);
+
+/**
+ * @brief Writes the buffered samples and closes a sound file.
+ *
+ * @param writer The writer.
+ * @return 0 on success, -1 if the last samples could not be written.
+ */
+int sound_writer_close(sound_writer* const writer);
+
+#endif // SOUND_WRITER_H
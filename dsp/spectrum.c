@@ -0,0 +1,80 @@
+#include "spectrum.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Computes scale * |X|^2, or scale * |X| if root, for every bin.
+static void
+squared_norms(double* const values, const fftw_complex* const spectrum, const int bins, const double scale, const int root)
+{
+    const double* const parts = (const double*)spectrum; // Interleaved real and imaginary parts.
+    int bin = 0;
+
+#if defined(__SSE2__)
+    const __m128d factor = _mm_set1_pd(scale);
+    for (; bin + 2 <= bins; bin += 2) {
+        const __m128d first = _mm_loadu_pd(parts + 2 * bin);
+        const __m128d second = _mm_loadu_pd(parts + 2 * bin + 2);
+        const __m128d first_squares = _mm_mul_pd(first, first);
+        const __m128d second_squares = _mm_mul_pd(second, second);
+        __m128d norms = _mm_add_pd(_mm_unpacklo_pd(first_squares, second_squares), _mm_unpackhi_pd(first_squares, second_squares));
+        if (root)
+            norms = _mm_sqrt_pd(norms);
+        _mm_storeu_pd(values + bin, _mm_mul_pd(norms, factor));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t factor = vdupq_n_f64(scale);
+    for (; bin + 2 <= bins; bin += 2) {
+        const float64x2x2_t pair = vld2q_f64(parts + 2 * bin); // Deinterleaved: real parts, imaginary parts.
+        float64x2_t norms = vfmaq_f64(vmulq_f64(pair.val[0], pair.val[0]), pair.val[1], pair.val[1]);
+        if (root)
+            norms = vsqrtq_f64(norms);
+        vst1q_f64(values + bin, vmulq_f64(norms, factor));
+    }
+#endif
+
+    for (; bin < bins; bin++) {
+        const double norm = parts[2 * bin] * parts[2 * bin] + parts[2 * bin + 1] * parts[2 * bin + 1];
+        values[bin] = (root ? sqrt(norm) : norm) * scale;
+    }
+}
+
+void spectrum_magnitude(double* const magnitudes, const fftw_complex* const spectrum, const int bins, const double scale)
+{
+    squared_norms(magnitudes, spectrum, bins, scale, 1);
+}
+
+void spectrum_power(double* const powers, const fftw_complex* const spectrum, const int bins, const double scale)
+{
+    squared_norms(powers, spectrum, bins, scale, 0);
+}
+
+void spectrum_decibels(double* const decibels, const fftw_complex* const spectrum, const int bins, const double scale)
+{
+    // 20 * log10(scale * |X|) = 10 * log10(scale^2 * |X|^2), without any square root.
+    squared_norms(decibels, spectrum, bins, scale * scale, 0);
+    for (int bin = 0; bin < bins; bin++)
+        decibels[bin] = 10. * log10(decibels[bin]);
+}
+
+void spectrum_log_magnitude(double* const logs, const fftw_complex* const spectrum, const int bins, const double scale)
+{
+    // log(scale * |X|) = log(scale^2 * |X|^2) / 2, without any square root.
+    squared_norms(logs, spectrum, bins, scale * scale, 0);
+    for (int bin = 0; bin < bins; bin++)
+        logs[bin] = .5 * log(logs[bin]);
+}
+
+void spectrum_polar(double* const magnitudes, double* const phases, const fftw_complex* const spectrum, const int bins, const double scale)
+{
+    const double* const parts = (const double*)spectrum;
+
+    squared_norms(magnitudes, spectrum, bins, scale, 1);
+    for (int bin = 0; bin < bins; bin++)
+        phases[bin] = atan2(parts[2 * bin + 1], parts[2 * bin]);
+}
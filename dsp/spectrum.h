@@ -0,0 +1,66 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "fft.h"
+
+/*
+ * Spectrum kernels.
+ *
+ * Each kernel converts the bins of a (half) spectrum in one pass, scaling them
+ * on the way (e.g. by 2 / N to normalize amplitudes), so a tool only pays for
+ * what it uses: phases cost an atan2 per bin, the other kernels are
+ * vectorized (SSE2 or NEON, scalar otherwise).
+ */
+
+/**
+ * @brief Computes the magnitudes of the bins: scale * |X|.
+ *
+ * @param magnitudes The magnitudes (bins values).
+ * @param spectrum The spectrum.
+ * @param bins The number of bins.
+ * @param scale The scale factor (1 for raw magnitudes).
+ */
+void spectrum_magnitude(double* const magnitudes, const fftw_complex* const spectrum, const int bins, const double scale);
+
+/**
+ * @brief Computes the powers of the bins: scale * |X|^2.
+ *
+ * @param powers The powers (bins values).
+ * @param spectrum The spectrum.
+ * @param bins The number of bins.
+ * @param scale The scale factor (1 for raw powers).
+ */
+void spectrum_power(double* const powers, const fftw_complex* const spectrum, const int bins, const double scale);
+
+/**
+ * @brief Computes the levels of the bins in decibels: 20 * log10(scale * |X|).
+ *
+ * @param decibels The levels (bins values).
+ * @param spectrum The spectrum.
+ * @param bins The number of bins.
+ * @param scale The scale factor, the inverse of the reference amplitude.
+ */
+void spectrum_decibels(double* const decibels, const fftw_complex* const spectrum, const int bins, const double scale);
+
+/**
+ * @brief Computes the natural logarithms of the magnitudes of the bins: log(scale * |X|).
+ *
+ * @param logs The log-magnitudes (bins values).
+ * @param spectrum The spectrum.
+ * @param bins The number of bins.
+ * @param scale The scale factor (1 for raw magnitudes).
+ */
+void spectrum_log_magnitude(double* const logs, const fftw_complex* const spectrum, const int bins, const double scale);
+
+/**
+ * @brief Computes the magnitudes (scale * |X|) and the phases of the bins.
+ *
+ * @param magnitudes The magnitudes (bins values).
+ * @param phases The phases, in radians (bins values).
+ * @param spectrum The spectrum.
+ * @param bins The number of bins.
+ * @param scale The scale factor of the magnitudes (1 for raw magnitudes).
+ */
+void spectrum_polar(double* const magnitudes, double* const phases, const fftw_complex* const spectrum, const int bins, const double scale);
+
+#endif // SPECTRUM_H
@@ -0,0 +1,187 @@
+#include "stft.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static fftw_plan
+plan_batch(const unsigned flags, void* const context)
+{
+    const stft* const transform = context;
+    return fftw_plan_many_dft_r2c(1, &transform->fft_size, transform->batch,
+        transform->signals, NULL, 1, transform->fft_size,
+        transform->spectra, NULL, 1, transform->bins, flags);
+}
+
+static int
+capacity(const stft* const transform)
+{
+    return (transform->batch - 1) * transform->hop_size + transform->frame_size;
+}
+
+static void
+process_chunk(stft* const transform, const int frames)
+{
+    for (int frame = 0; frame < frames; frame++) {
+        const double* const samples = transform->chunk + frame * transform->hop_size;
+        double* const signal = transform->signals + frame * transform->fft_size;
+
+        window_apply(transform->window, signal, samples, transform->frame_size, transform->fft_size);
+    }
+
+    // The plan always transforms a whole batch, stale frames are simply ignored.
+    fftw_execute(transform->plan);
+
+    for (int frame = 0; frame < frames; frame++)
+        transform->consumer(transform->index + frame,
+            transform->chunk + frame * transform->hop_size,
+            transform->spectra + frame * transform->bins,
+            transform->context);
+
+    // Carry over the samples of the next frames.
+    const int next = frames * transform->hop_size;
+    if (next < transform->count) {
+        memmove(transform->chunk, transform->chunk + next, (transform->count - next) * sizeof(double));
+        transform->count -= next;
+    } else {
+        transform->skip = next - transform->count;
+        transform->count = 0;
+    }
+    transform->index += frames;
+}
+
+stft* stft_create(const int frame_size, const int hop_size, const int fft_size, const int batch, const window* const window, const stft_consumer consumer, void* const context)
+{
+    stft* const transform = malloc(sizeof(stft));
+    if (transform == NULL)
+        return NULL;
+
+    transform->frame_size = frame_size;
+    transform->hop_size = hop_size;
+    transform->fft_size = fft_size;
+    transform->bins = fft_size / 2 + 1;
+    transform->batch = batch;
+    transform->window = window;
+    transform->count = 0;
+    transform->skip = 0;
+    transform->index = 0;
+    transform->consumer = consumer;
+    transform->context = context;
+    transform->plan = NULL;
+    transform->chunk = malloc(capacity(transform) * sizeof(double));
+    transform->signals = fftw_alloc_real(batch * fft_size);
+    transform->spectra = fftw_alloc_complex(batch * transform->bins);
+
+    if (transform->chunk == NULL || transform->signals == NULL || transform->spectra == NULL) {
+        stft_destroy(transform);
+        return NULL;
+    }
+
+    char key[48];
+    snprintf(key, sizeof(key), "r2c-%d-x%d", fft_size, batch);
+    transform->plan = fft_plan(key, plan_batch, transform);
+
+    // Measuring the plan overwrites the buffers.
+    memset(transform->signals, 0, batch * fft_size * sizeof(double));
+    memset(transform->spectra, 0, batch * transform->bins * sizeof(fftw_complex));
+    return transform;
+}
+
+void stft_push(stft* const transform, const double* const samples, const int n)
+{
+    int position = 0;
+    while (position < n) {
+        if (transform->skip > 0) {
+            const int skipped = n - position < transform->skip ? n - position : transform->skip;
+            transform->skip -= skipped;
+            position += skipped;
+            continue;
+        }
+
+        const int space = capacity(transform) - transform->count;
+        const int copied = n - position < space ? n - position : space;
+        memcpy(transform->chunk + transform->count, samples + position, copied * sizeof(double));
+        transform->count += copied;
+        position += copied;
+
+        if (transform->count == capacity(transform))
+            process_chunk(transform, transform->batch);
+    }
+}
+
+void stft_flush(stft* const transform)
+{
+    if (transform->count < transform->frame_size)
+        return;
+
+    process_chunk(transform, (transform->count - transform->frame_size) / transform->hop_size + 1);
+}
+
+// Reads up to limit samples (all of them if negative) through the STFT, then flushes it.
+static int
+read_samples(stft* const transform, SNDFILE* const file, const int channels, long limit)
+{
+    const int block_size = capacity(transform);
+    double* const block = malloc(block_size * sizeof(double));
+    double* const interleaved = channels > 1 ? malloc(block_size * channels * sizeof(double)) : NULL;
+    if (block == NULL || (channels > 1 && interleaved == NULL)) {
+        fprintf(stderr, "Not able to allocate the STFT read buffers.\n");
+        free(block);
+        free(interleaved);
+        return 0;
+    }
+
+    const int first = transform->index;
+    int read_count, requested;
+    do {
+        requested = limit >= 0 && limit < block_size ? limit : block_size;
+        if (channels == 1)
+            read_count = sf_readf_double(file, block, requested);
+        else {
+            read_count = sf_readf_double(file, interleaved, requested);
+            for (int sample = 0; sample < read_count; sample++) {
+                double sum = 0.;
+                for (int channel = 0; channel < channels; channel++)
+                    sum += interleaved[sample * channels + channel];
+                block[sample] = sum / channels;
+            }
+        }
+        stft_push(transform, block, read_count);
+        if (limit >= 0)
+            limit -= read_count;
+    } while (read_count == requested && limit != 0);
+
+    stft_flush(transform);
+    free(block);
+    free(interleaved);
+    return transform->index - first;
+}
+
+int stft_read(stft* const transform, SNDFILE* const file, const int channels)
+{
+    return read_samples(transform, file, channels, -1);
+}
+
+int stft_read_frames(stft* const transform, SNDFILE* const file, const int channels, const int first, const int count)
+{
+    if (sf_seek(file, (sf_count_t)first * transform->hop_size, SEEK_SET) < 0)
+        return 0;
+
+    // Drop the samples left from the previous position.
+    transform->count = 0;
+    transform->skip = 0;
+    transform->index = first;
+    return read_samples(transform, file, channels, count < 0 ? -1 : count == 0 ? 0 : (long)(count - 1) * transform->hop_size + transform->frame_size);
+}
+
+void stft_destroy(stft* const transform)
+{
+    if (transform == NULL)
+        return;
+
+    fft_plan_destroy(transform->plan);
+    free(transform->chunk);
+    fftw_free(transform->signals);
+    fftw_free(transform->spectra);
+    free(transform);
+}
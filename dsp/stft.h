@@ -0,0 +1,107 @@
+#ifndef STFT_H
+#define STFT_H
+
+#include <sndfile.h>
+
+#include "fft.h"
+#include "window.h"
+
+/*
+ * Chunked short-time Fourier transform.
+ *
+ * Samples are gathered in chunks of batch frames: frame k of a chunk starts
+ * k * hop_size samples after the first one. Once a chunk is full, its frames
+ * are windowed, laid out contiguously and transformed all at once by a single
+ * batched r2c plan, then handed to the consumer one by one, in order. The
+ * samples of the chunk still needed by the next frames are carried over.
+ */
+
+/**
+ * @brief Consumes a frame of the STFT.
+ *
+ * @param index The index of the frame in the stream (from 0).
+ * @param frame The frame_size samples of the frame, before windowing.
+ * @param spectrum The fft_size / 2 + 1 bins of the windowed frame.
+ * @param context The context given to the STFT.
+ */
+typedef void (*stft_consumer)(const int index, const double* const frame, const fftw_complex* const spectrum, void* const context);
+
+typedef struct stft {
+    int frame_size;
+    int hop_size;
+    int fft_size; // Frames are zero-padded up to fft_size.
+    int bins; // fft_size / 2 + 1.
+    int batch; // Number of frames transformed at once.
+    const window* window; // frame_size weights (NULL for a rectangular window).
+    double* chunk; // Samples of the chunk, (batch - 1) * hop_size + frame_size at most.
+    int count; // Number of samples in the chunk.
+    int skip; // Number of incoming samples to drop (when hop_size > frame_size).
+    int index; // Index of the first frame of the chunk.
+    double* signals; // batch windowed frames of fft_size samples.
+    fftw_complex* spectra; // batch spectra of bins bins.
+    fftw_plan plan;
+    stft_consumer consumer;
+    void* context;
+} stft;
+
+/**
+ * @brief Creates an STFT.
+ *
+ * @param frame_size The frame size.
+ * @param hop_size The hop size.
+ * @param fft_size The FFT size (at least frame_size).
+ * @param batch The number of frames transformed at once.
+ * @param window The window, of frame_size weights, kept by reference (NULL for a rectangular window).
+ * @param consumer The frame consumer.
+ * @param context The context passed to the consumer.
+ * @return The STFT, or NULL if the allocation failed.
+ */
+stft* stft_create(const int frame_size, const int hop_size, const int fft_size, const int batch, const window* const window, const stft_consumer consumer, void* const context);
+
+/**
+ * @brief Pushes samples into the STFT, transforming and consuming every completed chunk.
+ *
+ * @param transform The STFT.
+ * @param samples The samples.
+ * @param n The number of samples.
+ */
+void stft_push(stft* const transform, const double* const samples, const int n);
+
+/**
+ * @brief Transforms and consumes the complete frames left in the current chunk.
+ *
+ * @param transform The STFT.
+ */
+void stft_flush(stft* const transform);
+
+/**
+ * @brief Reads a whole file through the STFT (channels are averaged), then flushes it.
+ *
+ * @param transform The STFT.
+ * @param file The input file.
+ * @param channels The number of channels of the input file.
+ * @return The number of frames consumed in total.
+ */
+int stft_read(stft* const transform, SNDFILE* const file, const int channels);
+
+/**
+ * @brief Reads some frames of a file through the STFT, seeking to the first one, then flushes it.
+ * The samples still buffered are dropped, and frames keep their index in the file.
+ *
+ * @param transform The STFT.
+ * @param file The input file (seekable).
+ * @param channels The number of channels of the input file.
+ * @param first The index of the first frame.
+ * @param count The number of frames (negative for all the frames up to the end of the file).
+ * @return The number of frames consumed.
+ */
+int stft_read_frames(stft* const transform, SNDFILE* const file, const int channels, const int first, const int count);
+
+/**
+ * @brief Destroys an STFT.
+ *
+ * @param transform The STFT.
+ */
+void stft_destroy(stft* const transform);
+
+#endif // STFT_H
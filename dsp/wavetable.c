@@ -0,0 +1,109 @@
+#include "wavetable.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fft.h"
+
+#define INDEX_BITS 12 // log2(WAVETABLE_SIZE).
+#define FRACTION_BITS (32 - INDEX_BITS)
+
+wavetable* wavetable_create(const double* const amplitudes, const double* const phases, const int harmonics, const double sample_rate)
+{
+    wavetable* const table = malloc(sizeof(wavetable));
+    if (table == NULL)
+        return NULL;
+
+    table->sample_rate = sample_rate;
+    table->base_frequency = sample_rate / 2. / WAVETABLE_HARMONICS;
+    table->tables = malloc(WAVETABLE_OCTAVES * (WAVETABLE_SIZE + 1) * sizeof(float));
+    real_fft* const fft = real_fft_create(WAVETABLE_SIZE, REAL_FFT_INVERSE);
+    if (table->tables == NULL || fft == NULL) {
+        real_fft_destroy(fft);
+        wavetable_destroy(table);
+        return NULL;
+    }
+
+    // A sin(h x + phi) is the real part of bin h = A / 2 (sin phi - i cos phi), twice.
+    double peak = 0.;
+    for (int octave = 0; octave < WAVETABLE_OCTAVES; octave++) {
+        const int kept = WAVETABLE_HARMONICS >> octave < harmonics ? WAVETABLE_HARMONICS >> octave : harmonics;
+        memset(fft->spectrum, 0, fft->bins * sizeof(fftw_complex));
+        for (int harmonic = 1; harmonic <= kept; harmonic++) {
+            const double phase = phases != NULL ? phases[harmonic - 1] : 0.;
+            fft->spectrum[harmonic] = amplitudes[harmonic - 1] / 2. * (sin(phase) - I * cos(phase));
+        }
+        real_fft_inverse(fft);
+
+        float* const samples = table->tables + octave * (WAVETABLE_SIZE + 1);
+        for (int sample = 0; sample < WAVETABLE_SIZE; sample++) {
+            samples[sample] = fft->signal[sample];
+            if (fabs(fft->signal[sample]) > peak)
+                peak = fabs(fft->signal[sample]);
+        }
+        samples[WAVETABLE_SIZE] = samples[0];
+    }
+    real_fft_destroy(fft);
+
+    // The same gain for all the octaves, so notes keep their level across tables.
+    const float gain = peak > 0. ? 1. / peak : 0.;
+    for (int sample = 0; sample < WAVETABLE_OCTAVES * (WAVETABLE_SIZE + 1); sample++)
+        table->tables[sample] *= gain;
+    return table;
+}
+
+wavetable* wavetable_create_saw(const double sample_rate)
+{
+    double amplitudes[WAVETABLE_HARMONICS];
+    for (int harmonic = 1; harmonic <= WAVETABLE_HARMONICS; harmonic++)
+        amplitudes[harmonic - 1] = (harmonic % 2 == 1 ? 1. : -1.) / harmonic;
+    return wavetable_create(amplitudes, NULL, WAVETABLE_HARMONICS, sample_rate);
+}
+
+wavetable* wavetable_create_square(const double sample_rate)
+{
+    double amplitudes[WAVETABLE_HARMONICS];
+    for (int harmonic = 1; harmonic <= WAVETABLE_HARMONICS; harmonic++)
+        amplitudes[harmonic - 1] = harmonic % 2 == 1 ? 1. / harmonic : 0.;
+    return wavetable_create(amplitudes, NULL, WAVETABLE_HARMONICS, sample_rate);
+}
+
+wavetable_voice wavetable_voice_create(const wavetable* const table)
+{
+    return (wavetable_voice) { table, 0 };
+}
+
+void wavetable_voice_render(wavetable_voice* const voice, double* const output, const int n, const double frequency, const double amplitude)
+{
+    const wavetable* const table = voice->table;
+    if (frequency <= 0. || frequency >= table->sample_rate / 2.) {
+        memset(output, 0, n * sizeof(double));
+        return;
+    }
+
+    // The first table whose highest fundamental is above the frequency.
+    int octave = frequency > table->base_frequency ? (int)ceil(log2(frequency / table->base_frequency)) : 0;
+    if (octave >= WAVETABLE_OCTAVES)
+        octave = WAVETABLE_OCTAVES - 1;
+    const float* const samples = table->tables + octave * (WAVETABLE_SIZE + 1);
+
+    const uint32_t increment = (uint32_t)(frequency / table->sample_rate * 4294967296.);
+    const double fraction_scale = amplitude / (1 << FRACTION_BITS);
+    uint32_t phase = voice->phase;
+    for (int sample = 0; sample < n; sample++, phase += increment) {
+        const uint32_t index = phase >> FRACTION_BITS;
+        const double fraction = (phase & ((1 << FRACTION_BITS) - 1)) * fraction_scale;
+        output[sample] = amplitude * samples[index] + fraction * (samples[index + 1] - samples[index]);
+    }
+    voice->phase = phase;
+}
+
+void wavetable_destroy(wavetable* const table)
+{
+    if (table == NULL)
+        return;
+
+    free(table->tables);
+    free(table);
+}
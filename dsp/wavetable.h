@@ -0,0 +1,91 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include <stdint.h>
+
+/*
+ * Band-limited wavetable oscillator.
+ *
+ * A periodic waveform is stored as one table per octave (mip-map), each
+ * synthesized from the harmonic spectrum with an inverse real FFT (see fft.h)
+ * and keeping only the harmonics that stay below Nyquist for the highest
+ * fundamental of its octave. Playing a note then costs one table read with
+ * linear interpolation per sample, whatever the number of harmonics, and never
+ * aliases: table t holds the fundamentals up to base_frequency * 2^t.
+ *
+ * The tables are oversampled twice (WAVETABLE_SIZE samples for at most
+ * WAVETABLE_SIZE / 4 harmonics) to keep the interpolation error low, and the
+ * phase is a 32-bit fixed-point accumulator that wraps around by itself.
+ */
+
+#define WAVETABLE_SIZE 4096 // Samples per table.
+#define WAVETABLE_HARMONICS (WAVETABLE_SIZE / 4) // Harmonics of the first table.
+#define WAVETABLE_OCTAVES 11 // Tables, down to a single harmonic.
+
+typedef struct wavetable {
+    double sample_rate;
+    double base_frequency; // Highest fundamental of the first table (Hz).
+    float* tables; // WAVETABLE_OCTAVES tables of WAVETABLE_SIZE + 1 samples (the last one wraps around).
+} wavetable;
+
+typedef struct wavetable_voice {
+    const wavetable* table;
+    uint32_t phase; // Fraction of a period, on 32 bits.
+} wavetable_voice;
+
+/**
+ * @brief Creates a wavetable from a harmonic spectrum.
+ * The waveform is normalized to a peak of 1.
+ *
+ * @param amplitudes The amplitudes of harmonics 1 to harmonics.
+ * @param phases The phases of the harmonics (radians, 0 for a sine), or NULL for sines.
+ * @param harmonics The number of harmonics (at most WAVETABLE_HARMONICS).
+ * @param sample_rate The sample rate (Hz).
+ * @return The wavetable, or NULL if the allocation failed.
+ */
+wavetable* wavetable_create(const double* const amplitudes, const double* const phases, const int harmonics, const double sample_rate);
+
+/**
+ * @brief Creates a sawtooth wavetable (all the harmonics, in 1 / h).
+ *
+ * @param sample_rate The sample rate (Hz).
+ * @return The wavetable, or NULL if the allocation failed.
+ */
+wavetable* wavetable_create_saw(const double sample_rate);
+
+/**
+ * @brief Creates a square wavetable (odd harmonics, in 1 / h).
+ *
+ * @param sample_rate The sample rate (Hz).
+ * @return The wavetable, or NULL if the allocation failed.
+ */
+wavetable* wavetable_create_square(const double sample_rate);
+
+/**
+ * @brief Starts a voice at the beginning of a period.
+ *
+ * @param table The wavetable.
+ * @return The voice.
+ */
+wavetable_voice wavetable_voice_create(const wavetable* const table);
+
+/**
+ * @brief Renders a block of a voice at a fixed frequency.
+ * Frequencies at or above Nyquist render silence.
+ *
+ * @param voice The voice.
+ * @param output The samples (n values, overwritten).
+ * @param n The number of samples.
+ * @param frequency The frequency (Hz).
+ * @param amplitude The amplitude.
+ */
+void wavetable_voice_render(wavetable_voice* const voice, double* const output, const int n, const double frequency, const double amplitude);
+
+/**
+ * @brief Destroys a wavetable.
+ *
+ * @param table The wavetable.
+ */
+void wavetable_destroy(wavetable* const table);
+
+#endif // WAVETABLE_H
@@ -0,0 +1,83 @@
+#include "window.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Zeroth order modified Bessel function of the first kind, by its power series.
+static double
+bessel_i0(const double x)
+{
+    const double quarter_square = x * x / 4.;
+    double term = 1., sum = 1.;
+    for (int k = 1; term > 1e-12 * sum; k++) {
+        term *= quarter_square / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+static double
+weight(const window_type type, const int sample, const int size, const double beta)
+{
+    const double phase = 2. * M_PI * sample / size;
+
+    switch (type) {
+    case WINDOW_HANN:
+        return .5 - .5 * cos(phase);
+    case WINDOW_HAMMING:
+        return .54 - .46 * cos(phase);
+    case WINDOW_BLACKMAN_HARRIS:
+        return .35875 - .48829 * cos(phase) + .14128 * cos(2. * phase) - .01168 * cos(3. * phase);
+    case WINDOW_KAISER: {
+        const double position = 2. * sample / size - 1.;
+        return bessel_i0(beta * sqrt(1. - position * position)) / bessel_i0(beta);
+    }
+    case WINDOW_RECTANGULAR:
+    default:
+        return 1.;
+    }
+}
+
+window* window_create(const window_type type, const int size, const double beta)
+{
+    window* const table = malloc(sizeof(window));
+    if (table == NULL)
+        return NULL;
+
+    table->type = type;
+    table->size = size;
+    table->weights = malloc(size * sizeof(double));
+    if (table->weights == NULL) {
+        free(table);
+        return NULL;
+    }
+
+    for (int sample = 0; sample < size; sample++)
+        table->weights[sample] = weight(type, sample, size, beta);
+    return table;
+}
+
+void window_apply(const window* const table, double* const signal, const double* const frame, const int frame_size, const int fft_size)
+{
+    if (table == NULL)
+        memcpy(signal, frame, frame_size * sizeof(double));
+    else {
+        // No aliasing, so the compiler vectorizes the product.
+        double* const restrict output = signal;
+        const double* const restrict input = frame;
+        const double* const restrict weights = table->weights;
+        for (int sample = 0; sample < frame_size; sample++)
+            output[sample] = input[sample] * weights[sample];
+    }
+    memset(signal + frame_size, 0, (fft_size - frame_size) * sizeof(double));
+}
+
+void window_destroy(window* const table)
+{
+    if (table == NULL)
+        return;
+
+    free(table->weights);
+    free(table);
+}
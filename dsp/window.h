@@ -0,0 +1,56 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+/*
+ * Window functions.
+ *
+ * The weights of a window are tabulated once for a frame size, so windowing a
+ * frame is a plain multiply: window_apply() windows a frame straight into an
+ * FFT input and zero-pads it in the same pass. Windows are periodic (the
+ * weights of a frame_size + 1 symmetric window, without the last one), as
+ * suits spectral analysis.
+ */
+
+typedef enum window_type {
+    WINDOW_RECTANGULAR,
+    WINDOW_HANN,
+    WINDOW_HAMMING,
+    WINDOW_BLACKMAN_HARRIS, // 4-term, -92 dB side lobes.
+    WINDOW_KAISER, // Shaped by beta (0 is rectangular, ~8.6 is close to Blackman).
+} window_type;
+
+typedef struct window {
+    window_type type;
+    int size;
+    double* weights; // size weights.
+} window;
+
+/**
+ * @brief Creates a window table.
+ *
+ * @param type The window type.
+ * @param size The frame size.
+ * @param beta The Kaiser window beta (ignored by the other windows).
+ * @return The window, or NULL if the allocation failed.
+ */
+window* window_create(const window_type type, const int size, const double beta);
+
+/**
+ * @brief Windows a frame into an FFT input, zero-padding it.
+ *
+ * @param table The window (NULL for a rectangular window of frame_size weights).
+ * @param signal The FFT input (fft_size values).
+ * @param frame The frame (frame_size samples).
+ * @param frame_size The frame size (the window size when given).
+ * @param fft_size The FFT size (at least frame_size).
+ */
+void window_apply(const window* const table, double* const signal, const double* const frame, const int frame_size, const int fft_size);
+
+/**
+ * @brief Destroys a window.
+ *
+ * @param table The window.
+ */
+void window_destroy(window* const table);
+
+#endif // WINDOW_H
@@ -1,82 +1,64 @@
+#include "fft.h"
 #include "gnuplot_i.h"
 #include "math.h"
+#include "sound_reader.h"
+#include "spectrum.h"
 #include <complex.h>
 #include <fftw3.h>
 
-#define SAMPLING_RATE 44100.0
-#define CHANNELS_NUMBER 1
 #define N 1024
 
-char *RAW_FILE = "tmp-in.raw";
-static fftw_plan plan;
+static real_fft *transform;
 
-FILE *
+sound_reader *
 sound_file_open_read (char *sound_file_name)
 {
-  char cmd[256];
-
-  snprintf (cmd, 256,
-	    "sox %s -b 16 -c %d -r %d -e signed-integer %s",
-	    sound_file_name,
-	    CHANNELS_NUMBER, (int)SAMPLING_RATE, RAW_FILE);
-
-  system (cmd);
-
-  return fopen (RAW_FILE, "rb");
+  return sound_reader_open (sound_file_name, N);
 }
 
 void
-sound_file_close_read (FILE *fp)
+sound_file_close_read (sound_reader *input)
 {
-  fclose (fp);
+  sound_reader_close (input);
 }
 
 int
-sound_file_read (FILE *fp, double *s)
-{
-  short tmp[N];
-  int nb_read = fread (tmp, 2, N, fp);
-  for (int i = 0; i < N; i++)
-    s[i] = tmp[i] * 1.0 / (pow(2, 15));
-
-  return nb_read == N;
-}
-
-static void
-cartesian_to_polar (double complex S[N], double amp[N])
+sound_file_read (sound_reader *input, float *s)
 {
-	for (int n = 0; n < N; n++)
-		amp[n] = cabs(S[n]) / N * 2;
+  return sound_reader_read (input, s, N) == N;
 }
 
 static void
-fft_init(fftw_complex data_in[N], fftw_complex data_out[N])
+fft_init()
 {
-	plan = fftw_plan_dft_1d(N, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+	transform = real_fft_create(N, REAL_FFT_FORWARD);
 }
 
 static void
-fft(double s[N], fftw_complex data_in[N])
+fft(float s[N])
 {
 	for (int i = 0; i < N; i++)
-		data_in[i] = s[i];
-
-	fftw_execute(plan);
+		transform->signal[i] = s[i];
+	real_fft_forward(transform);
 }
 
 static void
 fft_exit()
 {
-	fftw_destroy_plan(plan);
+	real_fft_destroy(transform);
 }
 
 int
 main (int argc, char *argv[])
 {
-  FILE *input;
-  double s[N];
+  sound_reader *input;
+  float s[N];
   double x_axis[N];
 
+  if (argc != 2 || (input = sound_file_open_read (argv[1])) == NULL)
+    exit (EXIT_FAILURE);
+
+  const double SAMPLING_RATE = input->sample_rate;
   for (int i = 0; i < N; i++)
     // Temporal
     // x_axis[i] = i / SAMPLING_RATE;
@@ -88,13 +70,11 @@ main (int argc, char *argv[])
   // Temporal
   // gnuplot_cmd(h, "set yr [-1:1]");
   gnuplot_setstyle(h, "lines");
-  
-  input = sound_file_open_read(argv[1]);
 
-  fftw_complex data_in[N], data_out[N];
-  fft_init(data_in, data_out);
+  fft_planner_init();
+  fft_init();
   
-  double amp[N];
+  double amp[N/2+1];
 
   while(sound_file_read (input, s))
     {
@@ -103,8 +83,8 @@ main (int argc, char *argv[])
     //   for (int i = 0; i < N; i++)
     //     x_axis[i] += N/SAMPLING_RATE;
 
-      fft(s, data_in);
-      cartesian_to_polar(data_out, amp);
+      fft(s);
+      spectrum_magnitude(amp, transform->spectrum, N/2+1, 2./N);
 
       // affichage
       // gnuplot_cmd(h, "set yr [-1:1]");
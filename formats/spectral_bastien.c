@@ -1,4 +1,8 @@
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
+#include "spectrum.h"
+#include "window.h"
 #include <complex.h>
 #include <ctype.h>
 #include <fftw3.h>
@@ -12,11 +16,13 @@
 
 #define SAMPLING_FREQ 44100.
 #define FFT_SIZE 1024
+#define FFT_BINS (FFT_SIZE / 2 + 1)
 #define FRAME_SIZE 1024
 #define HOP_SIZE 1024
 
 static gnuplot_ctrl* h;
-static fftw_plan plan;
+static real_fft* transform;
+static window* hann;
 // static fftw_plan iplan;
 
 static void usage(char* progname)
@@ -25,20 +31,6 @@ static void usage(char* progname)
     puts("\n");
 }
 
-static void fill_buffer(double* buffer, double* new_buffer)
-{
-    double tmp[FRAME_SIZE - HOP_SIZE];
-
-    for (int i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
-
-    for (int i = 0; i < (FRAME_SIZE - HOP_SIZE); i++)
-        buffer[i] = tmp[i];
-
-    for (int i = 0; i < HOP_SIZE; i++)
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-}
-
 static int read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
 {
 
@@ -79,33 +71,25 @@ static int read_samples(SNDFILE* infile, double* buffer, int channels)
 /* FFT */
 
 static void
-fft_init(fftw_complex data_in[FFT_SIZE], fftw_complex data_out[FFT_SIZE])
+fft_init()
 {
-    plan = fftw_plan_dft_1d(FFT_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    transform = real_fft_create(FFT_SIZE, REAL_FFT_FORWARD);
+    hann = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
 }
 
+// Windows the frame and zero-pads it into the FFT input, then executes the FFT.
 static void
-fft(const double s[FFT_SIZE], fftw_complex data_in[FFT_SIZE])
+fft(const double frame[FRAME_SIZE])
 {
-    for (unsigned int i = 0; i < FFT_SIZE; i++)
-        data_in[i] = s[i];
-
-    fftw_execute(plan);
+    window_apply(hann, transform->signal, frame, FRAME_SIZE, FFT_SIZE);
+    real_fft_forward(transform);
 }
 
 static void
 fft_exit()
 {
-    fftw_destroy_plan(plan);
-}
-
-static void
-cartesian_to_polar(const double complex S[FFT_SIZE], double amp[FFT_SIZE], double phs[FFT_SIZE])
-{
-    for (unsigned int m = 0; m < FFT_SIZE; m++) {
-        amp[m] = cabs(S[m]);
-        phs[m] = carg(S[m]);
-    }
+    real_fft_destroy(transform);
+    window_destroy(hann);
 }
 
 /* IFFT */
@@ -150,12 +134,6 @@ cartesian_to_polar(const double complex S[FFT_SIZE], double amp[FFT_SIZE], doubl
 //     printf(".\n");
 // }
 
-static double
-hann(unsigned int n)
-{
-    return .5 - .5 * cos(2 * M_PI * n / FRAME_SIZE);
-}
-
 int main(int argc, char** argv)
 {
     char *progname, *infilename;
@@ -180,14 +158,14 @@ int main(int argc, char** argv)
 
     int nb_frames = 0;
     double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
+    frame_assembler* const frames = frame_assembler_create(FRAME_SIZE);
 
     h = gnuplot_init();
     gnuplot_setstyle(h, "lines");
 
     for (int i = 0; i < (FRAME_SIZE / HOP_SIZE - 1); i++) {
         if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
+            frame_assembler_push(frames, new_buffer, HOP_SIZE);
         else {
             printf("not enough samples !!\n");
             return 1;
@@ -203,9 +181,9 @@ int main(int argc, char** argv)
     // clock_t dft_single_duration, dft_full_duration = 0;
 
     // For the FFT & IFFT
-    double s[FFT_SIZE], amp[FFT_SIZE], phs[FFT_SIZE];
-    fftw_complex data_in[FFT_SIZE], data_out[FFT_SIZE];
-    fft_init(data_in, data_out);
+    double amp[FFT_BINS];
+    fft_planner_init();
+    fft_init();
     // double output[FRAME_SIZE];
     // fftw_complex idata_in[FRAME_SIZE], idata_out[FRAME_SIZE];
     // ifft_init(idata_in, idata_out);
@@ -214,10 +192,8 @@ int main(int argc, char** argv)
 
     while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
         printf("\nProcessing frame %d…\n", nb_frames);
-        fill_buffer(buffer, new_buffer);
-
-        for (unsigned int i = 0; i < FFT_SIZE; i++)
-            s[i] = i < FRAME_SIZE ? buffer[i] * hann(i) : 0.;
+        frame_assembler_push(frames, new_buffer, HOP_SIZE);
+        const double* const buffer = frame_assembler_get_frame(frames);
 
         // Print input
         // print_frame(buffer, 10, "Input");
@@ -231,14 +207,11 @@ int main(int argc, char** argv)
 
         // FFT
         // fft_single_duration = clock();
-        fft(s, data_in);
+        fft(buffer);
         // fft_single_duration = clock() - fft_single_duration;
         // fft_full_duration += fft_single_duration;
         // printf("FFT Duration: %lfs.\n", (double)fft_single_duration / CLOCKS_PER_SEC);
-        cartesian_to_polar(data_out, amp, phs);
-
-        for (unsigned int i = 0; i < FFT_SIZE; i++)
-            amp[i] *= 2. / FRAME_SIZE;
+        spectrum_magnitude(amp, transform->spectrum, FFT_BINS, 2. / FRAME_SIZE);
 
         double max_amp = amp[0];
         unsigned int max_amp_sample;
@@ -293,6 +266,7 @@ int main(int argc, char** argv)
 
     fft_exit();
     // ifft_exit();
+    frame_assembler_destroy(frames);
     sf_close(infile);
     return EXIT_SUCCESS;
 }
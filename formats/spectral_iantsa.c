@@ -10,17 +10,25 @@
 
 #include <math.h>
 
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
+#include "spectrum.h"
+#include "window.h"
 
 /* taille de la fenetre */
 #define	FRAME_SIZE 1024
 #define FFT_SIZE 1024 //44100
+/* nombre de bins du demi-spectre */
+#define FFT_BINS (FFT_SIZE / 2 + 1)
+#define FRAME_BINS (FRAME_SIZE / 2 + 1)
 /* avancement */
 #define HOP_SIZE 1024
 
 static gnuplot_ctrl *h;
-static fftw_plan plan;
-static fftw_plan iplan;
+static real_fft *transform;
+static window *hann;
+static real_fft *itransform;
 
 static void
 usage (char *progname)
@@ -29,28 +37,6 @@ usage (char *progname)
 		) ;
 
 } 
-static void
-fill_buffer(double *buffer, double *new_buffer)
-{
-  int i;
-  double tmp[FRAME_SIZE-HOP_SIZE];
-  
-  /* save */
-  for (i=0;i<FRAME_SIZE-HOP_SIZE;i++)
-    tmp[i] = buffer[i+HOP_SIZE];
-  
-  /* save offset */
-  for (i=0;i<(FRAME_SIZE-HOP_SIZE);i++)
-    {
-      buffer[i] = tmp[i];
-    }
-  
-  for (i=0;i<HOP_SIZE;i++)
-    {
-      buffer[FRAME_SIZE-HOP_SIZE+i] = new_buffer[i];
-    }
-}
-
 static int
 read_n_samples (SNDFILE * infile, double * buffer, int channels, int n)
 {
@@ -103,69 +89,54 @@ dft (double s[FRAME_SIZE], double complex S[FRAME_SIZE])
 
 // FFT
 static void
-cartesian_to_polar (double complex S[FFT_SIZE], double amp[FFT_SIZE], double phs[FFT_SIZE])
+fft_init()
 {
-	for (int n = 0; n < FFT_SIZE; n++)
-	{
-		amp[n] = cabs(S[n]);
-		phs[n] = carg(S[n]);
-	}
-}
-
-static void
-fft_init(fftw_complex data_in[FFT_SIZE], fftw_complex data_out[FFT_SIZE])
-{
-	plan = fftw_plan_dft_1d(FFT_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+	transform = real_fft_create(FFT_SIZE, REAL_FFT_FORWARD);
+	hann = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
 }
 
+/* fenetre de Hann + zero-padding dans l'entree de la fft, en une passe */
 static void
-fft(double s[FFT_SIZE], fftw_complex data_in[FFT_SIZE])
+fft(const double frame[FRAME_SIZE])
 {
-	for (int i = 0; i < FFT_SIZE; i++)
-		data_in[i] = s[i];
-
-	fftw_execute(plan);
+	window_apply(hann, transform->signal, frame, FRAME_SIZE, FFT_SIZE);
+	real_fft_forward(transform);
 }
 
 static void
 fft_exit()
 {
-	fftw_destroy_plan(plan);
-}
-
-static double
-hann(double n)
-{
-	return 0.5 - 0.5*cos(2*M_PI*n / FRAME_SIZE);
+	real_fft_destroy(transform);
+	window_destroy(hann);
 }
 
 // IFFT
 static void
-polar_to_cartesian (double amp[FRAME_SIZE], double phs[FRAME_SIZE], double complex comp[FRAME_SIZE])
+polar_to_cartesian (double amp[FRAME_BINS], double phs[FRAME_BINS], double complex comp[FRAME_BINS])
 {
-	for (int n = 0; n < FRAME_SIZE; n++)
+	for (int n = 0; n < FRAME_BINS; n++)
 		comp[n] = amp[n]*cos(phs[n]) + amp[n]*sin(phs[n]) * I;
 }
 
 static void
-ifft_init(fftw_complex data_in[FRAME_SIZE], fftw_complex data_out[FRAME_SIZE])
+ifft_init()
 {
-	iplan = fftw_plan_dft_1d(FRAME_SIZE, data_in, data_out, FFTW_BACKWARD, FFTW_ESTIMATE);
+	itransform = real_fft_create(FRAME_SIZE, REAL_FFT_INVERSE);
 }
 
 static void
-ifft(fftw_complex data_out[FRAME_SIZE], double s[FRAME_SIZE])
+ifft(double s[FRAME_SIZE])
 {
-	fftw_execute(iplan);
+	real_fft_inverse(itransform);
 
 	for (int i = 0; i < FRAME_SIZE; i++)
-		s[i] = data_out[i]/FRAME_SIZE;
+		s[i] = itransform->signal[i]/FRAME_SIZE;
 }
 
 static void
 ifft_exit()
 {
-	fftw_destroy_plan(iplan);
+	real_fft_destroy(itransform);
 }
 
 
@@ -195,7 +166,7 @@ main (int argc, char * argv [])
 	/* Read WAV */
 	int nb_frames = 0;
 	double new_buffer[HOP_SIZE];
-	double buffer[FRAME_SIZE];
+	frame_assembler *frames = frame_assembler_create (FRAME_SIZE);
 
 	/* Plot Init */
 	h=gnuplot_init();
@@ -205,7 +176,7 @@ main (int argc, char * argv [])
 	for (i=0;i<(FRAME_SIZE/HOP_SIZE-1);i++)
 	  {
 	    if (read_samples (infile, new_buffer, sfinfo.channels)==1)
-	      fill_buffer(buffer, new_buffer);
+	      frame_assembler_push (frames, new_buffer, HOP_SIZE);
 	    else
 	      {
 		printf("not enough samples !!\n");
@@ -222,9 +193,8 @@ main (int argc, char * argv [])
 	double complex S[FRAME_SIZE];
 
 	// FFT
-	double fft_buffer[FFT_SIZE];
-	fftw_complex data_in[FFT_SIZE], data_out[FFT_SIZE];
-	fft_init(data_in, data_out);
+	fft_planner_init();
+	fft_init();
 
     // DFT vs FFT
     clock_t t1, t2;
@@ -232,21 +202,18 @@ main (int argc, char * argv [])
     double delta_t_sum = 0;
 
 	// IFFT
-	fftw_complex idata_in[FRAME_SIZE], idata_out[FRAME_SIZE];
-	ifft_init(idata_in, idata_out);
+	ifft_init();
 	double sound[FRAME_SIZE];
 	  	
-    double amp[FFT_SIZE], phs[FFT_SIZE];
+    double amp[FFT_BINS];
 	while (read_samples (infile, new_buffer, sfinfo.channels)==1)
 	  {
 	    /* Process Samples */
 	    printf("\nProcessing frame %d\n",nb_frames);
 
 	    /* hop size */
-	    fill_buffer(buffer, new_buffer);
-
-		for (int i = 0; i < FFT_SIZE; i++)
-			fft_buffer[i] = i < FRAME_SIZE ? buffer[i]*hann(i) : 0.;
+	    frame_assembler_push (frames, new_buffer, HOP_SIZE);
+	    const double *buffer = frame_assembler_get_frame (frames);
 
 	    // DFT
         // t1 = clock();
@@ -259,14 +226,14 @@ main (int argc, char * argv [])
 
 		// FFT
         // t1 = clock();
-		fft(fft_buffer, data_in);
+		fft(buffer);
         // t2 = clock();
         // delta_t = t2 - t1;
         // delta_t_sum += delta_t;
         // printf ("FFT: %f secondes\n", delta_t / CLOCKS_PER_SEC);
-		cartesian_to_polar(data_out, amp, phs);
+		// Normalized amplitudes (2/N)
+		spectrum_magnitude(amp, transform->spectrum, FFT_BINS, 2. / FRAME_SIZE);
 
-		// Normalize
 		double max_amp = amp[0]; 
 		int max_freq = 0;
 		for (int i = 1; i < FFT_SIZE/2; i++)
@@ -277,15 +244,11 @@ main (int argc, char * argv [])
 				max_freq = i;
 			}
 		}
-		printf("Max amplitude: %lf, Max frequence: %d\n", max_amp, max_freq);
-		printf("Amplitude normalization: %lf\n", max_amp * 2 / FRAME_SIZE);
+		printf("Max amplitude: %lf, Max frequence: %d\n", max_amp * FRAME_SIZE / 2, max_freq);
+		printf("Amplitude normalization: %lf\n", max_amp);
 		double freqHz = max_freq * 44100. / FFT_SIZE; // cross product
 		printf("Hertz correspondance: %lf ± %lf Hz\n", freqHz, 44100. / (2*FFT_SIZE)); 
 
-		for (int i = 0; i < FFT_SIZE; i++)
-			//amp[i] /= max_amp;
-			amp[i] = amp[i] * 2. / FRAME_SIZE;
-
 		// Parabolic interpolation
 		double al = 20 * log(amp[max_freq-1]);
 		double ac = 20 * log(amp[max_freq]);
@@ -304,8 +267,8 @@ main (int argc, char * argv [])
 	    // sleep(1);
 
 		// IFFT
-		// polar_to_cartesian(amp, phs, idata_in);
-		// ifft(idata_out, sound);
+		// polar_to_cartesian(amp, phs, itransform->spectrum);
+		// ifft(sound);
     
 	    nb_frames++;
 	  }
@@ -314,6 +277,7 @@ main (int argc, char * argv [])
 
 	sf_close (infile) ;
 	fft_exit();
+	frame_assembler_destroy (frames);
 	// ifft_exit();
 
 	return 0 ;
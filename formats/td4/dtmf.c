@@ -0,0 +1,228 @@
+#include "dtmf.h"
+
+#include <stdlib.h>
+
+#define DTMF_TONES (DTMF_ROWS + DTMF_COLUMNS)
+
+#define BLOCK_DURATION .02 // Seconds, 50 Hz wide filters.
+#define MIN_TONE_POWER 1e-5 // A tone of amplitude ~.0045 (-47 dBFS).
+#define MIN_TONE_SHARE .5 // Share of the frame energy in the two tones.
+#define RELATIVE_PEAK 4. // 6 dB above the other tones of the group.
+#define NORMAL_TWIST 6.3 // Row at most 8 dB above column.
+#define REVERSE_TWIST 2.5 // Column at most 4 dB above row.
+#define HARMONIC_RATIO .1 // Second harmonic at least 10 dB below.
+
+const double dtmf_row_frequencies[DTMF_ROWS] = { 697., 770., 852., 941. };
+const double dtmf_column_frequencies[DTMF_COLUMNS] = { 1209., 1336., 1477., 1633. };
+const char dtmf_keys[DTMF_ROWS][DTMF_COLUMNS] = {
+    { '1', '2', '3', 'A' },
+    { '4', '5', '6', 'B' },
+    { '7', '8', '9', 'C' },
+    { '*', '0', '#', 'D' }
+};
+
+dtmf_detector* dtmf_detector_create(const double sample_rate)
+{
+    dtmf_detector* const detector = malloc(sizeof(dtmf_detector));
+    if (detector == NULL)
+        return NULL;
+
+    double frequencies[2 * DTMF_TONES];
+    for (int i = 0; i < DTMF_ROWS; i++)
+        frequencies[i] = dtmf_row_frequencies[i];
+    for (int i = 0; i < DTMF_COLUMNS; i++)
+        frequencies[DTMF_ROWS + i] = dtmf_column_frequencies[i];
+    for (int i = 0; i < DTMF_TONES; i++)
+        frequencies[DTMF_TONES + i] = 2. * frequencies[i];
+
+    detector->block_size = sample_rate * BLOCK_DURATION;
+    detector->bank = goertzel_bank_create(frequencies, 2 * DTMF_TONES, sample_rate);
+    if (detector->bank == NULL) {
+        free(detector);
+        return NULL;
+    }
+    return detector;
+}
+
+// Index of the strongest tone of a group, if it stands out from the others.
+static int
+strongest_tone(const double* const powers, const int count)
+{
+    int strongest = 0;
+    for (int i = 1; i < count; i++)
+        if (powers[i] > powers[strongest])
+            strongest = i;
+
+    for (int i = 0; i < count; i++)
+        if (i != strongest && powers[strongest] < RELATIVE_PEAK * powers[i])
+            return -1;
+    return strongest;
+}
+
+char dtmf_detect(const dtmf_detector* const detector, const double* const frame, const int n, int* const row, int* const column)
+{
+    // Average the powers of the blocks, the last one takes the remaining samples.
+    const int blocks = n < 2 * detector->block_size ? 1 : n / detector->block_size;
+    double powers[2 * DTMF_TONES] = { 0. }, block_powers[2 * DTMF_TONES];
+    for (int block = 0; block < blocks; block++) {
+        const int start = block * detector->block_size;
+        const int size = block == blocks - 1 ? n - start : detector->block_size;
+        goertzel_bank_power(detector->bank, block_powers, frame + start, size);
+        for (int i = 0; i < 2 * DTMF_TONES; i++)
+            powers[i] += block_powers[i] * size / n;
+    }
+
+    const double* const row_powers = powers;
+    const double* const column_powers = powers + DTMF_ROWS;
+    const double* const harmonic_powers = powers + DTMF_TONES;
+
+    const int row_tone = strongest_tone(row_powers, DTMF_ROWS);
+    const int column_tone = strongest_tone(column_powers, DTMF_COLUMNS);
+    if (row_tone < 0 || column_tone < 0)
+        return '\0';
+
+    const double row_power = row_powers[row_tone];
+    const double column_power = column_powers[column_tone];
+    if (row_power < MIN_TONE_POWER || column_power < MIN_TONE_POWER)
+        return '\0';
+
+    if (row_power > NORMAL_TWIST * column_power || column_power > REVERSE_TWIST * row_power)
+        return '\0';
+
+    if (harmonic_powers[row_tone] > HARMONIC_RATIO * row_power || harmonic_powers[DTMF_ROWS + column_tone] > HARMONIC_RATIO * column_power)
+        return '\0';
+
+    double energy = 0.;
+    for (int sample = 0; sample < n; sample++)
+        energy += frame[sample] * frame[sample];
+    if (row_power + column_power < MIN_TONE_SHARE * energy / n)
+        return '\0';
+
+    if (row != NULL)
+        *row = row_tone;
+    if (column != NULL)
+        *column = column_tone;
+    return dtmf_keys[row_tone][column_tone];
+}
+
+void dtmf_detector_destroy(dtmf_detector* const detector)
+{
+    if (detector == NULL)
+        return;
+
+    goertzel_bank_destroy(detector->bank);
+    free(detector);
+}
+
+static void
+release(dtmf_decoder* const decoder)
+{
+    if (decoder->pressed.key == '\0')
+        return;
+
+    decoder->listener(&decoder->pressed, decoder->context);
+    decoder->pressed.key = '\0';
+}
+
+static void
+decode_frame(dtmf_decoder* const decoder)
+{
+    const double* const frame = frame_assembler_get_frame(decoder->frames);
+    const long frame_end = decoder->position;
+
+    char key = '\0';
+    if (decoder->gate == NULL || decoder->gate(frame, decoder->frame_size))
+        key = dtmf_detect(decoder->detector, frame, decoder->frame_size, NULL, NULL);
+
+    if (key != '\0' && key == decoder->candidate)
+        decoder->candidate_frames++;
+    else {
+        decoder->candidate = key;
+        decoder->candidate_frames = 1;
+        decoder->candidate_start = frame_end - decoder->frame_size;
+    }
+
+    if (decoder->pressed.key != '\0') {
+        if (key == decoder->pressed.key) {
+            decoder->pressed.end = frame_end;
+            decoder->missed_frames = 0;
+            return;
+        }
+        // Released once silent long enough, or replaced by another key.
+        if (++decoder->missed_frames >= DTMF_RELEASE_FRAMES || (key != '\0' && decoder->candidate_frames >= DTMF_PRESS_FRAMES))
+            release(decoder);
+    }
+
+    if (decoder->pressed.key == '\0' && key != '\0' && decoder->candidate_frames >= DTMF_PRESS_FRAMES) {
+        decoder->pressed.key = key;
+        decoder->pressed.start = decoder->candidate_start;
+        decoder->pressed.end = frame_end;
+        decoder->missed_frames = 0;
+    }
+}
+
+dtmf_decoder* dtmf_decoder_create(const double sample_rate, const int frame_size, const int hop_size, const dtmf_gate gate, const dtmf_listener listener, void* const context)
+{
+    dtmf_decoder* const decoder = malloc(sizeof(dtmf_decoder));
+    if (decoder == NULL)
+        return NULL;
+
+    decoder->detector = dtmf_detector_create(sample_rate);
+    decoder->frames = frame_assembler_create(frame_size);
+    if (decoder->detector == NULL || decoder->frames == NULL) {
+        dtmf_decoder_destroy(decoder);
+        return NULL;
+    }
+
+    decoder->frame_size = frame_size;
+    decoder->hop_size = hop_size;
+    decoder->hop_count = 0;
+    decoder->position = 0;
+    decoder->gate = gate;
+    decoder->candidate = '\0';
+    decoder->candidate_frames = 0;
+    decoder->candidate_start = 0;
+    decoder->pressed.key = '\0';
+    decoder->missed_frames = 0;
+    decoder->listener = listener;
+    decoder->context = context;
+    return decoder;
+}
+
+void dtmf_decoder_push(dtmf_decoder* const decoder, const double* const samples, const int n)
+{
+    int position = 0;
+    while (position < n) {
+        // Push up to the end of the current hop.
+        const int space = decoder->hop_size - decoder->hop_count;
+        const int pushed = n - position < space ? n - position : space;
+        frame_assembler_push(decoder->frames, samples + position, pushed);
+        decoder->hop_count += pushed;
+        decoder->position += pushed;
+        position += pushed;
+
+        if (decoder->hop_count == decoder->hop_size) {
+            decoder->hop_count = 0;
+            // The first frames are only complete once frame_size samples came in.
+            if (decoder->position >= decoder->frame_size)
+                decode_frame(decoder);
+        }
+    }
+}
+
+void dtmf_decoder_flush(dtmf_decoder* const decoder)
+{
+    release(decoder);
+    decoder->candidate = '\0';
+    decoder->candidate_frames = 0;
+}
+
+void dtmf_decoder_destroy(dtmf_decoder* const decoder)
+{
+    if (decoder == NULL)
+        return;
+
+    dtmf_detector_destroy(decoder->detector);
+    frame_assembler_destroy(decoder->frames);
+    free(decoder);
+}
@@ -0,0 +1,153 @@
+#ifndef DTMF_H
+#define DTMF_H
+
+#include <stdbool.h>
+
+#include "frame.h"
+#include "goertzel.h"
+
+/*
+ * DTMF tone detector.
+ *
+ * A Goertzel filter bank measures the 8 DTMF frequencies and their second
+ * harmonics in one pass over the frame. The frame is cut into ~20 ms blocks
+ * whose powers are averaged: short blocks have wide enough filters to accept
+ * the 1.5 % frequency deviation of real keypads, while averaging them keeps
+ * the whole frame's immunity to noise. A key is only reported when the frame
+ * holds exactly one row tone and one column tone:
+ * - both are loud enough and carry most of the frame energy,
+ * - each is well above the other tones of its group (relative peak),
+ * - their levels are close enough (normal and reverse twist),
+ * - neither has a strong second harmonic (rejects speech and music).
+ */
+
+#define DTMF_ROWS 4
+#define DTMF_COLUMNS 4
+
+extern const double dtmf_row_frequencies[DTMF_ROWS];
+extern const double dtmf_column_frequencies[DTMF_COLUMNS];
+extern const char dtmf_keys[DTMF_ROWS][DTMF_COLUMNS];
+
+typedef struct dtmf_detector {
+    goertzel_bank* bank; // Rows, columns, then their second harmonics.
+    int block_size; // Samples per Goertzel block.
+} dtmf_detector;
+
+/**
+ * @brief Creates a DTMF detector.
+ *
+ * @param sample_rate The sample rate (Hz).
+ * @return The detector, or NULL if the allocation failed.
+ */
+dtmf_detector* dtmf_detector_create(const double sample_rate);
+
+/**
+ * @brief Detects the key pressed during a frame.
+ *
+ * @param detector The detector.
+ * @param frame The frame.
+ * @param n The number of samples of the frame (at least a block).
+ * @param row The index of the row tone, if a key is detected (may be NULL).
+ * @param column The index of the column tone, if a key is detected (may be NULL).
+ * @return The key, or '\0' if the frame is not a valid DTMF tone pair.
+ */
+char dtmf_detect(const dtmf_detector* const detector, const double* const frame, const int n, int* const row, int* const column);
+
+/**
+ * @brief Destroys a DTMF detector.
+ *
+ * @param detector The detector.
+ */
+void dtmf_detector_destroy(dtmf_detector* const detector);
+
+/*
+ * Streaming DTMF decoder.
+ *
+ * Samples are pushed in blocks of any size. Every hop_size samples, the last
+ * frame_size samples go through an optional energy gate, then through the
+ * detector. A key is pressed once it is detected in DTMF_PRESS_FRAMES frames
+ * in a row, and released after DTMF_RELEASE_FRAMES frames without it (or when
+ * another key gets pressed). Released keys are handed to the listener, so a
+ * key is known about a frame plus a few hops after it ends.
+ */
+
+#define DTMF_PRESS_FRAMES 2
+#define DTMF_RELEASE_FRAMES 2
+
+typedef struct dtmf_event {
+    char key;
+    long start; // First sample of the first frame the key was detected in.
+    long end; // Sample after the last frame the key was detected in.
+} dtmf_event;
+
+/**
+ * @brief Listens to the keys of a DTMF decoder.
+ *
+ * @param event The released key.
+ * @param context The context given to the decoder.
+ */
+typedef void (*dtmf_listener)(const dtmf_event* const event, void* const context);
+
+/**
+ * @brief Tells whether a frame is worth analyzing (e.g. loud enough).
+ *
+ * @param frame The frame.
+ * @param frame_size The frame size.
+ * @return True if the frame should be analyzed.
+ */
+typedef bool (*dtmf_gate)(const double* const frame, const int frame_size);
+
+typedef struct dtmf_decoder {
+    dtmf_detector* detector;
+    frame_assembler* frames;
+    int frame_size;
+    int hop_size;
+    int hop_count; // Samples pushed since the last frame.
+    long position; // Samples pushed in total.
+    dtmf_gate gate; // NULL to analyze every frame.
+    char candidate; // Key detected in the last frames ('\0' for none).
+    int candidate_frames; // Number of frames in a row the candidate was detected in.
+    long candidate_start;
+    dtmf_event pressed; // Key currently pressed ('\0' for none).
+    int missed_frames; // Number of frames in a row without the pressed key.
+    dtmf_listener listener;
+    void* context;
+} dtmf_decoder;
+
+/**
+ * @brief Creates a streaming DTMF decoder.
+ *
+ * @param sample_rate The sample rate (Hz).
+ * @param frame_size The frame size (at least 20 ms of samples).
+ * @param hop_size The hop size (the smaller, the sooner keys are detected).
+ * @param gate The energy gate run before the detector (NULL for none).
+ * @param listener The key listener.
+ * @param context The context passed to the listener.
+ * @return The decoder, or NULL if the allocation failed.
+ */
+dtmf_decoder* dtmf_decoder_create(const double sample_rate, const int frame_size, const int hop_size, const dtmf_gate gate, const dtmf_listener listener, void* const context);
+
+/**
+ * @brief Pushes samples into the decoder, releasing keys as they end.
+ *
+ * @param decoder The decoder.
+ * @param samples The samples.
+ * @param n The number of samples.
+ */
+void dtmf_decoder_push(dtmf_decoder* const decoder, const double* const samples, const int n);
+
+/**
+ * @brief Ends the stream, releasing the key still pressed, if any.
+ *
+ * @param decoder The decoder.
+ */
+void dtmf_decoder_flush(dtmf_decoder* const decoder);
+
+/**
+ * @brief Destroys a streaming DTMF decoder.
+ *
+ * @param decoder The decoder.
+ */
+void dtmf_decoder_destroy(dtmf_decoder* const decoder);
+
+#endif // DTMF_H
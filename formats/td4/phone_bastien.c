@@ -6,6 +6,13 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "dtmf.h"
+#include "fft.h"
+#include "frame.h"
+#include "spectrum.h"
+#include "window.h"
 
 #define FRAME_SIZE 2646
 #define HOP_SIZE 2646
@@ -13,6 +20,10 @@
 #define CALIBRATION_FRAME_SIZE 8820
 #define CALIBRATION_HOP_SIZE 4410
 
+#define STREAM_FRAME_SIZE 1764 // 40 ms.
+#define STREAM_HOP_SIZE 441 // 10 ms.
+#define STREAM_BLOCK_SIZE 512
+
 static const char keys[4][3] = {
     { '1', '2', '3' },
     { '4', '5', '6' },
@@ -23,9 +34,12 @@ static const char keys[4][3] = {
 static const int line_frequencies[4] = { 697, 770, 852, 941 };
 static const int column_frequencies[3] = { 1209, 1336, 1477 };
 
-static fftw_plan fft_plan;
+static real_fft* fft_transform;
+static window* hann_window;
+static dtmf_detector* detector;
 
-static bool
+// Returns the number of samples read, less than hop_size at the end of the file.
+static int
 read_samples(double* const hop_buffer, SNDFILE* const input_file, const int hop_size, const char channels)
 {
     if (channels == 2) {
@@ -33,31 +47,14 @@ read_samples(double* const hop_buffer, SNDFILE* const input_file, const int hop_
         const int read_count = sf_readf_double(input_file, tmp, hop_size);
         for (int sample = 0; sample < read_count; sample++)
             hop_buffer[sample] = (tmp[sample * 2] + tmp[sample * 2 + 1]) / 2.;
-        return read_count == hop_size;
+        return read_count;
     }
 
-    if (channels == 1) {
-        const int read_count = sf_readf_double(input_file, hop_buffer, hop_size);
-        return read_count == hop_size;
-    }
+    if (channels == 1)
+        return sf_readf_double(input_file, hop_buffer, hop_size);
 
     fprintf(stderr, "Channel format error.\n");
-    return false;
-}
-
-static void
-fill_frame_buffer(double* const frame_buffer, const double* const hop_buffer, const int frame_size, const int hop_size)
-{
-    double tmp[frame_size - hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        tmp[sample] = frame_buffer[sample + hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        frame_buffer[sample] = tmp[sample];
-
-    for (int sample = 0; sample < hop_size; sample++)
-        frame_buffer[frame_size - hop_size + sample] = hop_buffer[sample];
+    return 0;
 }
 
 static bool
@@ -74,34 +71,17 @@ frame_is_useful(const double* const frame_buffer, const int frame_size)
 }
 
 static void
-hann(double* const frame_buffer, const int frame_size)
-{
-    for (int sample = 0; sample < frame_size; sample++)
-        frame_buffer[sample] *= .5 - .5 * cos(2. * M_PI * sample / FRAME_SIZE);
-}
-
-static void
-fft_init(fftw_complex* const fft_in, fftw_complex* const fft_out, const int fft_size)
+fft_init(const int frame_size, const int fft_size)
 {
-    fft_plan = fftw_plan_dft_1d(fft_size, fft_in, fft_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    fft_transform = real_fft_create(fft_size, REAL_FFT_FORWARD);
+    hann_window = window_create(WINDOW_HANN, frame_size, 0.);
 }
 
 static void
-fft(fftw_complex* const fft_in, const double* const signal, const int fft_size, const int frame_size)
+fft(const double* const frame_buffer, const int frame_size)
 {
-    for (int sample = 0; sample < fft_size; sample++)
-        fft_in[sample] = sample < frame_size ? signal[sample] : 0.;
-
-    fftw_execute(fft_plan);
-}
-
-static void
-cartesian_to_polar(double* const amplitudes, double* const phases, const double complex* const fft_out, const int fft_size)
-{
-    for (int sample = 0; sample < fft_size; sample++) {
-        amplitudes[sample] = cabs(fft_out[sample]);
-        phases[sample] = carg(fft_out[sample]);
-    }
+    window_apply(hann_window, fft_transform->signal, frame_buffer, frame_size, fft_transform->size);
+    real_fft_forward(fft_transform);
 }
 
 static void
@@ -159,11 +139,24 @@ get_key(const double* const key_frequencies)
 static void
 fft_exit()
 {
-    fftw_destroy_plan(fft_plan);
+    real_fft_destroy(fft_transform);
+    window_destroy(hann_window);
+}
+
+static void
+detector_init(const double sample_rate)
+{
+    detector = dtmf_detector_create(sample_rate);
 }
 
 static void
-calibrate(const char* const input_file_name, const int frame_size, const int hop_size)
+detector_exit()
+{
+    dtmf_detector_destroy(detector);
+}
+
+static void
+calibrate(const char* const input_file_name, const int frame_size, const int hop_size, const bool goertzel)
 {
     SNDFILE* input_file = NULL;
     SF_INFO input_info;
@@ -177,11 +170,11 @@ calibrate(const char* const input_file_name, const int frame_size, const int hop
     const int channels = input_info.channels;
 
     double hop_buffer[hop_size];
-    double frame_buffer[frame_size];
+    frame_assembler* const frames = frame_assembler_create(frame_size);
 
     for (int sample = 0; sample < frame_size / hop_size - 1; sample++) {
-        if (read_samples(hop_buffer, input_file, hop_size, channels))
-            fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
+        if (read_samples(hop_buffer, input_file, hop_size, channels) == hop_size)
+            frame_assembler_push(frames, hop_buffer, hop_size);
         else {
             fprintf(stderr, "Not enough samples.\n");
             exit(EXIT_FAILURE);
@@ -190,14 +183,18 @@ calibrate(const char* const input_file_name, const int frame_size, const int hop
 
     const int keys_pressed[12][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 0 }, { 1, 1 }, { 1, 2 }, { 2, 0 }, { 2, 1 }, { 2, 2 }, { 3, 1 }, { 3, 0 }, { 3, 2 } };
 
-    int fft_size = frame_size;
-    fftw_complex fft_in[fft_size], fft_out[fft_size];
-    double amplitudes[fft_size], phases[fft_size];
-    fft_init(fft_in, fft_out, fft_size);
+    const int fft_size = frame_size;
+    const int fft_bins = fft_size / 2 + 1;
+    double amplitudes[fft_bins];
+    if (goertzel)
+        detector_init(sample_rate);
+    else
+        fft_init(frame_size, fft_size);
 
     int frame_id = 0;
-    while (read_samples(hop_buffer, input_file, hop_size, channels)) {
-        fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
+    while (read_samples(hop_buffer, input_file, hop_size, channels) == hop_size) {
+        frame_assembler_push(frames, hop_buffer, hop_size);
+        const double* const frame_buffer = frame_assembler_get_frame(frames);
 
         if (frame_id % 3 != 0) {
             frame_id++;
@@ -206,9 +203,18 @@ calibrate(const char* const input_file_name, const int frame_size, const int hop
 
         printf("Calibrating key %c…\n", keys[keys_pressed[frame_id / 3][0]][keys_pressed[frame_id / 3][1]]);
 
-        hann(frame_buffer, frame_size);
-        fft(fft_in, frame_buffer, fft_size, frame_size);
-        cartesian_to_polar(amplitudes, phases, fft_out, fft_size);
+        if (goertzel) {
+            int line, column;
+            if (dtmf_detect(detector, frame_buffer, frame_size, &line, &column) == '\0')
+                printf("No key.\n");
+            else
+                printf("%d Hz & %d Hz.\n", (int)dtmf_row_frequencies[line], (int)dtmf_column_frequencies[column]);
+            frame_id++;
+            continue;
+        }
+
+        fft(frame_buffer, frame_size);
+        spectrum_magnitude(amplitudes, fft_transform->spectrum, fft_bins, 1.);
 
         double peak_frequencies[2];
         get_peak_frequencies(peak_frequencies, amplitudes, sample_rate, fft_size);
@@ -218,12 +224,50 @@ calibrate(const char* const input_file_name, const int frame_size, const int hop
     }
 
     printf("\n");
-    fft_exit();
+    if (goertzel)
+        detector_exit();
+    else
+        fft_exit();
+    frame_assembler_destroy(frames);
     sf_close(input_file);
 }
 
+typedef struct number_buffer {
+    char* keys;
+    int size;
+    int capacity;
+} number_buffer;
+
+static void
+append_key(const dtmf_event* const event, void* const context)
+{
+    number_buffer* const number = context;
+    if (number->size == number->capacity) {
+        number->capacity *= 2;
+        number->keys = (char*)realloc(number->keys, number->capacity * sizeof(char));
+    }
+    number->keys[number->size++] = event->key;
+}
+
+static char*
+stream_number(int* const number_size, SNDFILE* const input_file, const double sample_rate, const int channels)
+{
+    number_buffer number = { (char*)malloc(10 * sizeof(char)), 0, 10 };
+    dtmf_decoder* const decoder = dtmf_decoder_create(sample_rate, STREAM_FRAME_SIZE, STREAM_HOP_SIZE, frame_is_useful, append_key, &number);
+
+    // Blocks of any size do (the last one is short), keys are appended as soon as they are released.
+    double block_buffer[STREAM_BLOCK_SIZE];
+    for (int read_count; (read_count = read_samples(block_buffer, input_file, STREAM_BLOCK_SIZE, channels)) > 0;)
+        dtmf_decoder_push(decoder, block_buffer, read_count);
+    dtmf_decoder_flush(decoder);
+
+    dtmf_decoder_destroy(decoder);
+    *number_size = number.size;
+    return number.keys;
+}
+
 static char*
-get_number(int* const number_size, const char* const input_file_name, const int frame_size, const int hop_size)
+get_number(int* const number_size, const char* const input_file_name, const int frame_size, const int hop_size, const bool goertzel)
 {
     SNDFILE* input_file = NULL;
     SF_INFO input_info;
@@ -236,30 +280,37 @@ get_number(int* const number_size, const char* const input_file_name, const int
     const double sample_rate = input_info.samplerate;
     const int channels = input_info.channels;
 
+    if (goertzel) {
+        char* const number = stream_number(number_size, input_file, sample_rate, channels);
+        sf_close(input_file);
+        return number;
+    }
+
     double hop_buffer[hop_size];
-    double frame_buffer[frame_size];
+    frame_assembler* const frames = frame_assembler_create(frame_size);
 
     for (int sample = 0; sample < frame_size / hop_size - 1; sample++) {
-        if (read_samples(hop_buffer, input_file, hop_size, channels))
-            fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
+        if (read_samples(hop_buffer, input_file, hop_size, channels) == hop_size)
+            frame_assembler_push(frames, hop_buffer, hop_size);
         else {
             fprintf(stderr, "Not enough samples.\n");
             exit(EXIT_FAILURE);
         }
     }
 
-    int fft_size = frame_size;
-    fftw_complex fft_in[fft_size], fft_out[fft_size];
-    double amplitudes[fft_size], phases[fft_size];
-    fft_init(fft_in, fft_out, fft_size);
+    const int fft_size = frame_size;
+    const int fft_bins = fft_size / 2 + 1;
+    double amplitudes[fft_bins];
+    fft_init(frame_size, fft_size);
 
     int frame_id = 0;
     int number_capacity = 10;
     *number_size = 0;
     char* number = (char*)malloc(number_capacity * sizeof(char));
     bool next = true;
-    while (read_samples(hop_buffer, input_file, hop_size, channels)) {
-        fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
+    while (read_samples(hop_buffer, input_file, hop_size, channels) == hop_size) {
+        frame_assembler_push(frames, hop_buffer, hop_size);
+        const double* const frame_buffer = frame_assembler_get_frame(frames);
 
         if (!frame_is_useful(frame_buffer, frame_size)) {
             next = true;
@@ -272,9 +323,8 @@ get_number(int* const number_size, const char* const input_file_name, const int
             continue;
         }
 
-        hann(frame_buffer, frame_size);
-        fft(fft_in, frame_buffer, fft_size, frame_size);
-        cartesian_to_polar(amplitudes, phases, fft_out, fft_size);
+        fft(frame_buffer, frame_size);
+        spectrum_magnitude(amplitudes, fft_transform->spectrum, fft_bins, 1.);
 
         double peak_frequencies[2];
         get_peak_frequencies(peak_frequencies, amplitudes, sample_rate, fft_size);
@@ -289,6 +339,7 @@ get_number(int* const number_size, const char* const input_file_name, const int
     }
 
     fft_exit();
+    frame_assembler_destroy(frames);
     sf_close(input_file);
     return number;
 }
@@ -304,27 +355,36 @@ print_number(const char* const number, const int number_size, const char* const
 
 int main(const int argc, const char* const* const argv)
 {
-    calibrate("sounds/telbase.wav", CALIBRATION_FRAME_SIZE, CALIBRATION_HOP_SIZE);
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "--goertzel") != 0)) {
+        fprintf(stderr, "Usage: %s [--goertzel].\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    // Goertzel filter bank on the 8 DTMF tones instead of a whole FFT per frame.
+    const bool goertzel = argc == 2;
+    fft_planner_init();
+
+    calibrate("sounds/telbase.wav", CALIBRATION_FRAME_SIZE, CALIBRATION_HOP_SIZE, goertzel);
 
     char* number;
     int number_size;
 
-    number = get_number(&number_size, "sounds/telbase.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telbase.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telbase.wav");
 
-    number = get_number(&number_size, "sounds/telA.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telA.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telA.wav");
 
-    number = get_number(&number_size, "sounds/telB.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telB.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telB.wav");
 
-    number = get_number(&number_size, "sounds/telC.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telC.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telC.wav");
 
-    number = get_number(&number_size, "sounds/telD.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telD.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telD.wav");
 
-    number = get_number(&number_size, "sounds/telE.wav", FRAME_SIZE, HOP_SIZE);
+    number = get_number(&number_size, "sounds/telE.wav", FRAME_SIZE, HOP_SIZE, goertzel);
     print_number(number, number_size, "sounds/telE.wav");
 
     free(number);
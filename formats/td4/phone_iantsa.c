@@ -5,16 +5,30 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "dtmf.h"
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
+#include "spectrum.h"
+#include "window.h"
 
 #define PLOT false
 
 #define FRAME_SIZE 2867 // 8820 // 158760
 #define HOP_SIZE 2867 // 4410 // 1024
+#define BINS (FRAME_SIZE / 2 + 1) // Half spectrum of a real frame.
+
+#define STREAM_FRAME_SIZE 1764 // 40 ms.
+#define STREAM_HOP_SIZE 441 // 10 ms, keys are detected within a frame and a few hops.
+
+#define ENERGY_THRESHOLD 0.005 // Frames below are null.
 
 static gnuplot_ctrl* h; // Plot graph.
-static fftw_plan plan; // FFT plan.
+static real_fft* transform; // Real FFT.
+static window* hann; // Hann window table.
+static window* stream_hann; // Hann window table of the streaming gate.
 
 // Correspondance table.
 static double line[4] = { 697., 770., 852., 941. };
@@ -27,28 +41,6 @@ static char c_tab[4][3] = {
     { '*', '0', '#' }
 };
 
-/**
- * @brief Fills the frame buffer from the hop buffer.
- *
- * @param buffer The frame buffer.
- * @param new_buffer The hop buffer.
- */
-static void
-fill_buffer(double* buffer, double* new_buffer)
-{
-    int i;
-    double tmp[FRAME_SIZE - HOP_SIZE];
-
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
-
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        buffer[i] = tmp[i];
-
-    for (i = 0; i < HOP_SIZE; i++)
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-}
-
 /**
  * @brief Reads n samples from file into the buffer.
  *
@@ -56,22 +48,20 @@ fill_buffer(double* buffer, double* new_buffer)
  * @param buffer The buffer to fill.
  * @param channels The number of channels of the sound.
  * @param n The number of samples to read into buffer.
- * @return True if the program read n samples successfully; false otherwise.
+ * @return The number of samples read (less than n at the end of the file).
  */
 static int
 read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
 {
     if (channels == 1) {
-        int readcount;
-        readcount = sf_readf_double(infile, buffer, n);
-        return readcount == n;
+        return sf_readf_double(infile, buffer, n);
     } else if (channels == 2) {
         double buf[2 * n];
         int readcount;
         readcount = sf_readf_double(infile, buf, n);
         for (int k = 0; k < readcount; k++)
             buffer[k] = (buf[k * 2] + buf[k * 2 + 1]) / 2.;
-        return readcount == n;
+        return readcount;
     } else
         printf("Channel format error.\n");
     return 0;
@@ -83,7 +73,7 @@ read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
  * @param infile The file (sound) to read.
  * @param buffer The hop buffer to fill.
  * @param channels The number of channels of the sound.
- * @return True if the program read HOP_SIZE samples successfully; false otherwise.
+ * @return The number of samples read (less than HOP_SIZE at the end of the file).
  */
 static int
 read_samples(SNDFILE* infile, double* buffer, int channels)
@@ -92,46 +82,25 @@ read_samples(SNDFILE* infile, double* buffer, int channels)
 }
 
 /**
- * @brief Converts a complex signal from the FFT into two signals of amplitude and phase.
- *
- * @param S The complex signal.
- * @param amp The amplitude signal.
- * @param phs The phase signal.
- */
-static void
-cartesian_to_polar(double complex S[FRAME_SIZE], double amp[FRAME_SIZE], double phs[FRAME_SIZE])
-{
-    for (int n = 0; n < FRAME_SIZE; n++) {
-        amp[n] = cabs(S[n]);
-        phs[n] = carg(S[n]);
-    }
-}
-
-/**
- * @brief Initializes the FFT by declaring the data in and out buffers.
- *
- * @param data_in The complex signal before FFT.
- * @param data_out The complex signal after FFT.
+ * @brief Initializes the real FFT (its half spectrum is in transform->spectrum) and the Hann window table.
  */
 static void
-fft_init(fftw_complex data_in[FRAME_SIZE], fftw_complex data_out[FRAME_SIZE])
+fft_init()
 {
-    plan = fftw_plan_dft_1d(FRAME_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    transform = real_fft_create(FRAME_SIZE, REAL_FFT_FORWARD);
+    hann = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
 }
 
 /**
- * @brief Executes the FFT.
+ * @brief Windows the frame into the FFT input (kept in transform->signal) and executes the FFT.
  *
- * @param s The input signal (that will be stored into the pre FFT buffer).
- * @param data_in The pre FFT buffer.
+ * @param frame The frame (original signal).
  */
 static void
-fft(double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
+fft(const double frame[FRAME_SIZE])
 {
-    for (int i = 0; i < FRAME_SIZE; i++)
-        data_in[i] = s[i];
-
-    fftw_execute(plan);
+    window_apply(hann, transform->signal, frame, FRAME_SIZE, FRAME_SIZE);
+    real_fft_forward(transform);
 }
 
 /**
@@ -140,7 +109,8 @@ fft(double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
 static void
 fft_exit()
 {
-    fftw_destroy_plan(plan);
+    real_fft_destroy(transform);
+    window_destroy(hann);
 }
 
 /**
@@ -150,10 +120,10 @@ fft_exit()
  * @param amp
  */
 static void
-display_nb_peaks(double amp[FRAME_SIZE])
+display_nb_peaks(double amp[BINS])
 {
     int n_peaks = 0;
-    for (int i = 1; i < FRAME_SIZE - 1; i++)
+    for (int i = 1; i < BINS - 1; i++)
         if (amp[i] >= amp[i - 1] && amp[i] > amp[i + 1])
             n_peaks++;
 
@@ -170,7 +140,7 @@ display_nb_peaks(double amp[FRAME_SIZE])
  * @return The peak frequency computed.
  */
 static double
-parabolic_interpolation(double amp[FRAME_SIZE], int sample, int SAMPLE_RATE)
+parabolic_interpolation(double amp[BINS], int sample, int SAMPLE_RATE)
 {
     double al = 20 * log(amp[sample - 1]);
     double ac = 20 * log(amp[sample]);
@@ -189,7 +159,7 @@ parabolic_interpolation(double amp[FRAME_SIZE], int sample, int SAMPLE_RATE)
  * @param SAMPLE_RATE
  */
 static void
-retrieve_2_freq(double amp[FRAME_SIZE], double* freq1, double* freq2, int SAMPLE_RATE)
+retrieve_2_freq(double amp[BINS], double* freq1, double* freq2, int SAMPLE_RATE)
 {
     int peak1_sample = 0, peak2_sample = 0;
     for (int i = 1; i < FRAME_SIZE / 2 - 1; i++)
@@ -210,18 +180,6 @@ retrieve_2_freq(double amp[FRAME_SIZE], double* freq1, double* freq2, int SAMPLE
     *freq2 = round(parabolic_interpolation(amp, peak2_sample, SAMPLE_RATE));
 }
 
-/**
- * @brief Converts a signal value into Hann window.
- *
- * @param n The value to convert.
- * @return The converted value.
- */
-static double
-hann(double n)
-{
-    return .5 - .5 * cos(2 * M_PI * n / FRAME_SIZE);
-}
-
 /**
  * @brief Finds the index of the first occurrence of an element in an list of double.
  *
@@ -288,18 +246,80 @@ decode(double freq1, double freq2)
  * @brief Computes energy of the signal on a portion in buffer.
  *
  * @param buffer
+ * @param n The number of samples.
  */
 static double
-energy(double buffer[FRAME_SIZE])
+energy(const double* buffer, int n)
 {
     double e = 0;
-    for (int i = 0; i < FRAME_SIZE; i++)
+    for (int i = 0; i < n; i++)
         e += buffer[i] * buffer[i];
-    return e / FRAME_SIZE;
+    return e / n;
+}
+
+/**
+ * @brief Tells whether a frame of the stream is not null, with the same test as the FFT path (on the Hann windowed frame).
+ *
+ * @param frame The frame.
+ * @param frame_size The frame size (STREAM_FRAME_SIZE).
+ * @return True if the frame should be analyzed.
+ */
+static bool
+frame_is_useful(const double* const frame, const int frame_size)
+{
+    double buffer[frame_size];
+    window_apply(stream_hann, buffer, frame, frame_size, frame_size);
+
+    const double e = energy(buffer, frame_size);
+    return e > 0 && e >= ENERGY_THRESHOLD;
+}
+
+/**
+ * @brief Prints a key as soon as the decoder releases it.
+ *
+ * @param event The key event.
+ * @param context Unused.
+ */
+static void
+print_key(const dtmf_event* const event, void* const context)
+{
+    printf("%c", event->key);
+    fflush(stdout);
+}
+
+/**
+ * @brief Decodes the keys of a sound with the streaming Goertzel decoder, and prints them.
+ *
+ * @param infile The file (sound) to read.
+ * @param SAMPLE_RATE The sample rate.
+ * @param channels The number of channels of the sound.
+ */
+static void
+stream_keys(SNDFILE* infile, int SAMPLE_RATE, int channels)
+{
+    stream_hann = window_create(WINDOW_HANN, STREAM_FRAME_SIZE, 0.);
+    dtmf_decoder* decoder = dtmf_decoder_create(SAMPLE_RATE, STREAM_FRAME_SIZE, STREAM_HOP_SIZE, frame_is_useful, print_key, NULL);
+
+    // Push the hops as they come, whatever their size (the last one is short).
+    double new_buffer[HOP_SIZE];
+    int readcount;
+    while ((readcount = read_samples(infile, new_buffer, channels)) > 0)
+        dtmf_decoder_push(decoder, new_buffer, readcount);
+    dtmf_decoder_flush(decoder);
+    printf("\n");
+
+    dtmf_decoder_destroy(decoder);
+    window_destroy(stream_hann);
 }
 
+/**
+ * @brief Decodes the keys pressed in a sound file and prints them.
+ *
+ * @param infilename The sound file.
+ * @param goertzel Whether to decode the tones with the streaming Goertzel decoder instead of an FFT.
+ */
 static void
-phone(char* infilename)
+phone(char* infilename, bool goertzel)
 {
     // Init file accessing.
     SNDFILE* infile = NULL;
@@ -315,7 +335,7 @@ phone(char* infilename)
     // Init file reading.
     int nb_frames = 0;
     double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
+    frame_assembler* const frames = frame_assembler_create(FRAME_SIZE);
 
     // Init ploting.
     h = gnuplot_init();
@@ -323,8 +343,8 @@ phone(char* infilename)
 
     // Check whether FRAME_SIZE & HOP_FILE are correct for file.
     for (int i = 0; i < FRAME_SIZE / HOP_SIZE - 1; i++) {
-        if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
+        if (read_samples(infile, new_buffer, sfinfo.channels) == HOP_SIZE)
+            frame_assembler_push(frames, new_buffer, HOP_SIZE);
         else {
             fprintf(stderr, "Not enough samples.\n");
             exit(EXIT_FAILURE);
@@ -341,28 +361,32 @@ phone(char* infilename)
     printf("Channels: %d.\n", NUM_CHANNELS);
     printf("Size: %d.\n", SIZE);
 
+    if (goertzel) {
+        stream_keys(infile, SAMPLE_RATE, sfinfo.channels);
+        frame_assembler_destroy(frames);
+        sf_close(infile);
+        return;
+    }
+
     // Initialize FFT.
-    double amp[FRAME_SIZE], phs[FRAME_SIZE];
-    fftw_complex data_in[FRAME_SIZE], data_out[FRAME_SIZE];
-    fft_init(data_in, data_out);
+    double amp[BINS];
+    fft_init();
 
     bool is_prev_silence = false;
     char prev_key = ' ';
 
     // Loop over each frame.
-    while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
+    while (read_samples(infile, new_buffer, sfinfo.channels) == HOP_SIZE) {
         // printf("\nProcessing frame %d…\n", nb_frames);
 
-        // Fill frame buffer (original signal during the frame).
-        fill_buffer(buffer, new_buffer);
-
-        // Hann window.
-        for (int i = 0; i < FRAME_SIZE; i++)
-            buffer[i] *= hann(i);
+        // Push hop into the frame (original signal during the frame).
+        frame_assembler_push(frames, new_buffer, HOP_SIZE);
+        const double* const frame = frame_assembler_get_frame(frames);
 
-        // Execute FFT.
-        fft(buffer, data_in);
-        cartesian_to_polar(data_out, amp, phs);
+        // Hann window and FFT.
+        fft(frame);
+        const double* const buffer = transform->signal; // Windowed frame.
+        spectrum_magnitude(amp, transform->spectrum, BINS, 1.);
 
         // Normalize amplitude signal (values between 0 and 1).
         // for (int i = 0; i < FRAME_SIZE; i++)
@@ -371,7 +395,7 @@ phone(char* infilename)
         // Retrieve maximum amplitude, and position associated.
         double max_amp = amp[0];
         int max_amp_i = 0;
-        for (int i = 1; i < FRAME_SIZE / 2; i++) { // No need to go further, the other half is symetrical.
+        for (int i = 1; i < FRAME_SIZE / 2; i++) {
             if (max_amp < amp[i]) {
                 max_amp = amp[i];
                 max_amp_i = i;
@@ -379,8 +403,7 @@ phone(char* infilename)
         }
 
         // Check if signal is not null.
-        double threshold = 0.005;
-        if (max_amp == 0 || energy(buffer) < threshold) {
+        if (max_amp == 0 || energy(buffer, FRAME_SIZE) < ENERGY_THRESHOLD) {
             // printf("Null frame, skipping…\n");
             is_prev_silence = true;
             nb_frames++;
@@ -409,7 +432,7 @@ phone(char* infilename)
             printf("%c", key);
 
         // Display frame energy.
-        // printf("%lf\n", energy(buffer));
+        // printf("%lf\n", energy(buffer, FRAME_SIZE));
 
         // Display the frame.
         if (PLOT) {
@@ -430,28 +453,37 @@ phone(char* infilename)
 
     // Shut down FFT, close file and exit program.
     fft_exit();
+    frame_assembler_destroy(frames);
     sf_close(infile);
 }
 
 int main(int argc, char** argv)
 {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "--goertzel") != 0)) {
+        fprintf(stderr, "Usage: %s [--goertzel]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    bool goertzel = argc == 2;
+    fft_planner_init();
+
     printf("--- \"sounds/telbase.wav\" ---\n");
-    phone("sounds/telbase.wav");
+    phone("sounds/telbase.wav", goertzel);
 
     printf("\n--- \"sounds/telA.wav\" ---\n");
-    phone("sounds/telA.wav");
+    phone("sounds/telA.wav", goertzel);
 
     printf("\n--- \"sounds/telB.wav\" ---\n");
-    phone("sounds/telB.wav");
+    phone("sounds/telB.wav", goertzel);
 
     printf("\n--- \"sounds/telC.wav\" ---\n");
-    phone("sounds/telC.wav");
+    phone("sounds/telC.wav", goertzel);
 
     printf("\n--- \"sounds/telD.wav\" ---\n");
-    phone("sounds/telD.wav");
+    phone("sounds/telD.wav", goertzel);
 
     printf("\n--- \"sounds/telE.wav\" ---\n");
-    phone("sounds/telE.wav");
+    phone("sounds/telE.wav", goertzel);
 
     return EXIT_SUCCESS;
 }
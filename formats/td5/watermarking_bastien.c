@@ -6,6 +6,13 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "fft.h"
+#include "segment.h"
+#include "spectrum.h"
+#include "window.h"
 
 #define FRAME_SIZE 2205
 #define HOP_SIZE 2205
@@ -15,42 +22,9 @@
 static const char* event_types[3] = { "Event A", "Event B", "Event C" };
 static const int event_frequencies[3] = { 19122, 19581, 20034 };
 
-static fftw_plan fft_plan;
-
-static bool
-read_samples(double* const hop_buffer, SNDFILE* const input_file, const int hop_size, const char channels)
-{
-    if (channels == 2) {
-        double tmp[2 * hop_size];
-        const int read_count = sf_readf_double(input_file, tmp, hop_size);
-        for (int sample = 0; sample < read_count; sample++)
-            hop_buffer[sample] = (tmp[sample * 2] + tmp[sample * 2 + 1]) / 2.;
-        return read_count == hop_size;
-    }
-
-    if (channels == 1) {
-        const int read_count = sf_readf_double(input_file, hop_buffer, hop_size);
-        return read_count == hop_size;
-    }
-
-    fprintf(stderr, "Channel format error.\n");
-    return false;
-}
-
-static void
-fill_frame_buffer(double* const frame_buffer, const double* const hop_buffer, const int frame_size, const int hop_size)
-{
-    double tmp[frame_size - hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        tmp[sample] = frame_buffer[sample + hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        frame_buffer[sample] = tmp[sample];
-
-    for (int sample = 0; sample < hop_size; sample++)
-        frame_buffer[frame_size - hop_size + sample] = hop_buffer[sample];
-}
+// Files and segments are handled in parallel, so each thread has its own FFT and window.
+static _Thread_local real_fft* fft_transform;
+static _Thread_local window* hann_window;
 
 static bool
 frame_is_useful(const double* const frame_buffer, const int frame_size)
@@ -66,34 +40,17 @@ frame_is_useful(const double* const frame_buffer, const int frame_size)
 }
 
 static void
-hann(double* const frame_buffer, const int frame_size)
+fft_init(const int frame_size, const int fft_size)
 {
-    for (int sample = 0; sample < frame_size; sample++)
-        frame_buffer[sample] *= .5 - .5 * cos(2. * M_PI * sample / FRAME_SIZE);
-}
-
-static void
-fft_init(fftw_complex* const fft_in, fftw_complex* const fft_out, const int fft_size)
-{
-    fft_plan = fftw_plan_dft_1d(fft_size, fft_in, fft_out, FFTW_FORWARD, FFTW_ESTIMATE);
+    fft_transform = real_fft_create(fft_size, REAL_FFT_FORWARD);
+    hann_window = window_create(WINDOW_HANN, frame_size, 0.);
 }
 
 static void
-fft(fftw_complex* const fft_in, const double* const signal, const int fft_size, const int frame_size)
+fft(const double* const frame_buffer, const int frame_size)
 {
-    for (int sample = 0; sample < fft_size; sample++)
-        fft_in[sample] = sample < frame_size ? signal[sample] : 0.;
-
-    fftw_execute(fft_plan);
-}
-
-static void
-cartesian_to_polar(double* const amplitudes, double* const phases, const double complex* const fft_out, const int fft_size)
-{
-    for (int sample = 0; sample < fft_size; sample++) {
-        amplitudes[sample] = cabs(fft_out[sample]);
-        phases[sample] = carg(fft_out[sample]);
-    }
+    window_apply(hann_window, fft_transform->signal, frame_buffer, frame_size, fft_transform->size);
+    real_fft_forward(fft_transform);
 }
 
 static int
@@ -131,80 +88,106 @@ is_frame_event(const double* const amplitudes, const int sample_rate, const int
 static void
 fft_exit()
 {
-    fftw_destroy_plan(fft_plan);
+    real_fft_destroy(fft_transform);
+    window_destroy(hann_window);
+}
+
+static void
+segment_init(void* const context)
+{
+    fft_init(FRAME_SIZE, FRAME_SIZE);
 }
 
 static void
-handle_events(const char* const input_file_name, const int frame_size, const int hop_size)
+handle_frame(const double* const frame_buffer, const long frame_id, FILE* const output, void* const context)
 {
+    const double sample_rate = ((const SF_INFO*)context)->samplerate;
+    const int frame_size = FRAME_SIZE;
+    const int fft_size = frame_size;
+    const int fft_bins = fft_size / 2 + 1;
+    double amplitudes[fft_bins];
+
+    if (!frame_is_useful(frame_buffer, frame_size))
+        return;
+
+    fft(frame_buffer, frame_size);
+    spectrum_magnitude(amplitudes, fft_transform->spectrum, fft_bins, 1.);
+
+    int event_type = is_frame_event(amplitudes, sample_rate, fft_size);
+    if (event_type >= 0) {
+        const double time = frame_id * frame_size / sample_rate;
+        const double time_precision = frame_size / (2 * sample_rate);
+        fprintf(output, "  - %.2lf s (± %.3lf s): %s.\n", time, time_precision, event_types[event_type]);
+    }
+}
+
+static void
+segment_exit(void* const context)
+{
+    fft_exit();
+}
+
+static int
+handle_events(const char* const input_file_name, FILE* const output, void* const context)
+{
+    const int segments = *(const int*)context;
+
     SNDFILE* input_file = NULL;
     SF_INFO input_info;
     if ((input_file = sf_open(input_file_name, SFM_READ, &input_info)) == NULL) {
         fprintf(stderr, "Not able to open input file %s.\n", input_file_name);
-        puts(sf_strerror(NULL));
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "%s\n", sf_strerror(NULL));
+        return -1;
     }
+    sf_close(input_file);
 
-    const double sample_rate = input_info.samplerate;
-    const int channels = input_info.channels;
-
-    double hop_buffer[hop_size];
-    double frame_buffer[frame_size];
+    fprintf(output, "Events in %s:\n", input_file_name);
 
-    for (int sample = 0; sample < frame_size / hop_size - 1; sample++) {
-        if (read_samples(hop_buffer, input_file, hop_size, channels))
-            fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
-        else {
-            fprintf(stderr, "Not enough samples.\n");
-            exit(EXIT_FAILURE);
-        }
+    const segment_pipeline pipeline = { segment_init, handle_frame, segment_exit, &input_info };
+    if (segment_analyze(input_file_name, FRAME_SIZE, HOP_SIZE, segments, &pipeline, output) < 0) {
+        fprintf(stderr, "Not able to read input file %s.\n", input_file_name);
+        return -1;
     }
 
-    int fft_size = frame_size;
-    fftw_complex fft_in[fft_size], fft_out[fft_size];
-    double amplitudes[fft_size], phases[fft_size];
-    fft_init(fft_in, fft_out, fft_size);
-
-    int frame_id = 0;
-    while (read_samples(hop_buffer, input_file, hop_size, channels)) {
-        fill_frame_buffer(frame_buffer, hop_buffer, frame_size, hop_size);
-
-        if (!frame_is_useful(frame_buffer, frame_size)) {
-            frame_id++;
-            continue;
-        }
-
-        hann(frame_buffer, frame_size);
-        fft(fft_in, frame_buffer, fft_size, frame_size);
-        cartesian_to_polar(amplitudes, phases, fft_out, fft_size);
-
-        int event_type = is_frame_event(amplitudes, sample_rate, fft_size);
-        if (event_type >= 0) {
-            const double time = frame_id * frame_size / sample_rate;
-            const double time_precision = frame_size / (2 * sample_rate);
-            printf("  - %.2lf s (± %.3lf s): %s.\n", time, time_precision, event_types[event_type]);
-        }
-
-        frame_id++;
-    }
+    fprintf(output, "\n");
+    return 0;
+}
 
-    fft_exit();
-    sf_close(input_file);
+static void
+usage(const char* const program)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [-s segments] [sound files or patterns...]\n", program);
+    exit(EXIT_FAILURE);
 }
 
-int main(const int argc, const char* const* const argv)
+int main(const int argc, char* const* const argv)
 {
-    printf("Events in sounds/flux1.wav:\n");
-    handle_events("sounds/flux1.wav", FRAME_SIZE, HOP_SIZE);
+    static const char* const default_patterns[] = { "sounds/flux*.wav" };
+
+    int threads = batch_threads();
+    int segments = 0;
+    for (int option; (option = getopt(argc, argv, "j:s:")) != -1;)
+        if (option == 'j' && (threads = atoi(optarg)) > 0)
+            continue;
+        else if (option == 's' && (segments = atoi(optarg)) > 0)
+            continue;
+        else
+            usage(argv[0]);
 
-    printf("\nEvents in sounds/flux2.wav:\n");
-    handle_events("sounds/flux2.wav", FRAME_SIZE, HOP_SIZE);
+    fft_planner_init();
 
-    printf("\nEvents in sounds/flux3.wav:\n");
-    handle_events("sounds/flux3.wav", FRAME_SIZE, HOP_SIZE);
+    int input_count;
+    char** const input_file_names = argc > optind
+        ? batch_expand((const char* const*)argv + optind, argc - optind, &input_count)
+        : batch_expand(default_patterns, 1, &input_count);
+    if (input_file_names == NULL)
+        return EXIT_FAILURE;
 
-    printf("\nEvents in sounds/flux4.wav:\n");
-    handle_events("sounds/flux4.wav", FRAME_SIZE, HOP_SIZE);
+    // Several files are handled in parallel, a single one in parallel segments.
+    if (segments == 0)
+        segments = input_count == 1 ? threads : 1;
 
-    return EXIT_SUCCESS;
+    const int failures = batch_run((const char* const*)input_file_names, input_count, threads, handle_events, &segments, stdout);
+    batch_free_paths(input_file_names, input_count);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
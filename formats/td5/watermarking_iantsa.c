@@ -5,129 +5,53 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include "batch.h"
+#include "fft.h"
 #include "gnuplot_i.h"
+#include "segment.h"
+#include "spectrum.h"
+#include "window.h"
 
 #define PLOT false
 
 #define FRAME_SIZE 2205
 #define HOP_SIZE 2205
+#define BINS (FRAME_SIZE / 2 + 1) // Half spectrum of a real frame.
 
 #define AMP_THRESHOLD 40.
 #define EVENT_TIME 0.05
 
-static gnuplot_ctrl* h; // Plot graph.
-static fftw_plan plan; // FFT plan.
+// Files and segments are processed in parallel, each thread has its own plot, FFT and window.
+static _Thread_local gnuplot_ctrl* h; // Plot graph.
+static _Thread_local real_fft* transform; // Real FFT.
+static _Thread_local window* hann; // Hann window table.
 
 // Correspondance table.
 static char event_name[3] = { 'A', 'B', 'C' };
 static double event_freq[3] = { 19126., 19584., 20032. };
 
 /**
- * @brief Fills the frame buffer from the hop buffer.
- *
- * @param buffer The frame buffer.
- * @param new_buffer The hop buffer.
+ * @brief Initializes the real FFT (its half spectrum is in transform->spectrum) and the Hann window table.
  */
 static void
-fill_buffer(double* buffer, double* new_buffer)
-{
-    int i;
-    double tmp[FRAME_SIZE - HOP_SIZE];
-
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
-
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        buffer[i] = tmp[i];
-
-    for (i = 0; i < HOP_SIZE; i++)
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-}
-
-/**
- * @brief Reads n samples from file into the buffer.
- *
- * @param infile The file (sound) to read.
- * @param buffer The buffer to fill.
- * @param channels The number of channels of the sound.
- * @param n The number of samples to read into buffer.
- * @return True if the program read n samples successfully; false otherwise.
- */
-static int
-read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
+fft_init()
 {
-    if (channels == 1) {
-        int readcount;
-        readcount = sf_readf_double(infile, buffer, n);
-        return readcount == n;
-    } else if (channels == 2) {
-        double buf[2 * n];
-        int readcount;
-        readcount = sf_readf_double(infile, buf, n);
-        for (int k = 0; k < readcount; k++)
-            buffer[k] = (buf[k * 2] + buf[k * 2 + 1]) / 2.;
-        return readcount == n;
-    } else
-        printf("Channel format error.\n");
-    return 0;
+    transform = real_fft_create(FRAME_SIZE, REAL_FFT_FORWARD);
+    hann = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
 }
 
 /**
- * @brief Reads HOP_SIZE samples from file into the hop buffer.
+ * @brief Windows the frame into the FFT input (kept in transform->signal) and executes the FFT.
  *
- * @param infile The file (sound) to read.
- * @param buffer The hop buffer to fill.
- * @param channels The number of channels of the sound.
- * @return True if the program read HOP_SIZE samples successfully; false otherwise.
- */
-static int
-read_samples(SNDFILE* infile, double* buffer, int channels)
-{
-    return read_n_samples(infile, buffer, channels, HOP_SIZE);
-}
-
-/**
- * @brief Converts a complex signal from the FFT into two signals of amplitude and phase.
- *
- * @param S The complex signal.
- * @param amp The amplitude signal.
- * @param phs The phase signal.
+ * @param frame The frame (original signal).
  */
 static void
-cartesian_to_polar(double complex S[FRAME_SIZE], double amp[FRAME_SIZE], double phs[FRAME_SIZE])
+fft(const double frame[FRAME_SIZE])
 {
-    for (int n = 0; n < FRAME_SIZE; n++) {
-        amp[n] = cabs(S[n]);
-        phs[n] = carg(S[n]);
-    }
-}
-
-/**
- * @brief Initializes the FFT by declaring the data in and out buffers.
- *
- * @param data_in The complex signal before FFT.
- * @param data_out The complex signal after FFT.
- */
-static void
-fft_init(fftw_complex data_in[FRAME_SIZE], fftw_complex data_out[FRAME_SIZE])
-{
-    plan = fftw_plan_dft_1d(FRAME_SIZE, data_in, data_out, FFTW_FORWARD, FFTW_ESTIMATE);
-}
-
-/**
- * @brief Executes the FFT.
- *
- * @param s The input signal (that will be stored into the pre FFT buffer).
- * @param data_in The pre FFT buffer.
- */
-static void
-fft(double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
-{
-    for (int i = 0; i < FRAME_SIZE; i++)
-        data_in[i] = s[i];
-
-    fftw_execute(plan);
+    window_apply(hann, transform->signal, frame, FRAME_SIZE, FRAME_SIZE);
+    real_fft_forward(transform);
 }
 
 /**
@@ -136,19 +60,8 @@ fft(double s[FRAME_SIZE], fftw_complex data_in[FRAME_SIZE])
 static void
 fft_exit()
 {
-    fftw_destroy_plan(plan);
-}
-
-/**
- * @brief Converts a signal value into Hann window.
- *
- * @param n The value to convert.
- * @return The converted value.
- */
-static double
-hann(double n)
-{
-    return .5 - .5 * cos(2 * M_PI * n / FRAME_SIZE);
+    real_fft_destroy(transform);
+    window_destroy(hann);
 }
 
 /**
@@ -161,7 +74,7 @@ hann(double n)
  * @return The peak frequency computed.
  */
 static double
-parabolic_interpolation(double amp[FRAME_SIZE], int sample, int SAMPLE_RATE)
+parabolic_interpolation(double amp[BINS], int sample, int SAMPLE_RATE)
 {
     double al = 20 * log(amp[sample - 1]);
     double ac = 20 * log(amp[sample]);
@@ -183,7 +96,7 @@ parabolic_interpolation(double amp[FRAME_SIZE], int sample, int SAMPLE_RATE)
  *         -1 otherwhise.
  */
 static double
-inaudible_peak(double amp[FRAME_SIZE], int SAMPLE_RATE, int* sample_index)
+inaudible_peak(double amp[BINS], int SAMPLE_RATE, int* sample_index)
 {
     double freq;
     for (int i = 0; i < FRAME_SIZE / 2; i++)
@@ -227,9 +140,89 @@ is_watermark(double freq, int sample_index, int nb_frames, int SAMPLE_RATE, char
     return false;
 }
 
+/**
+ * @brief Initializes the FFT and the plot of a segment thread.
+ *
+ * @param context Unused.
+ */
+static void
+segment_init(void* const context)
+{
+    fft_init();
+    if (PLOT) {
+        h = gnuplot_init();
+        gnuplot_setstyle(h, "lines");
+    }
+}
+
+/**
+ * @brief Finds the watermark of a frame.
+ *
+ * @param frame The frame (original signal).
+ * @param nb_frames The index of the frame in the file.
+ * @param output The stream to write the watermark to.
+ * @param context The file info.
+ */
 static void
-watermarking(char* infilename)
+watermark_frame(const double* const frame, const long nb_frames, FILE* const output, void* const context)
 {
+    const SF_INFO* const sfinfo = context;
+    const unsigned int SAMPLE_RATE = sfinfo->samplerate;
+    double amp[BINS];
+
+    // Hann window and FFT.
+    fft(frame);
+    spectrum_magnitude(amp, transform->spectrum, BINS, 1.);
+
+    // Normalize amplitude signal (values between 0 and 1).
+    // for (int i = 0; i < FRAME_SIZE; i++)
+    //     amp[i] *= 2. / FRAME_SIZE;
+
+    // Find watermark.
+    int sample_index;
+    double freq = inaudible_peak(amp, SAMPLE_RATE, &sample_index);
+    // if (freq > 0) printf("%lf\n", freq);
+
+    char event;
+    double time_code;
+    if (is_watermark(freq, sample_index, nb_frames, SAMPLE_RATE, &event, &time_code))
+        fprintf(output, "%.2f s: %c\n", time_code, event);
+
+    // Display the frame.
+    if (PLOT) {
+        gnuplot_resetplot(h);
+        // gnuplot_plot_x(h, buffer, FRAME_SIZE, "Temporal Frame");
+        gnuplot_plot_x(h, amp, FRAME_SIZE / 10, "Spectral Frame");
+        sleep(1);
+    }
+}
+
+/**
+ * @brief Shuts down the FFT and the plot of a segment thread.
+ *
+ * @param context Unused.
+ */
+static void
+segment_exit(void* const context)
+{
+    fft_exit();
+    if (PLOT)
+        gnuplot_close(h);
+}
+
+/**
+ * @brief Finds the watermarks of a sound file (a batch job).
+ *
+ * @param infilename The sound file.
+ * @param output The stream to write the watermarks to.
+ * @param context The number of segments to split the file into (int).
+ * @return 0 on success, -1 if the file could not be read.
+ */
+static int
+watermarking(const char* const infilename, FILE* const output, void* const context)
+{
+    const int segments = *(const int*)context;
+
     // Init file accessing.
     SNDFILE* infile = NULL;
     SF_INFO sfinfo;
@@ -237,28 +230,10 @@ watermarking(char* infilename)
     // Open input file.
     if ((infile = sf_open(infilename, SFM_READ, &sfinfo)) == NULL) {
         fprintf(stderr, "Not able to open input file %s.\n", infilename);
-        puts(sf_strerror(NULL));
-        exit(EXIT_FAILURE);
-    }
-
-    // Init file reading.
-    int nb_frames = 0;
-    double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
-
-    // Init ploting.
-    h = gnuplot_init();
-    gnuplot_setstyle(h, "lines");
-
-    // Check whether FRAME_SIZE & HOP_FILE are correct for file.
-    for (int i = 0; i < FRAME_SIZE / HOP_SIZE - 1; i++) {
-        if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
-        else {
-            fprintf(stderr, "Not enough samples.\n");
-            exit(EXIT_FAILURE);
-        }
+        fprintf(stderr, "%s\n", sf_strerror(NULL));
+        return -1;
     }
+    sf_close(infile);
 
     // Retrieve file info.
     const unsigned int SAMPLE_RATE = sfinfo.samplerate; // 44100 Hz.
@@ -266,87 +241,59 @@ watermarking(char* infilename)
     const unsigned int SIZE = (int)sfinfo.frames;
 
     // Display file info.
-    printf("Sample Rate: %d.\n", SAMPLE_RATE);
-    printf("Channels: %d.\n", NUM_CHANNELS);
-    printf("Size: %d.\n", SIZE);
-
-    // Initialize FFT.
-    double amp[FRAME_SIZE], phs[FRAME_SIZE];
-    fftw_complex data_in[FRAME_SIZE], data_out[FRAME_SIZE];
-    fft_init(data_in, data_out);
-
-    // bool is_prev_silence = false;
-    // char prev_key = ' ';
-
-    // Loop over each frame.
-    while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
-        // printf("\nProcessing frame %d…\n", nb_frames);
-
-        // Fill frame buffer (original signal during the frame).
-        fill_buffer(buffer, new_buffer);
-
-        // Hann window.
-        for (int i = 0; i < FRAME_SIZE; i++)
-            buffer[i] *= hann(i);
-
-        // Execute FFT.
-        fft(buffer, data_in);
-        cartesian_to_polar(data_out, amp, phs);
-
-        // Normalize amplitude signal (values between 0 and 1).
-        // for (int i = 0; i < FRAME_SIZE; i++)
-        //     amp[i] *= 2. / FRAME_SIZE;
-
-        // Retrieve maximum amplitude, and position associated.
-        double max_amp = amp[0];
-        int max_amp_i = 0;
-        for (int i = 1; i < FRAME_SIZE / 2; i++) { // No need to go further, the other half is symetrical.
-            if (max_amp < amp[i]) {
-                max_amp = amp[i];
-                max_amp_i = i;
-            }
-        }
-
-        // Find watermark.
-        int sample_index;
-        double freq = inaudible_peak(amp, SAMPLE_RATE, &sample_index);
-        // if (freq > 0) printf("%lf\n", freq);
-
-        char event;
-        double time_code;
-        if (is_watermark(freq, sample_index, nb_frames, SAMPLE_RATE, &event, &time_code))
-            printf("%.2f s: %c\n", time_code, event);
-
-        // Display the frame.
-        if (PLOT) {
-            gnuplot_resetplot(h);
-            // gnuplot_plot_x(h, buffer, FRAME_SIZE, "Temporal Frame");
-            gnuplot_plot_x(h, amp, FRAME_SIZE / 10, "Spectral Frame");
-            sleep(1);
-        }
-
-        // Increase frame id for next frame.
-        nb_frames++;
+    fprintf(output, "--- \"%s\" ---\n", infilename);
+    fprintf(output, "Sample Rate: %d.\n", SAMPLE_RATE);
+    fprintf(output, "Channels: %d.\n", NUM_CHANNELS);
+    fprintf(output, "Size: %d.\n", SIZE);
+
+    // Loop over each frame, segments of the file in parallel.
+    const segment_pipeline pipeline = { segment_init, watermark_frame, segment_exit, &sfinfo };
+    if (segment_analyze(infilename, FRAME_SIZE, HOP_SIZE, segments, &pipeline, output) < 0) {
+        fprintf(stderr, "Not able to read input file %s.\n", infilename);
+        return -1;
     }
 
-    // Shut down FFT, close file and exit program.
-    fft_exit();
-    sf_close(infile);
+    // Blank line between files.
+    fprintf(output, "\n");
+    return 0;
 }
 
-int main(int argc, char** argv)
+static void
+usage(const char* const program)
 {
-    printf("--- \"sounds/flux1.wav\" ---\n");
-    watermarking("sounds/flux1.wav");
-
-    printf("\n--- \"sounds/flux2.wav\" ---\n");
-    watermarking("sounds/flux2.wav");
-
-    printf("\n--- \"sounds/flux3.wav\" ---\n");
-    watermarking("sounds/flux3.wav");
-
-    printf("\n--- \"sounds/flux4.wav\" ---\n");
-    watermarking("sounds/flux4.wav");
+    fprintf(stderr, "Usage: %s [-j threads] [-s segments] [sound files or patterns...]\n", program);
+    exit(EXIT_FAILURE);
+}
 
-    return EXIT_SUCCESS;
+int main(int argc, char** argv)
+{
+    // Sounds of the lab by default.
+    static const char* const default_patterns[] = { "sounds/flux*.wav" };
+
+    int threads = batch_threads();
+    int segments = 0;
+    for (int option; (option = getopt(argc, argv, "j:s:")) != -1;)
+        if (option == 'j' && (threads = atoi(optarg)) > 0)
+            continue;
+        else if (option == 's' && (segments = atoi(optarg)) > 0)
+            continue;
+        else
+            usage(argv[0]);
+
+    fft_planner_init();
+
+    int count;
+    char** const paths = argc > optind
+        ? batch_expand((const char* const*)argv + optind, argc - optind, &count)
+        : batch_expand(default_patterns, 1, &count);
+    if (paths == NULL)
+        return EXIT_FAILURE;
+
+    // Several files are analyzed in parallel, a single one in parallel segments.
+    if (segments == 0)
+        segments = count == 1 ? threads : 1;
+
+    const int failures = batch_run((const char* const*)paths, count, threads, watermarking, &segments, stdout);
+    batch_free_paths(paths, count);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
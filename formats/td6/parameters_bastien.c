@@ -5,22 +5,32 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "fft.h"
+#include "frame.h"
 #include "gnuplot_i.h"
+#include "pitch.h"
+#include "window.h"
 
 #define PLOT true
 
 #define FRAME_SIZE 1024
 #define HOP_SIZE 1024
+#define FFT_SIZE (2 * FRAME_SIZE)
 #define ENERGY_THRESHOLD .015
 
+#define MIN_FREQUENCY 50.
+#define MAX_FREQUENCY 4000.
+#define YIN_THRESHOLD .15
+
 // static fftw_plan fft_plan;
 static gnuplot_ctrl* plot;
 
 static void
 usage(const char* const progname)
 {
-    fprintf(stderr, "Usage: %s <file>.\n", progname);
+    fprintf(stderr, "Usage: %s <file> [--yin].\n", progname);
     exit(EXIT_FAILURE);
 }
 
@@ -44,21 +54,6 @@ read_samples(double* const hop_buffer, SNDFILE* const input_file, const int hop_
     return false;
 }
 
-static void
-fill_frame_buffer(double* const frame_buffer, const double* const hop_buffer, const int frame_size, const int hop_size)
-{
-    double tmp[frame_size - hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        tmp[sample] = frame_buffer[sample + hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        frame_buffer[sample] = tmp[sample];
-
-    for (int sample = 0; sample < hop_size; sample++)
-        frame_buffer[frame_size - hop_size + sample] = hop_buffer[sample];
-}
-
 static double
 get_energy(const double* const frame_buffer, const int frame_size)
 {
@@ -74,13 +69,6 @@ frame_is_useful(const double frame_energy)
     return frame_energy > ENERGY_THRESHOLD;
 }
 
-static void
-hann(double* const frame_buffer, const int frame_size)
-{
-    for (int sample = 0; sample < frame_size; sample++)
-        frame_buffer[sample] *= .5 - .5 * cos(2. * M_PI * sample / frame_size);
-}
-
 // static void
 // fft_init(fftw_complex* const fft_in, fftw_complex* const fft_out, const int fft_size)
 // {
@@ -135,34 +123,11 @@ hann(double* const frame_buffer, const int frame_size)
 //     return (sample + delta) * sample_rate / fft_size;
 // }
 
-static double
-autocorrelation(const double* const frame_buffer, const int frame_size, const int sample_rate)
-{
-    double rt[frame_size];
-    for (int r = 10; r < frame_size; r++) {
-        rt[r] = 0.;
-        for (int i = 0; i < frame_size - r; i++)
-            rt[r] += frame_buffer[i] * frame_buffer[i + r] / frame_size;
-    }
-
-    int r_max = 0;
-    for (int i = 0; i < FRAME_SIZE; i++)
-        if (rt[r_max] < rt[i])
-            r_max = i;
-    return sample_rate / r_max;
-}
-
-static int
-get_pitch(const double frequency)
-{
-    const double H0 = 57., F0 = 440.;
-    return ((int)round(H0 + 12 * log2(frequency / F0))) % 12;
-}
-
 int main(const int argc, const char* const* const argv)
 {
-    if (argc != 2)
+    if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "--yin") != 0))
         usage(argv[0]);
+    const bool yin = argc == 3;
 
     SNDFILE* input_file = NULL;
     SF_INFO input_info;
@@ -177,11 +142,11 @@ int main(const int argc, const char* const* const argv)
     const int size = input_info.frames;
 
     double hop_buffer[HOP_SIZE];
-    double frame_buffer[FRAME_SIZE];
+    frame_assembler* const frames = frame_assembler_create(FRAME_SIZE);
 
     for (int sample = 0; sample < FRAME_SIZE / HOP_SIZE - 1; sample++) {
         if (read_samples(hop_buffer, input_file, HOP_SIZE, channels))
-            fill_frame_buffer(frame_buffer, hop_buffer, FRAME_SIZE, HOP_SIZE);
+            frame_assembler_push(frames, hop_buffer, HOP_SIZE);
         else {
             fprintf(stderr, "Not enough samples.\n");
             exit(EXIT_FAILURE);
@@ -193,14 +158,16 @@ int main(const int argc, const char* const* const argv)
 
     double energies[size / FRAME_SIZE];
 
-    // int fft_size = FRAME_SIZE;
-    // fftw_complex fft_in[fft_size], fft_out[fft_size];
-    // double amplitudes[fft_size], phases[fft_size];
-    // fft_init(fft_in, fft_out, fft_size);
+    // The autocorrelation is computed from the spectrum of the zero-padded frame.
+    fft_planner_init();
+    window* const hann_window = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
+    real_fft* const fft_transform = real_fft_create(FFT_SIZE, REAL_FFT_FORWARD);
+    pitch_tracker* const tracker = pitch_tracker_create(FRAME_SIZE, FFT_SIZE, hann_window);
 
     int frame_id = 0;
     while (read_samples(hop_buffer, input_file, HOP_SIZE, channels)) {
-        fill_frame_buffer(frame_buffer, hop_buffer, FRAME_SIZE, HOP_SIZE);
+        frame_assembler_push(frames, hop_buffer, HOP_SIZE);
+        const double* const frame_buffer = frame_assembler_get_frame(frames);
 
         energies[frame_id] = get_energy(frame_buffer, FRAME_SIZE);
         if (!frame_is_useful(energies[frame_id])) {
@@ -208,14 +175,20 @@ int main(const int argc, const char* const* const argv)
             continue;
         }
 
-        hann(frame_buffer, FRAME_SIZE);
-
-        // fft(fft_in, frame_buffer, fft_size, FRAME_SIZE);
-        // cartesian_to_polar(amplitudes, phases, fft_out, fft_size);
+        double frequency;
+        if (yin)
+            frequency = pitch_yin(tracker, frame_buffer, sample_rate, MIN_FREQUENCY, MAX_FREQUENCY, YIN_THRESHOLD);
+        else {
+            window_apply(hann_window, fft_transform->signal, frame_buffer, FRAME_SIZE, FFT_SIZE);
+            real_fft_forward(fft_transform);
+            frequency = pitch_autocorrelation_estimate(tracker, fft_transform->spectrum, sample_rate, MIN_FREQUENCY, MAX_FREQUENCY);
+        }
 
-        const double frequency = autocorrelation(frame_buffer, FRAME_SIZE, sample_rate);
-        const int pitch = get_pitch(frequency);
-        printf("Pitch: %d.\n", pitch);
+        const int pitch = pitch_class(frequency);
+        if (pitch >= 0)
+            printf("Frame %d: %.2lf Hz, pitch %d.\n", frame_id, frequency, pitch);
+        else
+            printf("Frame %d: no pitch.\n", frame_id);
 
         if (PLOT) {
             gnuplot_resetplot(plot);
@@ -232,7 +205,10 @@ int main(const int argc, const char* const* const argv)
     //     sleep(10);
     // }
 
-    // fft_exit();
+    pitch_tracker_destroy(tracker);
+    real_fft_destroy(fft_transform);
+    window_destroy(hann_window);
+    frame_assembler_destroy(frames);
     sf_close(input_file);
     return EXIT_SUCCESS;
 }
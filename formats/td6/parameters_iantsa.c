@@ -9,101 +9,80 @@
 
 #include <math.h>
 
+#include "fft.h"
 #include "gnuplot_i.h"
+#include "pitch.h"
+#include "spectrum.h"
+#include "stft.h"
+#include "window.h"
 
 #define FRAME_SIZE 1024
 #define HOP_SIZE 1024
-#define H0 57
-#define F0 440.
+#define FFT_SIZE (2 * FRAME_SIZE) // Zero-padded, for a linear autocorrelation.
+#define BINS (FFT_SIZE / 2 + 1)
+#define BATCH 32
+
+#define F_MIN 50. // Clamped to the lags of half a frame (~86 Hz).
+#define F_MAX 4000.
+#define YIN_THRESHOLD .15
 
 static gnuplot_ctrl* h;
-static fftw_plan plan;
+static pitch_tracker* tracker;
+static int yin; // 1 for YIN, 0 for the autocorrelation.
 
 static void
 print_usage(char* progname)
 {
-    printf("\nUsage : %s <input file> \n", progname);
+    printf("\nUsage : %s <input file> [--yin]\n", progname);
     puts("\n");
 }
-static void
-fill_buffer(double* buffer, double* new_buffer)
+
+void process_frame(const int nb_frames, const double* const buffer, const complex* const spectrum, void* const context)
 {
+    const int samplerate = *(const int*)context;
+    double amplitude[BINS];
     int i;
-    double tmp[FRAME_SIZE - HOP_SIZE];
 
-    /* save */
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
+    /* Process Samples */
+    printf("Processing frame %d\n", nb_frames);
 
-    /* save offset */
-    for (i = 0; i < (FRAME_SIZE - HOP_SIZE); i++) {
-        buffer[i] = tmp[i];
-    }
-
-    for (i = 0; i < HOP_SIZE; i++) {
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-    }
-}
+    // spectrum contient les BINS complexes résultats de la fft
+    spectrum_magnitude(amplitude, spectrum, BINS, 1.);
 
-static int
-read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
-{
+    int imax = 0;
+    double max = 0.0;
 
-    if (channels == 1) {
-        /* MONO */
-        int readcount;
-
-        readcount = sf_readf_double(infile, buffer, n);
-
-        return readcount == n;
-    } else if (channels == 2) {
-        /* STEREO */
-        double buf[2 * n];
-        int readcount, k;
-        readcount = sf_readf_double(infile, buf, n);
-        for (k = 0; k < readcount; k++)
-            buffer[k] = (buf[k * 2] + buf[k * 2 + 1]) / 2.0;
-
-        return readcount == n;
-    } else {
-        /* FORMAT ERROR */
-        printf("Channel format error.\n");
+    for (i = 0; i < FFT_SIZE / 2; i++) {
+        if (amplitude[i] > max) {
+            max = amplitude[i];
+            imax = i;
+        }
     }
+    printf("max %d %f\n", imax, (double)imax * samplerate / FFT_SIZE);
+
+    // Fréquence fondamentale: YIN sur la trame, ou autocorrélation à partir du spectre (Wiener-Khinchin)
+    double F = yin
+        ? pitch_yin(tracker, buffer, samplerate, F_MIN, F_MAX, YIN_THRESHOLD)
+        : pitch_autocorrelation_estimate(tracker, spectrum, samplerate, F_MIN, F_MAX);
+    printf("F: %lf\n", F);
+
+    int pitch = pitch_class(F);
+    if (pitch < 0)
+        printf("pitch - \n");
+    else
+        printf("pitch %d \n", pitch);
 
-    return 0;
-}
-
-static int
-read_samples(SNDFILE* infile, double* buffer, int channels)
-{
-    return read_n_samples(infile, buffer, channels, HOP_SIZE);
-}
-
-void fft_init(complex in[FRAME_SIZE], complex spec[FRAME_SIZE])
-{
-    plan = fftw_plan_dft_1d(FRAME_SIZE, in, spec, FFTW_FORWARD, FFTW_ESTIMATE);
-}
-
-void fft_exit(void)
-{
-    fftw_destroy_plan(plan);
-}
-
-void fft_process(void)
-{
-    fftw_execute(plan);
-}
-
-double autocorrelation(double buffer[FRAME_SIZE], int tau)
-{
-    double res = 0;
-    for (int n = 0; n < FRAME_SIZE - tau; n++)
-        res += buffer[n] * buffer[n+tau];
+    /* plot amplitude */
+    // gnuplot_resetplot(h);
+    // gnuplot_plot_x(h, amplitude, FRAME_SIZE / 2, "amplitude");
+    // sleep(1);
 
-    return res / FRAME_SIZE;
+    /* PLOT */
+    // gnuplot_resetplot(h);
+    // gnuplot_plot_x(h,buffer,FRAME_SIZE,"temporal frame");
+    // sleep(1);
 }
 
-
 int main(int argc, char* argv[])
 {
     char *progname, *infilename;
@@ -113,10 +92,11 @@ int main(int argc, char* argv[])
     progname = strrchr(argv[0], '/');
     progname = progname ? progname + 1 : argv[0];
 
-    if (argc != 2) {
+    if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "--yin") != 0)) {
         print_usage(progname);
         return 1;
     };
+    yin = argc == 3;
 
     infilename = argv[1];
 
@@ -126,116 +106,25 @@ int main(int argc, char* argv[])
         return 1;
     };
 
-    /* Read WAV */
-    int nb_frames = 0;
-    double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
-
     /* Plot Init */
     h = gnuplot_init();
     gnuplot_setstyle(h, "lines");
 
-    int i;
-    for (i = 0; i < (FRAME_SIZE / HOP_SIZE - 1); i++) {
-        if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
-        else {
-            printf("not enough samples !!\n");
-            return 1;
-        }
-    }
-
-    complex samples[FRAME_SIZE];
-    double amplitude[FRAME_SIZE];
-    complex spectrum[FRAME_SIZE];
-
-    /* FFT init */
-    fft_init(samples, spectrum);
+    /* Fenetre Hann (table) */
+    window* hann = window_create(WINDOW_HANN, FRAME_SIZE, 0.);
 
-    while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
-        /* Process Samples */
-        printf("Processing frame %d\n", nb_frames);
-
-        /* hop size */
-        fill_buffer(buffer, new_buffer);
-
-        // fft process
-        for (i = 0; i < FRAME_SIZE; i++) {
-            // Fenetre Hann
-            samples[i] = buffer[i]*(0.5-0.5*cos(2.0*M_PI*(double)i/FRAME_SIZE));
-            // Fenetre rect
-            // samples[i] = buffer[i];
-        }
-        for (i = FRAME_SIZE; i < FRAME_SIZE; i++) {
-            samples[i] = 0.0;
-        }
-
-        fft_process();
-
-        // spectrum contient les complexes résultats de la fft
-        for (i = 0; i < FRAME_SIZE; i++) {
-            amplitude[i] = cabs(spectrum[i]);
-        }
+    /* FFT init: BATCH trames par fft, complétées par des zéros jusqu'à FFT_SIZE */
+    fft_planner_init();
+    stft* frames = stft_create(FRAME_SIZE, HOP_SIZE, FFT_SIZE, BATCH, hann, process_frame, &sfinfo.samplerate);
+    tracker = pitch_tracker_create(FRAME_SIZE, FFT_SIZE, hann);
 
-        int imax = 0;
-        double max = 0.0;
-
-        for (i = 0; i < FRAME_SIZE / 2; i++) {
-            if (amplitude[i] > max) {
-                max = amplitude[i];
-                imax = i;
-            }
-        }
-        printf("max %d %f\n", imax, (double)imax * sfinfo.samplerate / FRAME_SIZE);
-
-        /* TODO */
-        // double F = imax * sfinfo.samplerate / FRAME_SIZE;
-
-        double r[FRAME_SIZE];
-        int tau_min = 10;
-
-        for (int tau = tau_min; tau < FRAME_SIZE; tau++)
-            r[tau] = autocorrelation(buffer, tau);
-
-        double max_amp = 0;
-        int max_amp_tau = 0;
-        for (int i = 0; i < FRAME_SIZE; i++)
-        {
-            if (r[i] > r[max_amp_tau])
-            {
-                max_amp = r[i];
-                max_amp_tau = i;
-            }
-        }
-        
-        printf("tau: %d\n", max_amp_tau);
-
-        double F = (double) sfinfo.samplerate / max_amp_tau;
-        printf("F: %lf\n", F);
-
-        int H = round(H0 + 12 * log2(F/F0));
-            
-        int pitch = H % 12;
-
-        printf("pitch %d \n", pitch);
-
-        /* plot amplitude */
-        // gnuplot_resetplot(h);
-        // gnuplot_plot_x(h, amplitude, FRAME_SIZE / 2, "amplitude");
-        // sleep(1);
-
-        /* PLOT */
-        // gnuplot_resetplot(h);
-        // gnuplot_plot_x(h,buffer,FRAME_SIZE,"temporal frame");
-        // sleep(1);
-
-        nb_frames++;
-    }
+    /* Read WAV */
+    stft_read(frames, infile, sfinfo.channels);
 
     sf_close(infile);
-
-    /* FFT exit */
-    fft_exit();
+    stft_destroy(frames);
+    pitch_tracker_destroy(tracker);
+    window_destroy(hann);
 
     return 0;
 } /* main */
@@ -6,17 +6,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "energy_index.h"
+#include "fft.h"
 #include "gnuplot_i.h"
+#include "psychoacoustic.h"
+#include "stft.h"
 
 #define PLOT true
 
 #define FRAME_SIZE 1024
 #define HOP_SIZE 1024
 #define ENERGY_THRESHOLD .002
+#define BASE_AMPLITUDE 1e-6
+#define STFT_BATCH 32
+#define INDEX_BLOCK_SIZE 256 // Divides FRAME_SIZE and HOP_SIZE, so silent frames are skipped exactly.
 
-static fftw_plan fft_plan;
 static gnuplot_ctrl* plot;
 
+typedef struct analysis {
+    psychoacoustic_model* model;
+    double* energies;
+} analysis;
+
 static void
 usage(const char* const progname)
 {
@@ -24,41 +35,6 @@ usage(const char* const progname)
     exit(EXIT_FAILURE);
 }
 
-static bool
-read_samples(double* const hop_buffer, SNDFILE* const input_file, const int hop_size, const char channels)
-{
-    if (channels == 2) {
-        double tmp[2 * hop_size];
-        const int read_count = sf_readf_double(input_file, tmp, hop_size);
-        for (int sample = 0; sample < read_count; sample++)
-            hop_buffer[sample] = (tmp[sample * 2] + tmp[sample * 2 + 1]) / 2.;
-        return read_count == hop_size;
-    }
-
-    if (channels == 1) {
-        const int read_count = sf_readf_double(input_file, hop_buffer, hop_size);
-        return read_count == hop_size;
-    }
-
-    fprintf(stderr, "Channel format error.\n");
-    return false;
-}
-
-static void
-fill_frame_buffer(double* const frame_buffer, const double* const hop_buffer, const int frame_size, const int hop_size)
-{
-    double tmp[frame_size - hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        tmp[sample] = frame_buffer[sample + hop_size];
-
-    for (int sample = 0; sample < frame_size - hop_size; sample++)
-        frame_buffer[sample] = tmp[sample];
-
-    for (int sample = 0; sample < hop_size; sample++)
-        frame_buffer[frame_size - hop_size + sample] = hop_buffer[sample];
-}
-
 static double
 get_energy(const double* const frame_buffer, const int frame_size)
 {
@@ -81,36 +57,6 @@ frame_is_useful(const double frame_energy)
 //         frame_buffer[sample] *= .5 - .5 * cos(2. * M_PI * sample / frame_size);
 // }
 
-static void
-fft_init(fftw_complex* const fft_in, fftw_complex* const fft_out, const int fft_size)
-{
-    fft_plan = fftw_plan_dft_1d(fft_size, fft_in, fft_out, FFTW_FORWARD, FFTW_ESTIMATE);
-}
-
-static void
-fft(fftw_complex* const fft_in, const double* const signal, const int fft_size, const int frame_size)
-{
-    for (int sample = 0; sample < fft_size; sample++)
-        fft_in[sample] = sample < frame_size ? signal[sample] : 0.;
-
-    fftw_execute(fft_plan);
-}
-
-static void
-fft_exit()
-{
-    fftw_destroy_plan(fft_plan);
-}
-
-static void
-cartesian_to_polar(double* const amplitudes, double* const phases, const double complex* const fft_out, const int fft_size)
-{
-    for (int sample = 0; sample < fft_size; sample++) {
-        amplitudes[sample] = cabs(fft_out[sample]);
-        phases[sample] = carg(fft_out[sample]);
-    }
-}
-
 // static int
 // get_max_amplitude_sample(const double* const amplitudes, const int fft_size)
 // {
@@ -121,27 +67,6 @@ cartesian_to_polar(double* const amplitudes, double* const phases, const double
 //     return max_amplitude_sample;
 // }
 
-static int
-get_frequency(const double* const amplitudes, const int sample, const double sample_rate, const int fft_size, const bool interpolate)
-{
-    if (!interpolate)
-        return sample * sample_rate / fft_size;
-
-    double left, current, right, delta;
-    left = 20 * log(amplitudes[sample - 1]);
-    current = 20 * log(amplitudes[sample]);
-    right = 20 * log(amplitudes[sample + 1]);
-    delta = .5 * (left - right) / (left - 2 * current + right);
-    return (sample + delta) * sample_rate / fft_size;
-}
-
-static double
-amplitude_to_loudness(const double amplitude)
-{
-    // Convert amplitude to loudness: V(A).
-    return 20 * log10(amplitude / 1e-6);
-}
-
 // static double
 // loudness_to_amplitude(const double loudness)
 // {
@@ -149,15 +74,6 @@ amplitude_to_loudness(const double amplitude)
 //     return 10e-6 * pow(10, loudness / 20);
 // }
 
-static double
-frequency_to_bark(const double frequency)
-{
-    // Convert frequency to Bark: B(F).
-    if (frequency <= 500)
-        return frequency / 100;
-    return 9 + 4*log2(frequency / 1000);
-}
-
 // static double
 // bark_to_frequency(const double bark)
 // {
@@ -167,11 +83,27 @@ frequency_to_bark(const double frequency)
 //     return 1000 * pow(2, (bark-9) / 4);
 // }
 
-static double
-get_hearing_threshold(const double frequency)
+static void
+process_frame(const int frame_id, const double* const frame_buffer, const fftw_complex* const spectrum, void* const context)
 {
-    // Get frequency hearing threshold value: A(F).
-    return 3.64 * pow((frequency/1000), -0.8) -  6.5 * pow(10, -0.6*pow((frequency / 1000-3.3), 2)) + 1e-3 * pow(frequency / 1000, 4);
+    analysis* const parameters = context;
+    psychoacoustic_model* const model = parameters->model;
+
+    parameters->energies[frame_id] = get_energy(frame_buffer, FRAME_SIZE);
+    if (!frame_is_useful(parameters->energies[frame_id]))
+        return;
+
+    // Loudness V(A) and masking threshold, the Bark and hearing threshold tables being computed once.
+    psychoacoustic_model_analyze(model, spectrum, 1. / BASE_AMPLITUDE);
+
+    if (PLOT) {
+        gnuplot_resetplot(plot);
+        // gnuplot_plot_xy(plot, frequencies, amplitudes, FRAME_SIZE / 2, "Amplitude according to frequency");
+        gnuplot_plot_xy(plot, model->barks, model->hearing_threshold, FRAME_SIZE / 2, "Hearing threshold according to Bark");
+        gnuplot_plot_xy(plot, model->barks, model->loudness, FRAME_SIZE / 2, "Loudness according to Bark");
+        gnuplot_plot_xy(plot, model->barks, model->masking_threshold, FRAME_SIZE / 2, "Masking threshold according to Bark");
+        sleep(1);
+    }
 }
 
 int main(const int argc, const char* const* const argv)
@@ -191,72 +123,24 @@ int main(const int argc, const char* const* const argv)
     const int channels = input_info.channels;
     const int size = input_info.frames;
 
-    double hop_buffer[HOP_SIZE];
-    double frame_buffer[FRAME_SIZE];
-
-    for (int sample = 0; sample < FRAME_SIZE / HOP_SIZE - 1; sample++) {
-        if (read_samples(hop_buffer, input_file, HOP_SIZE, channels))
-            fill_frame_buffer(frame_buffer, hop_buffer, FRAME_SIZE, HOP_SIZE);
-        else {
-            fprintf(stderr, "Not enough samples.\n");
-            exit(EXIT_FAILURE);
-        }
-    }
-
     plot = gnuplot_init();
     gnuplot_setstyle(plot, "lines");
 
-    double energies[size / FRAME_SIZE];
-
-    int fft_size = FRAME_SIZE;
-    fftw_complex fft_in[fft_size], fft_out[fft_size];
-    double amplitudes[fft_size], phases[fft_size];
-    fft_init(fft_in, fft_out, fft_size);
-
-    int frame_id = 0;
-    while (read_samples(hop_buffer, input_file, HOP_SIZE, channels)) {
-        fill_frame_buffer(frame_buffer, hop_buffer, FRAME_SIZE, HOP_SIZE);
-
-        energies[frame_id] = get_energy(frame_buffer, FRAME_SIZE);
-        if (!frame_is_useful(energies[frame_id])) {
-            frame_id++;
-            continue;
-        }
-
-        // hann(frame_buffer, FRAME_SIZE);
-
-        fft(fft_in, frame_buffer, fft_size, FRAME_SIZE);
-        cartesian_to_polar(amplitudes, phases, fft_out, fft_size);
-
-        double loudness[fft_size];
-        // Implement amplitude_to_loudness() and use it to fill loudness array.
-        for (int i = 0; i < fft_size; i++)
-            loudness[i] = amplitude_to_loudness(amplitudes[i]);
-            
-        double frequencies[fft_size];
-        for (int sample = 0; sample < fft_size; sample++)
-            frequencies[sample] = get_frequency(amplitudes, sample, sample_rate, fft_size, false);
-
-        double barks[fft_size];
-        // Implement frequency_to_bark() and use it to fill barks array.
-        for (int i = 0; i < fft_size; i++)
-            barks[i] = frequency_to_bark(frequencies[i]);
-
-        double hearing_threshold[fft_size];
-        // Implement get_hearing_threshold() and use it to fill hearing threshold array.
-        for (int i = 0; i < fft_size; i++)
-            hearing_threshold[i] = get_hearing_threshold(frequencies[i]);
-
-        if (PLOT) {
-            gnuplot_resetplot(plot);
-            // gnuplot_plot_xy(plot, frequencies, amplitudes, FRAME_SIZE / 2, "Amplitude according to frequency");
-            gnuplot_plot_xy(plot, barks, hearing_threshold, FRAME_SIZE / 2, "Hearing threshold according to Bark");
-            gnuplot_plot_xy(plot, barks, loudness, FRAME_SIZE / 2, "Loudness according to Bark");
-            sleep(1);
-        }
-
-        frame_id++;
-    }
+    // Silent frames are not read at all, their energy is left to 0.
+    const int frame_count = size < FRAME_SIZE ? 0 : (size - FRAME_SIZE) / HOP_SIZE + 1;
+    double* const energies = calloc(frame_count > 0 ? frame_count : 1, sizeof(double));
+    psychoacoustic_model* const model = psychoacoustic_model_create(FRAME_SIZE, sample_rate);
+    analysis parameters = { model, energies };
+
+    // Rectangular window (no hann), frames are transformed STFT_BATCH at a time.
+    fft_planner_init();
+    stft* const transform = stft_create(FRAME_SIZE, HOP_SIZE, FRAME_SIZE, STFT_BATCH, NULL, process_frame, &parameters);
+    energy_index* const index = energy_index_load(argv[1], INDEX_BLOCK_SIZE, ENERGY_THRESHOLD);
+    if (index == NULL)
+        stft_read(transform, input_file, channels);
+    else
+        for (long first, end = 0; energy_index_sound_frames(index, FRAME_SIZE, HOP_SIZE, end, &first, &end);)
+            stft_read_frames(transform, input_file, channels, first, end - first);
 
     // if (PLOT) {
     //     gnuplot_resetplot(plot);
@@ -264,7 +148,10 @@ int main(const int argc, const char* const* const argv)
     //     sleep(10);
     // }
 
-    fft_exit();
+    stft_destroy(transform);
+    energy_index_destroy(index);
+    psychoacoustic_model_destroy(model);
+    free(energies);
     sf_close(input_file);
     return EXIT_SUCCESS;
 }
@@ -9,114 +9,46 @@
 
 #include <math.h>
 
+#include "cepstrum.h"
+#include "fft.h"
 #include "gnuplot_i.h"
+#include "stft.h"
 
 #define FRAME_SIZE 2048
 #define HOP_SIZE 2048
-#define O 50
+#define O 50 // Ordre du liftre
+#define BATCH 32
 
 static gnuplot_ctrl* h;
-static fftw_plan plan;
-static fftw_plan iplan;
+static cepstrum* analysis;
+static FILE* envelopes; // Fichier binaire des enveloppes (NULL pour les tracer).
 
 static void
 print_usage(char* progname)
 {
-    printf("\nUsage : %s <input file> \n", progname);
+    printf("\nUsage : %s <input file> [<envelope file>]\n", progname);
     puts("\n");
 }
 
-static void
-fill_buffer(double* buffer, double* new_buffer)
+void process_frame(const int nb_frames, const double* const buffer, const complex* const frame_spectrum, void* const context)
 {
-    int i;
-    double tmp[FRAME_SIZE - HOP_SIZE];
-
-    /* save */
-    for (i = 0; i < FRAME_SIZE - HOP_SIZE; i++)
-        tmp[i] = buffer[i + HOP_SIZE];
-
-    /* save offset */
-    for (i = 0; i < (FRAME_SIZE - HOP_SIZE); i++) {
-        buffer[i] = tmp[i];
-    }
-
-    for (i = 0; i < HOP_SIZE; i++) {
-        buffer[FRAME_SIZE - HOP_SIZE + i] = new_buffer[i];
-    }
-}
+    // Cepstre réel et enveloppe spectrale (liftrage d'ordre O)
+    cepstrum_envelope(analysis, frame_spectrum);
 
-static int
-read_n_samples(SNDFILE* infile, double* buffer, int channels, int n)
-{
-
-    if (channels == 1) {
-        /* MONO */
-        int readcount;
-
-        readcount = sf_readf_double(infile, buffer, n);
-
-        return readcount == n;
-    } else if (channels == 2) {
-        /* STEREO */
-        double buf[2 * n];
-        int readcount, k;
-        readcount = sf_readf_double(infile, buf, n);
-        for (k = 0; k < readcount; k++)
-            buffer[k] = (buf[k * 2] + buf[k * 2 + 1]) / 2.0;
-
-        return readcount == n;
-    } else {
-        /* FORMAT ERROR */
-        printf("Channel format error.\n");
+    if (envelopes != NULL) {
+        if (!cepstrum_write_envelope(analysis, envelopes))
+            fprintf(stderr, "Not able to write the envelope of frame %d.\n", nb_frames);
+        return;
     }
 
-    return 0;
-}
-
-static int
-read_samples(SNDFILE* infile, double* buffer, int channels)
-{
-    return read_n_samples(infile, buffer, channels, HOP_SIZE);
-}
-
-void fft_init(complex in[FRAME_SIZE], complex spec[FRAME_SIZE])
-{
-    plan = fftw_plan_dft_1d(FRAME_SIZE, in, spec, FFTW_FORWARD, FFTW_ESTIMATE);
-}
-
-void fft_exit(void)
-{
-    fftw_destroy_plan(plan);
-}
-
-void fft_process(void)
-{
-    fftw_execute(plan);
-}
-
-void ifft_init(complex in[FRAME_SIZE], complex spec[FRAME_SIZE])
-{
-    iplan = fftw_plan_dft_1d(FRAME_SIZE, in, spec, FFTW_BACKWARD, FFTW_ESTIMATE);
-}
+    /* Process Samples */
+    printf("Processing frame %d\n", nb_frames);
 
-void ifft_exit(void)
-{
-    fftw_destroy_plan(iplan);
-}
-
-void ifft_process(void)
-{
-    fftw_execute(iplan);
-}
-
-double hpb(double n)
-{
-    if (n == 0. || n == O/2)
-        return 1.;
-    if (1. <= n && n < O/2)
-        return 2.;
-    return 0.;
+    /* plot amplitude */
+    gnuplot_resetplot(h);
+    gnuplot_plot_x(h, analysis->log_magnitudes, FRAME_SIZE/2, "amplitude spectrum (dB)");
+    gnuplot_plot_x(h, analysis->envelope, FRAME_SIZE/2, "spectral envelope");
+    sleep(1);
 }
 
 int main(int argc, char* argv[])
@@ -128,7 +60,7 @@ int main(int argc, char* argv[])
     progname = strrchr(argv[0], '/');
     progname = progname ? progname + 1 : argv[0];
 
-    if (argc != 2) {
+    if (argc != 2 && argc != 3) {
         print_usage(progname);
         return 1;
     };
@@ -141,83 +73,35 @@ int main(int argc, char* argv[])
         return 1;
     };
 
-    /* Read WAV */
-    int nb_frames = 0;
-    double new_buffer[HOP_SIZE];
-    double buffer[FRAME_SIZE];
-
-    /* Plot Init */
-    h = gnuplot_init();
-    gnuplot_setstyle(h, "lines");
-
-    int i;
-    for (i = 0; i < (FRAME_SIZE / HOP_SIZE - 1); i++) {
-        if (read_samples(infile, new_buffer, sfinfo.channels) == 1)
-            fill_buffer(buffer, new_buffer);
-        else {
-            printf("not enough samples !!\n");
+    if (argc == 3) {
+        /* Enveloppes dans un fichier binaire */
+        if ((envelopes = fopen(argv[2], "wb")) == NULL) {
+            printf("Not able to open output file %s.\n", argv[2]);
             return 1;
         }
+    } else {
+        /* Plot Init */
+        h = gnuplot_init();
+        gnuplot_setstyle(h, "lines");
     }
 
-    complex samples[FRAME_SIZE];
-    double amplitude[FRAME_SIZE];
-    complex spectrum[FRAME_SIZE];
-
-    /* FFT init */
-    double complex ifft_out[FRAME_SIZE];
-    double spec_env[FRAME_SIZE];
-    fft_init(samples, spectrum);
-    ifft_init(spectrum, ifft_out);    
+    /* Cepstre init */
+    fft_planner_init();
+    analysis = cepstrum_create(FRAME_SIZE, O);
+    if (envelopes != NULL)
+        cepstrum_write_header(analysis, envelopes, sfinfo.samplerate);
 
-    while (read_samples(infile, new_buffer, sfinfo.channels) == 1) {
-        /* Process Samples */
-        printf("Processing frame %d\n", nb_frames);
-
-        /* hop size */
-        fill_buffer(buffer, new_buffer);
-
-        // fft process
-        for (i = 0; i < FRAME_SIZE; i++) {
-            // Fenetre rect
-            samples[i] = buffer[i];
-        }
-
-        /* TODO */
-        fft_process();
-
-        // dB conversion
-        for (int i = 0; i < FRAME_SIZE; i++)
-        {
-            amplitude[i] = log(cabs(spectrum[i]));
-            spectrum[i] = amplitude[i];
-        }
-
-        ifft_process();
-
-        // Filter
-        for (int i = 0; i < FRAME_SIZE; i++)
-            samples[i] = hpb(i) * ifft_out[i];
-
-        fft_process();
-
-        for (int i = 0; i < FRAME_SIZE; i++)
-            spec_env[i] = creal(spectrum[i]) / FRAME_SIZE;
-
-        /* plot amplitude */
-        gnuplot_resetplot(h);
-        gnuplot_plot_x(h, amplitude, FRAME_SIZE/2, "amplitude spectrum (dB)");
-        gnuplot_plot_x(h, spec_env, FRAME_SIZE/2, "spectral envelope");
-        sleep(1);
-
-        nb_frames++;
-    }
+    /* Read WAV: fenetre rect, BATCH trames par fft */
+    stft* frames = stft_create(FRAME_SIZE, HOP_SIZE, FRAME_SIZE, BATCH, NULL, process_frame, NULL);
+    stft_read(frames, infile, sfinfo.channels);
 
     sf_close(infile);
+    stft_destroy(frames);
 
-    /* FFT exit */
-    fft_exit();
-    ifft_exit();
+    /* Cepstre exit */
+    cepstrum_destroy(analysis);
+    if (envelopes != NULL)
+        fclose(envelopes);
 
     return 0;
-} /* main */
\ No newline at end of file
+} /* main */
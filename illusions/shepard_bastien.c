@@ -1,20 +1,30 @@
 #include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
-#include "sinusoid.h"
+#include "batch.h"
+#include "oscillator.h"
+#include "shepard.h"
 #include "sound_file.h"
 
 #define DURATION .5
 #define SAMPLE_RATE 44100
 #define FRAME_SIZE (int)(DURATION * SAMPLE_RATE)
 
-static const char* const RAW_FILENAME = "outputs/raw_bastien.raw";
+#define GLISSANDO_LOWEST 20. // Hz.
+#define GLISSANDO_OCTAVES 10
+#define GLISSANDO_WIDTH 1.5 // Octaves.
+#define CHUNK_SIZE (1 << 18) // Samples rendered in parallel at once.
+
 static const char* const OUT_FILENAME = "outputs/out_bastien.wav";
 
+static oscillator_bank* bank;
+
 static void
-silence(FILE* const output, double* const s)
+silence(sound_writer* const output, double* const s)
 {
     for (int i = 0; i < FRAME_SIZE; i++)
         s[i] = 0;
@@ -23,22 +33,19 @@ silence(FILE* const output, double* const s)
 }
 
 static void
-note_shepard(FILE* const output, double* const s, const double f)
+note_shepard(sound_writer* const output, double* const s, const double f)
 {
     double a = f / 261.626 - 1;
-    sinusoid x = create_sinusoid(1 - a, f);
-    sinusoid y = create_sinusoid(a, f / 2);
-
-    for (int i = 0; i < FRAME_SIZE; i++) {
-        s[i] = get_sinusoid_value(x, 0, FRAME_SIZE, i, SAMPLE_RATE);
-        s[i] += get_sinusoid_value(y, 0, FRAME_SIZE, i, SAMPLE_RATE);
-    }
+    oscillator_bank_clear(bank);
+    oscillator_bank_add(bank, 1 - a, f, 0);
+    oscillator_bank_add(bank, a, f / 2, 0);
+    oscillator_bank_render(bank, s, FRAME_SIZE);
 
     sound_file_write(output, s, FRAME_SIZE);
 }
 
 static void
-gamme_shepard_12_up(FILE* const fo, double* const s)
+gamme_shepard_12_up(sound_writer* const fo, double* const s)
 {
     note_shepard(fo, s, 261.626); // C4
     silence(fo, s);
@@ -77,19 +84,75 @@ gamme_shepard_12_up(FILE* const fo, double* const s)
     silence(fo, s);
 }
 
-int main(int argc, char** argv)
+// Renders a Shepard-Risset glissando, chunk by chunk, each chunk in parallel segments.
+static int
+glissando(sound_writer* const output, const double duration, const double speed, const int threads)
 {
-    if (argc != 1) {
-        printf("Usage: %s\n.", argv[0]);
-        exit(EXIT_FAILURE);
+    shepard* const glissando = shepard_create(GLISSANDO_LOWEST, GLISSANDO_OCTAVES, speed, GLISSANDO_WIDTH, SAMPLE_RATE);
+    double* const chunk = malloc(CHUNK_SIZE * sizeof(double));
+    if (glissando == NULL || chunk == NULL) {
+        shepard_destroy(glissando);
+        free(chunk);
+        return -1;
+    }
+
+    const long samples = duration * SAMPLE_RATE;
+    for (long first = 0; first < samples; first += CHUNK_SIZE) {
+        const int n = samples - first < CHUNK_SIZE ? samples - first : CHUNK_SIZE;
+        shepard_render_parallel(glissando, chunk, first, n, threads);
+        sound_file_write(output, chunk, n);
     }
 
-    FILE* const sound_file = sound_file_open_write(RAW_FILENAME);
+    shepard_destroy(glissando);
+    free(chunk);
+    return 0;
+}
 
-    double s[FRAME_SIZE];
-    for (int i = 0; i < 4; i++)
-        gamme_shepard_12_up(sound_file, s);
+static void
+usage(const char* const program)
+{
+    printf("Usage: %s [-g] [-d seconds] [-r octaves per second] [-j threads] [output]\n.", program);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    bool continuous = false;
+    double duration = 60., speed = .1;
+    int threads = batch_threads();
+    for (int option; (option = getopt(argc, argv, "gd:r:j:")) != -1;)
+        if (option == 'g')
+            continuous = true;
+        else if (option == 'd' && (duration = atof(optarg)) > 0.)
+            continue;
+        else if (option == 'r')
+            speed = atof(optarg);
+        else if (option == 'j' && (threads = atoi(optarg)) > 0)
+            continue;
+        else
+            usage(argv[0]);
+
+    if (argc - optind > 1)
+        usage(argv[0]);
+
+    sound_writer* const sound_file = sound_file_open_write(optind < argc ? argv[optind] : OUT_FILENAME, 1, SAMPLE_RATE);
+
+    if (continuous) {
+        if (glissando(sound_file, duration, speed, threads) != 0)
+            return EXIT_FAILURE;
+    } else {
+        bank = oscillator_bank_create(2, SAMPLE_RATE);
+        double* const s = malloc(FRAME_SIZE * sizeof(double));
+        if (bank == NULL || s == NULL)
+            return EXIT_FAILURE;
+
+        for (int i = 0; i < 4; i++)
+            gamme_shepard_12_up(sound_file, s);
+
+        oscillator_bank_destroy(bank);
+        free(s);
+    }
 
-    sound_file_close_write(sound_file, RAW_FILENAME, OUT_FILENAME, 1, SAMPLE_RATE);
+    sound_file_close_write(sound_file);
     return EXIT_SUCCESS;
 }
@@ -10,11 +10,10 @@
 #define FE 44100
 #define N (int) (DUREE * FE)
 
-static const char* const RAW_FILENAME = "outputs/raw_iantsa.raw";
 static const char* const OUT_FILENAME = "outputs/out_iantsa.wav";
 
 static void
-silence(double* s, FILE* output)
+silence(double* s, sound_writer* output)
 {
     for (int i = 0; i < N; i++)
         s[i] = 0;
@@ -23,7 +22,7 @@ silence(double* s, FILE* output)
 }
 
 static void
-note_shepard(double* s, double f, FILE* output)
+note_shepard(double* s, double f, sound_writer* output)
 {
     // version 1
     // double a;
@@ -46,7 +45,7 @@ note_shepard(double* s, double f, FILE* output)
 }
 
 static void
-gamme_shepard_12_up(double* s, FILE* fo)
+gamme_shepard_12_up(double* s, sound_writer* fo)
 {
     note_shepard(s, 261.626, fo); // C4
     silence(s, fo);
@@ -87,17 +86,17 @@ gamme_shepard_12_up(double* s, FILE* fo)
 
 int main(int argc, char** argv)
 {
-    if (argc != 1) {
-        printf("Usage: %s\n.", argv[0]);
+    if (argc > 2) {
+        printf("Usage: %s [output]\n.", argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    FILE* const sound_file = sound_file_open_write(RAW_FILENAME);
+    sound_writer* const sound_file = sound_file_open_write(argc == 2 ? argv[1] : OUT_FILENAME, 1, FE);
 
     double s[N];
     for (int i = 0; i < 4; i++)
         gamme_shepard_12_up(s, sound_file);
 
-    sound_file_close_write(sound_file, RAW_FILENAME, OUT_FILENAME, 1, FE);
+    sound_file_close_write(sound_file);
     return EXIT_SUCCESS;
 }
@@ -1,34 +1,32 @@
 #ifndef SOUND_FILE_H
 #define SOUND_FILE_H
 
-#include <stdio.h>
+#include "sound_writer.h"
 
 /**
  * @brief Opens a sound file for writing.
  *
- * @param raw_filename The name of the file to open.
+ * @param out_filename The name of the file to open (WAV, FLAC for .flac, "-" for the standard output).
+ * @param num_channels The number of channels.
+ * @param sample_rate The sample rate.
  * @return The file object.
  */
-FILE* sound_file_open_write(const char* const raw_filename);
+sound_writer* sound_file_open_write(const char* const out_filename, const int num_channels, const int sample_rate);
 
 /**
  * @brief Writes a sound frame into a file.
  *
- * @param raw_file The file object.
+ * @param out_file The file object.
  * @param frame_buffer The frame to write.
  * @param frame_size The size of the frame to write.
  */
-void sound_file_write(FILE* const raw_file, const double* const frame_buffer, const int frame_size);
+void sound_file_write(sound_writer* const out_file, const double* const frame_buffer, const int frame_size);
 
 /**
- * @brief Closes a sound file after writing, and renders it.
+ * @brief Closes a sound file after writing.
  *
- * @param raw_file The file object.
- * @param raw_filename The name of the file before rendering.
- * @param out_filename The name of the file after rendering.
- * @param num_channels The number of channels for the rendering.
- * @param sample_rate The sample rate for the rendering.
+ * @param out_file The file object.
  */
-void sound_file_close_write(FILE* const raw_file, const char* const raw_filename, const char* const out_filename, const int num_channels, const int sample_rate);
+void sound_file_close_write(sound_writer* const out_file);
 
 #endif // SOUND_FILE_H
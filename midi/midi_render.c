@@ -0,0 +1,302 @@
+#include "midi_render.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "oscillator.h"
+
+#define PERCUSSION_CHANNEL 9 // Channel 10, counted from 0.
+#define DEFAULT_TEMPO 120. // BPM, until the first tempo event.
+
+#define GAIN .25 // Peak of a note of velocity 127.
+#define ATTACK .005 // Seconds from 0 to the peak.
+#define DECAY 2. // Seconds to fall by e while held.
+#define RELEASE .08 // Seconds to fall by e once released.
+#define SILENCE .001 // Level, relative to the peak, at which a released voice stops.
+#define TAIL 10. // Largest release after the last event (seconds).
+
+typedef enum voice_state {
+    VOICE_FREE,
+    VOICE_ATTACK,
+    VOICE_HOLD,
+    VOICE_RELEASE
+} voice_state;
+
+typedef struct voice {
+    voice_state state;
+    int channel;
+    int note;
+    long start; // Note number, to steal the oldest voice.
+    double frequency; // Hz.
+    double peak;
+    double level;
+} voice;
+
+typedef struct renderer {
+    double sample_rate;
+    int count; // Number of voices.
+    long notes; // Number of notes started.
+    voice* voices;
+    oscillator_bank* bank; // MIDI_RENDER_PARTIALS partials per voice.
+    sound_writer* writer;
+    double block[MIDI_RENDER_BLOCK_SIZE];
+} renderer;
+
+// Relative amplitudes of the harmonics of a voice.
+static const double harmonics[MIDI_RENDER_PARTIALS] = { .5, .25, .15, .1 };
+
+tempo_map* tempo_map_create(MidiFile_t midi_file, const double sample_rate)
+{
+    const int resolution = MidiFile_getResolution(midi_file);
+    double frames; // Per second, 0 for a tempo in beats.
+    switch (MidiFile_getDivisionType(midi_file)) {
+    case MIDI_FILE_DIVISION_TYPE_PPQ:
+        frames = 0.;
+        break;
+    case MIDI_FILE_DIVISION_TYPE_SMPTE24:
+        frames = 24.;
+        break;
+    case MIDI_FILE_DIVISION_TYPE_SMPTE25:
+        frames = 25.;
+        break;
+    case MIDI_FILE_DIVISION_TYPE_SMPTE30DROP:
+        frames = 29.97;
+        break;
+    case MIDI_FILE_DIVISION_TYPE_SMPTE30:
+        frames = 30.;
+        break;
+    default:
+        return NULL;
+    }
+    if (resolution <= 0)
+        return NULL;
+
+    // Only the conductor track sets the tempo, as in MidiFile_getTimeFromTick.
+    MidiFileTrack_t conductor_track = frames == 0. ? MidiFile_getFirstTrack(midi_file) : NULL;
+    int count = 1;
+    if (conductor_track != NULL)
+        for (MidiFileEvent_t event = MidiFileTrack_getFirstEvent(conductor_track); event != NULL; event = MidiFileEvent_getNextEventInTrack(event))
+            if (MidiFileEvent_isTempoEvent(event))
+                count++;
+
+    tempo_map* const map = malloc(sizeof(tempo_map));
+    if (map == NULL)
+        return NULL;
+
+    map->ticks = malloc(count * sizeof(long));
+    map->samples = malloc(2 * count * sizeof(double));
+    if (map->ticks == NULL || map->samples == NULL) {
+        tempo_map_destroy(map);
+        return NULL;
+    }
+
+    map->samples_per_tick = map->samples + count;
+    map->count = 1;
+    map->ticks[0] = 0;
+    map->samples[0] = 0.;
+    map->samples_per_tick[0] = frames != 0. ? sample_rate / (resolution * frames) : sample_rate * 60. / (DEFAULT_TEMPO * resolution);
+
+    if (conductor_track != NULL)
+        for (MidiFileEvent_t event = MidiFileTrack_getFirstEvent(conductor_track); event != NULL; event = MidiFileEvent_getNextEventInTrack(event)) {
+            if (!MidiFileEvent_isTempoEvent(event))
+                continue;
+
+            const int last = map->count - 1;
+            const long tick = MidiFileEvent_getTick(event);
+            const double samples_per_tick = sample_rate * 60. / (MidiFileTempoEvent_getTempo(event) * resolution);
+
+            // Several tempo events on the same tick: the last one wins.
+            const int segment = tick == map->ticks[last] ? last : map->count++;
+            map->samples[segment] = map->samples[last] + (tick - map->ticks[last]) * map->samples_per_tick[last];
+            map->ticks[segment] = tick;
+            map->samples_per_tick[segment] = samples_per_tick;
+        }
+    return map;
+}
+
+double tempo_map_sample(const tempo_map* const map, const long tick, int* const cursor)
+{
+    int segment = *cursor;
+    while (segment + 1 < map->count && map->ticks[segment + 1] <= tick)
+        segment++;
+    while (segment > 0 && map->ticks[segment] > tick)
+        segment--;
+
+    *cursor = segment;
+    return map->samples[segment] + (tick - map->ticks[segment]) * map->samples_per_tick[segment];
+}
+
+void tempo_map_destroy(tempo_map* const map)
+{
+    if (map == NULL)
+        return;
+
+    free(map->ticks);
+    free(map->samples); // And the samples per tick.
+    free(map);
+}
+
+static void
+note_on(renderer* const r, const int channel, const int note, const int velocity)
+{
+    // A silent voice, or else the oldest released one, or else the oldest one.
+    int chosen = -1;
+    for (int i = 0; i < r->count && chosen < 0; i++)
+        if (r->voices[i].state == VOICE_FREE)
+            chosen = i;
+    if (chosen < 0)
+        for (int i = 0; i < r->count; i++)
+            if (r->voices[i].state == VOICE_RELEASE && (chosen < 0 || r->voices[i].start < r->voices[chosen].start))
+                chosen = i;
+    if (chosen < 0) {
+        chosen = 0;
+        for (int i = 1; i < r->count; i++)
+            if (r->voices[i].start < r->voices[chosen].start)
+                chosen = i;
+    }
+
+    // A stolen voice starts the new note from its current level.
+    voice* const v = &r->voices[chosen];
+    v->state = VOICE_ATTACK;
+    v->channel = channel;
+    v->note = note;
+    v->start = r->notes++;
+    v->frequency = 440. * exp2((note - 69) / 12.);
+    v->peak = GAIN * velocity / 127.;
+    for (int partial = 0; partial < MIDI_RENDER_PARTIALS; partial++)
+        oscillator_bank_tune(r->bank, chosen * MIDI_RENDER_PARTIALS + partial, v->frequency * (partial + 1));
+}
+
+static void
+note_off(renderer* const r, const int channel, const int note)
+{
+    // The oldest held voice playing the note.
+    voice* held = NULL;
+    for (int i = 0; i < r->count; i++) {
+        voice* const v = &r->voices[i];
+        if ((v->state == VOICE_ATTACK || v->state == VOICE_HOLD) && v->channel == channel && v->note == note && (held == NULL || v->start < held->start))
+            held = v;
+    }
+    if (held != NULL)
+        held->state = VOICE_RELEASE;
+}
+
+// Moves the envelopes n samples forward, the bank ramps to them over the next block.
+static void
+update_envelopes(renderer* const r, const int n)
+{
+    const double seconds = n / r->sample_rate;
+    const double decay = exp(-seconds / DECAY);
+    const double release = exp(-seconds / RELEASE);
+
+    for (int i = 0; i < r->count; i++) {
+        voice* const v = &r->voices[i];
+        switch (v->state) {
+        case VOICE_FREE:
+            continue;
+        case VOICE_ATTACK:
+            v->level += v->peak * seconds / ATTACK;
+            if (v->level >= v->peak) {
+                v->level = v->peak;
+                v->state = VOICE_HOLD;
+            }
+            break;
+        case VOICE_HOLD:
+            v->level *= decay;
+            break;
+        case VOICE_RELEASE:
+            v->level *= release;
+            if (v->level < SILENCE * v->peak) {
+                v->level = 0.;
+                v->state = VOICE_FREE;
+            }
+            break;
+        }
+
+        for (int partial = 0; partial < MIDI_RENDER_PARTIALS; partial++) {
+            const double frequency = v->frequency * (partial + 1);
+            const double amplitude = frequency < r->sample_rate / 2. ? v->level * harmonics[partial] : 0.;
+            oscillator_bank_set(r->bank, i * MIDI_RENDER_PARTIALS + partial, amplitude, frequency);
+        }
+    }
+}
+
+// Renders and writes n samples, returns -1 if they could not be written.
+static int
+advance(renderer* const r, long n)
+{
+    while (n > 0) {
+        const int count = n < MIDI_RENDER_BLOCK_SIZE ? n : MIDI_RENDER_BLOCK_SIZE;
+        update_envelopes(r, count);
+        oscillator_bank_render(r->bank, r->block, count);
+        if (sound_writer_write(r->writer, r->block, count) < count)
+            return -1;
+        n -= count;
+    }
+    return 0;
+}
+
+static int
+sounding(const renderer* const r)
+{
+    for (int i = 0; i < r->count; i++)
+        if (r->voices[i].state != VOICE_FREE)
+            return 1;
+    return 0;
+}
+
+long midi_render(MidiFile_t midi_file, sound_writer* const writer, const double sample_rate, const int voices)
+{
+    renderer r = { sample_rate, voices, 0, NULL, NULL, writer, { 0. } };
+    tempo_map* const map = tempo_map_create(midi_file, sample_rate);
+    if (voices > 0) {
+        r.voices = calloc(voices, sizeof(voice));
+        r.bank = oscillator_bank_create(voices * MIDI_RENDER_PARTIALS, sample_rate);
+    }
+    if (map == NULL || r.voices == NULL || r.bank == NULL) {
+        tempo_map_destroy(map);
+        free(r.voices);
+        oscillator_bank_destroy(r.bank);
+        return -1;
+    }
+    for (int partial = 0; partial < voices * MIDI_RENDER_PARTIALS; partial++)
+        oscillator_bank_add(r.bank, 0., 0., 0.);
+
+    long position = 0;
+    int cursor = 0;
+    int failed = 0;
+    for (MidiFileEvent_t event = MidiFile_getFirstEvent(midi_file); event != NULL && !failed; event = MidiFileEvent_getNextEventInFile(event)) {
+        const int start = MidiFileEvent_isNoteStartEvent(event);
+        if (!start && !MidiFileEvent_isNoteEndEvent(event))
+            continue;
+
+        const int channel = start ? MidiFileNoteStartEvent_getChannel(event) : MidiFileNoteEndEvent_getChannel(event);
+        if (channel == PERCUSSION_CHANNEL)
+            continue;
+
+        const long sample = lround(tempo_map_sample(map, MidiFileEvent_getTick(event), &cursor));
+        if (sample > position) {
+            failed = advance(&r, sample - position) < 0;
+            position = sample;
+        }
+
+        if (start)
+            note_on(&r, channel, MidiFileNoteStartEvent_getNote(event), MidiFileNoteStartEvent_getVelocity(event));
+        else
+            note_off(&r, channel, MidiFileNoteEndEvent_getNote(event));
+    }
+
+    // Notes left held are released, then rendered until silent.
+    for (int i = 0; i < voices; i++)
+        if (r.voices[i].state != VOICE_FREE)
+            r.voices[i].state = VOICE_RELEASE;
+    for (long tail = 0; !failed && sounding(&r) && tail < TAIL * sample_rate; tail += MIDI_RENDER_BLOCK_SIZE) {
+        failed = advance(&r, MIDI_RENDER_BLOCK_SIZE) < 0;
+        position += MIDI_RENDER_BLOCK_SIZE;
+    }
+
+    tempo_map_destroy(map);
+    free(r.voices);
+    oscillator_bank_destroy(r.bank);
+    return failed ? -1 : position;
+}
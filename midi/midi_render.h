@@ -0,0 +1,70 @@
+#ifndef MIDI_RENDER_H
+#define MIDI_RENDER_H
+
+#include "midifile.h"
+#include "sound_writer.h"
+
+/*
+ * Offline MIDI renderer.
+ *
+ * The events are walked once, in file order. Ticks are converted to sample
+ * offsets through a tempo map built beforehand from the conductor track
+ * (MidiFile_getTimeFromTick scans the whole track at every call), read with a
+ * cursor since the ticks only grow.
+ *
+ * Each note is played by a voice of MIDI_RENDER_PARTIALS harmonics in an
+ * oscillator bank, with a short attack, a slow decay while held and an
+ * exponential release. A note takes a silent voice, or else steals the oldest
+ * released one, or else the oldest one. Envelopes are evaluated every
+ * MIDI_RENDER_BLOCK_SIZE samples (and at every event), and ramped linearly in
+ * between by the bank. The percussion channel is skipped.
+ */
+
+#define MIDI_RENDER_PARTIALS 4 // Harmonics per voice.
+#define MIDI_RENDER_BLOCK_SIZE 128 // Samples between envelope evaluations.
+
+typedef struct tempo_map {
+    int count; // Number of tempo segments.
+    long* ticks; // Start of each segment.
+    double* samples; // Sample offset of the start of each segment.
+    double* samples_per_tick;
+} tempo_map;
+
+/**
+ * @brief Creates the tempo map of a MIDI file.
+ *
+ * @param midi_file The MIDI file.
+ * @param sample_rate The sample rate (Hz).
+ * @return The tempo map, or NULL if the division type is invalid or the allocation failed.
+ */
+tempo_map* tempo_map_create(MidiFile_t midi_file, const double sample_rate);
+
+/**
+ * @brief Converts a tick to a sample offset.
+ *
+ * @param map The tempo map.
+ * @param tick The tick.
+ * @param cursor The segment of the previous tick (0 at first), updated.
+ * @return The sample offset (not rounded).
+ */
+double tempo_map_sample(const tempo_map* const map, const long tick, int* const cursor);
+
+/**
+ * @brief Destroys a tempo map.
+ *
+ * @param map The tempo map.
+ */
+void tempo_map_destroy(tempo_map* const map);
+
+/**
+ * @brief Renders a MIDI file.
+ *
+ * @param midi_file The MIDI file.
+ * @param writer The writer of the sound (mono).
+ * @param sample_rate The sample rate (Hz).
+ * @param voices The number of voices.
+ * @return The number of samples written, or -1 on failure.
+ */
+long midi_render(MidiFile_t midi_file, sound_writer* const writer, const double sample_rate, const int voices);
+
+#endif // MIDI_RENDER_H
@@ -1,13 +1,34 @@
 #include "midifile.h"
 
+#include <fcntl.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ARENA_FIRST_BLOCK_SIZE 4096
+#define ARENA_LARGEST_BLOCK_SIZE (1 << 20)
+#define MMAP_THRESHOLD (1 << 16) /* smaller files are read instead */
 
 /*
  * Data Types
  */
 
+/* a byte cursor, past the end once a read did not fit */
+struct MidiFileReader {
+    const unsigned char* data;
+    long position;
+    long end;
+};
+
+struct MidiFileArenaBlock {
+    struct MidiFileArenaBlock* next_block;
+    max_align_t data[];
+};
+
 struct MidiFile {
     int file_format;
     MidiFileDivisionType_t division_type;
@@ -17,6 +38,15 @@ struct MidiFile {
     struct MidiFileTrack* last_track;
     struct MidiFileEvent* first_event;
     struct MidiFileEvent* last_event;
+    int bulk_inserting; /* events are only linked in file order by MidiFile_endBulkInsert() */
+
+    /* Tracks, events and event data are carved out of large blocks, all released at once by MidiFile_free(). */
+    struct MidiFileArenaBlock* arena_blocks;
+    unsigned char* arena_cursor;
+    size_t arena_bytes_left;
+    size_t arena_next_block_size;
+    struct MidiFileTrack* free_tracks; /* deleted tracks, linked by next_track */
+    struct MidiFileEvent* free_events; /* deleted events, linked by next_event_in_file */
 };
 
 struct MidiFileTrack {
@@ -106,16 +136,25 @@ struct MidiFileEvent {
  * Helpers
  */
 
-static signed short interpret_int16(unsigned char* buffer)
+static inline int read_byte(struct MidiFileReader* reader)
 {
-    return ((signed short)(buffer[0]) << 8) | (signed short)(buffer[1]);
+    int value = (reader->position < reader->end) ? reader->data[reader->position] : 0;
+    reader->position++;
+    return value;
 }
 
-static signed short read_int16(FILE* in)
+static inline const unsigned char* read_bytes(struct MidiFileReader* reader, unsigned long length)
 {
-    unsigned char buffer[2];
-    fread(buffer, 1, 2, in);
-    return interpret_int16(buffer);
+    const unsigned char* bytes;
+
+    if ((reader->position > reader->end) || (length > (unsigned long)(reader->end - reader->position))) {
+        reader->position = reader->end + 1;
+        return NULL;
+    }
+
+    bytes = reader->data + reader->position;
+    reader->position += length;
+    return bytes;
 }
 
 static void write_int16(FILE* out, signed short value)
@@ -126,16 +165,15 @@ static void write_int16(FILE* out, signed short value)
     fwrite(buffer, 1, 2, out);
 }
 
-static unsigned short interpret_uint16(unsigned char* buffer)
+static unsigned short interpret_uint16(const unsigned char* buffer)
 {
     return ((unsigned short)(buffer[0]) << 8) | (unsigned short)(buffer[1]);
 }
 
-static unsigned short read_uint16(FILE* in)
+static inline unsigned short read_uint16(struct MidiFileReader* reader)
 {
-    unsigned char buffer[2];
-    fread(buffer, 1, 2, in);
-    return interpret_uint16(buffer);
+    const unsigned char* bytes = read_bytes(reader, 2);
+    return (bytes != NULL) ? interpret_uint16(bytes) : 0;
 }
 
 static void write_uint16(FILE* out, unsigned short value)
@@ -146,16 +184,15 @@ static void write_uint16(FILE* out, unsigned short value)
     fwrite(buffer, 1, 2, out);
 }
 
-static unsigned long interpret_uint32(unsigned char* buffer)
+static unsigned long interpret_uint32(const unsigned char* buffer)
 {
     return ((unsigned long)(buffer[0]) << 24) | ((unsigned long)(buffer[1]) << 16) | ((unsigned long)(buffer[2]) << 8) | (unsigned long)(buffer[3]);
 }
 
-static unsigned long read_uint32(FILE* in)
+static inline unsigned long read_uint32(struct MidiFileReader* reader)
 {
-    unsigned char buffer[4];
-    fread(buffer, 1, 4, in);
-    return interpret_uint32(buffer);
+    const unsigned char* bytes = read_bytes(reader, 4);
+    return (bytes != NULL) ? interpret_uint32(bytes) : 0;
 }
 
 static void write_uint32(FILE* out, unsigned long value)
@@ -168,19 +205,63 @@ static void write_uint32(FILE* out, unsigned long value)
     fwrite(buffer, 1, 4, out);
 }
 
-static unsigned long read_variable_length_quantity(FILE* in)
+static inline unsigned long read_variable_length_quantity(struct MidiFileReader* reader)
 {
-    unsigned char b;
+    int b;
     unsigned long value = 0;
 
     do {
-        b = fgetc(in);
+        b = read_byte(reader);
         value = (value << 7) | (b & 0x7F);
     } while ((b & 0x80) == 0x80);
 
     return value;
 }
 
+static long read_file(int fd, unsigned char* buffer, long size)
+{
+    long total = 0, count;
+
+    while ((total < size) && ((count = read(fd, buffer + total, size - total)) > 0))
+        total += count;
+
+    return total;
+}
+
+/* reads a pipe or any other file of unknown size until the end, into a buffer that grows */
+static unsigned char* read_stream(int fd, long* size)
+{
+    unsigned char* buffer = NULL;
+    unsigned char* grown;
+    long capacity = 0, count;
+
+    *size = 0;
+
+    do {
+        if (*size == capacity) {
+            capacity = (capacity > 0) ? 2 * capacity : 4096;
+
+            if ((grown = (unsigned char*)(realloc(buffer, capacity))) == NULL) {
+                free(buffer);
+                return NULL;
+            }
+
+            buffer = grown;
+        }
+
+        count = read(fd, buffer + *size, capacity - *size);
+        if (count > 0)
+            *size += count;
+    } while (count > 0);
+
+    if (count < 0) {
+        free(buffer);
+        return NULL;
+    }
+
+    return buffer;
+}
+
 static void write_variable_length_quantity(FILE* out, unsigned long value)
 {
     unsigned char buffer[4];
@@ -199,6 +280,116 @@ static void write_variable_length_quantity(FILE* out, unsigned long value)
     fwrite(buffer + offset, 1, 4 - offset, out);
 }
 
+/* leaves the buffer and its size untouched if it cannot grow */
+static int grow_buffer(unsigned char** buffer, int* size, int needed_size)
+{
+    unsigned char* grown;
+    int new_size;
+
+    if (needed_size > *size) {
+        new_size = (needed_size > 2 * *size) ? needed_size : 2 * *size;
+
+        if ((grown = (unsigned char*)(realloc(*buffer, new_size))) == NULL)
+            return -1;
+
+        *buffer = grown;
+        *size = new_size;
+    }
+
+    return 0;
+}
+
+static void* arena_allocate(MidiFile_t midi_file, size_t size)
+{
+    void* pointer;
+
+    /* keep every allocation aligned for any type, and distinct (even empty data has its own address) */
+    size = (size > 0) ? (size + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t) : _Alignof(max_align_t);
+
+    if (size > midi_file->arena_bytes_left) {
+        size_t block_size = (size > midi_file->arena_next_block_size) ? size : midi_file->arena_next_block_size;
+        struct MidiFileArenaBlock* block = (struct MidiFileArenaBlock*)(malloc(sizeof(struct MidiFileArenaBlock) + block_size));
+
+        if (block == NULL)
+            return NULL;
+
+        block->next_block = midi_file->arena_blocks;
+        midi_file->arena_blocks = block;
+        midi_file->arena_cursor = (unsigned char*)(block->data);
+        midi_file->arena_bytes_left = block_size;
+
+        if (midi_file->arena_next_block_size < ARENA_LARGEST_BLOCK_SIZE)
+            midi_file->arena_next_block_size *= 2;
+    }
+
+    pointer = midi_file->arena_cursor;
+    midi_file->arena_cursor += size;
+    midi_file->arena_bytes_left -= size;
+    return pointer;
+}
+
+static unsigned char* arena_copy_data(MidiFile_t midi_file, int data_length, unsigned char* data_buffer)
+{
+    unsigned char* copy = (unsigned char*)(arena_allocate(midi_file, data_length));
+
+    if (copy != NULL)
+        memcpy(copy, data_buffer, data_length);
+
+    return copy;
+}
+
+static MidiFileTrack_t allocate_track(MidiFile_t midi_file)
+{
+    MidiFileTrack_t track = midi_file->free_tracks;
+
+    if (track == NULL)
+        return (MidiFileTrack_t)(arena_allocate(midi_file, sizeof(struct MidiFileTrack)));
+
+    midi_file->free_tracks = track->next_track;
+    return track;
+}
+
+static MidiFileEvent_t allocate_event(MidiFileTrack_t track)
+{
+    MidiFileEvent_t event = track->midi_file->free_events;
+
+    if (event == NULL)
+        return (MidiFileEvent_t)(arena_allocate(track->midi_file, sizeof(struct MidiFileEvent)));
+
+    track->midi_file->free_events = event->next_event_in_file;
+    return event;
+}
+
+static void release_event(MidiFileEvent_t event)
+{
+    /* the data of sysex and meta events stays in the arena until MidiFile_free() */
+    event->next_event_in_file = event->track->midi_file->free_events;
+    event->track->midi_file->free_events = event;
+}
+
+static void add_event_in_file(MidiFileEvent_t new_event)
+{
+    MidiFileEvent_t event;
+
+    for (event = new_event->track->midi_file->last_event; (event != NULL) && (new_event->tick < event->tick); event = event->previous_event_in_file) { }
+
+    new_event->previous_event_in_file = event;
+
+    if (event == NULL) {
+        new_event->next_event_in_file = new_event->track->midi_file->first_event;
+        new_event->track->midi_file->first_event = new_event;
+    } else {
+        new_event->next_event_in_file = event->next_event_in_file;
+        event->next_event_in_file = new_event;
+    }
+
+    if (new_event->next_event_in_file == NULL) {
+        new_event->track->midi_file->last_event = new_event;
+    } else {
+        new_event->next_event_in_file->previous_event_in_file = new_event;
+    }
+}
+
 static void add_event(MidiFileEvent_t new_event)
 {
     /* Add in proper sorted order.  Search backwards to optimize for appending. */
@@ -223,26 +414,88 @@ static void add_event(MidiFileEvent_t new_event)
         new_event->next_event_in_track->previous_event_in_track = new_event;
     }
 
-    for (event = new_event->track->midi_file->last_event; (event != NULL) && (new_event->tick < event->tick); event = event->previous_event_in_file) { }
+    if (!new_event->track->midi_file->bulk_inserting)
+        add_event_in_file(new_event);
 
-    new_event->previous_event_in_file = event;
+    if (new_event->tick > new_event->track->end_tick)
+        new_event->track->end_tick = new_event->tick;
+}
 
-    if (event == NULL) {
-        new_event->next_event_in_file = new_event->track->midi_file->first_event;
-        new_event->track->midi_file->first_event = new_event;
-    } else {
-        new_event->next_event_in_file = event->next_event_in_file;
-        event->next_event_in_file = new_event;
+/* whether event comes before other_event in the file, as if the tracks had been loaded one after the other */
+static int precedes_in_file(MidiFileEvent_t event, MidiFileEvent_t other_event)
+{
+    return (event->tick < other_event->tick) || ((event->tick == other_event->tick) && (event->track->number < other_event->track->number));
+}
+
+static void sift_down(MidiFileEvent_t* heap, int count, int index)
+{
+    MidiFileEvent_t event = heap[index];
+    int child;
+
+    while ((child = 2 * index + 1) < count) {
+        if ((child + 1 < count) && precedes_in_file(heap[child + 1], heap[child]))
+            child++;
+        if (!precedes_in_file(heap[child], event))
+            break;
+        heap[index] = heap[child];
+        index = child;
     }
 
-    if (new_event->next_event_in_file == NULL) {
-        new_event->track->midi_file->last_event = new_event;
-    } else {
-        new_event->next_event_in_file->previous_event_in_file = new_event;
+    heap[index] = event;
+}
+
+static void link_events_in_file(MidiFile_t midi_file)
+{
+    /* k-way merge of the tracks, through a heap of the next event of each track */
+
+    MidiFileEvent_t *heap, event, previous_event = NULL;
+    MidiFileTrack_t track;
+    int count = 0, index;
+
+    midi_file->first_event = NULL;
+    midi_file->last_event = NULL;
+
+    if (midi_file->first_track == NULL)
+        return;
+
+    if ((heap = (MidiFileEvent_t*)(malloc(midi_file->number_of_tracks * sizeof(MidiFileEvent_t)))) == NULL) {
+        /* out of memory for the heap:  insert the events one by one instead */
+        for (track = midi_file->first_track; track != NULL; track = track->next_track) {
+            for (event = track->first_event; event != NULL; event = event->next_event_in_track)
+                add_event_in_file(event);
+        }
+
+        return;
     }
 
-    if (new_event->tick > new_event->track->end_tick)
-        new_event->track->end_tick = new_event->tick;
+    for (track = midi_file->first_track; track != NULL; track = track->next_track) {
+        if (track->first_event != NULL)
+            heap[count++] = track->first_event;
+    }
+
+    for (index = count / 2 - 1; index >= 0; index--)
+        sift_down(heap, count, index);
+
+    while (count > 0) {
+        event = heap[0];
+        event->previous_event_in_file = previous_event;
+
+        if (previous_event == NULL) {
+            midi_file->first_event = event;
+        } else {
+            previous_event->next_event_in_file = event;
+        }
+
+        previous_event = event;
+        heap[0] = (event->next_event_in_track != NULL) ? event->next_event_in_track : heap[--count];
+        sift_down(heap, count, 0);
+    }
+
+    if (previous_event != NULL)
+        previous_event->next_event_in_file = NULL;
+
+    midi_file->last_event = previous_event;
+    free(heap);
 }
 
 static void remove_event(MidiFileEvent_t event)
@@ -259,6 +512,9 @@ static void remove_event(MidiFileEvent_t event)
         event->next_event_in_track->previous_event_in_track = event->previous_event_in_track;
     }
 
+    if (event->track->midi_file->bulk_inserting)
+        return;
+
     if (event->previous_event_in_file == NULL) {
         event->track->midi_file->first_event = event->next_event_in_file;
     } else {
@@ -272,25 +528,14 @@ static void remove_event(MidiFileEvent_t event)
     }
 }
 
-static void free_events_in_track(MidiFileTrack_t track)
+static void release_events_in_track(MidiFileTrack_t track)
 {
     MidiFileEvent_t event, next_event_in_track;
 
     for (event = track->first_event; event != NULL; event = next_event_in_track) {
         next_event_in_track = event->next_event_in_track;
-
-        switch (event->type) {
-        case MIDI_FILE_EVENT_TYPE_SYSEX: {
-            free(event->u.sysex.data_buffer);
-            break;
-        }
-        case MIDI_FILE_EVENT_TYPE_META: {
-            free(event->u.meta.data_buffer);
-            break;
-        }
-        }
-
-        free(event);
+        remove_event(event);
+        release_event(event);
     }
 }
 
@@ -298,52 +543,55 @@ static void free_events_in_track(MidiFileTrack_t track)
  * Public API
  */
 
-MidiFile_t MidiFile_load(char* filename)
+MidiFile_t MidiFile_loadFromBuffer(const unsigned char* buffer, long size)
 {
     MidiFile_t midi_file;
-    FILE* in;
-    unsigned char chunk_id[4], division_type_and_resolution[4];
+    struct MidiFileReader reader;
+    const unsigned char *chunk_id, *division_type_and_resolution;
     long chunk_size, chunk_start;
     int file_format, number_of_tracks, number_of_tracks_read = 0;
+    unsigned char* data_buffer = NULL; /* sysex data, behind their status byte */
+    int data_buffer_size = 0;
 
-    if ((filename == NULL) || ((in = fopen(filename, "rb")) == NULL))
+    if ((buffer == NULL) || (size < 0))
         return NULL;
 
-    fread(chunk_id, 1, 4, in);
-    chunk_size = read_uint32(in);
-    chunk_start = ftell(in);
+    reader.data = buffer;
+    reader.position = 0;
+    reader.end = size;
+
+    chunk_id = read_bytes(&reader, 4);
+    chunk_size = read_uint32(&reader);
+    chunk_start = reader.position;
 
     /* check for the RMID variation on SMF */
 
-    if (memcmp(chunk_id, "RIFF", 4) == 0) {
-        fread(chunk_id, 1, 4, in); /* technically this one is a type id rather than a chunk id, but we'll reuse the buffer anyway */
+    if ((chunk_id != NULL) && (memcmp(chunk_id, "RIFF", 4) == 0)) {
+        chunk_id = read_bytes(&reader, 4); /* technically this one is a type id rather than a chunk id */
 
-        if (memcmp(chunk_id, "RMID", 4) != 0) {
-            fclose(in);
+        if ((chunk_id == NULL) || (memcmp(chunk_id, "RMID", 4) != 0))
             return NULL;
-        }
 
-        fread(chunk_id, 1, 4, in);
-        chunk_size = read_uint32(in);
+        chunk_id = read_bytes(&reader, 4);
+        chunk_size = read_uint32(&reader);
 
-        if (memcmp(chunk_id, "data", 4) != 0) {
-            fclose(in);
+        if ((chunk_id == NULL) || (memcmp(chunk_id, "data", 4) != 0))
             return NULL;
-        }
 
-        fread(chunk_id, 1, 4, in);
-        chunk_size = read_uint32(in);
-        chunk_start = ftell(in);
+        chunk_id = read_bytes(&reader, 4);
+        chunk_size = read_uint32(&reader);
+        chunk_start = reader.position;
     }
 
-    if (memcmp(chunk_id, "MThd", 4) != 0) {
-        fclose(in);
+    if ((chunk_id == NULL) || (memcmp(chunk_id, "MThd", 4) != 0))
         return NULL;
-    }
 
-    file_format = read_uint16(in);
-    number_of_tracks = read_uint16(in);
-    fread(division_type_and_resolution, 1, 2, in);
+    file_format = read_uint16(&reader);
+    number_of_tracks = read_uint16(&reader);
+    division_type_and_resolution = read_bytes(&reader, 2);
+
+    if (division_type_and_resolution == NULL)
+        return NULL;
 
     switch ((signed char)(division_type_and_resolution[0])) {
     case -24: {
@@ -368,13 +616,20 @@ MidiFile_t MidiFile_load(char* filename)
     }
     }
 
+    if (midi_file == NULL)
+        return NULL;
+
+    /* the tracks are read one after the other, then merged in file order at once */
+    MidiFile_beginBulkInsert(midi_file);
+
     /* forwards compatibility:  skip over any extra header data */
-    fseek(in, chunk_start + chunk_size, SEEK_SET);
+    reader.position = chunk_start + chunk_size;
 
-    while (number_of_tracks_read < number_of_tracks) {
-        fread(chunk_id, 1, 4, in);
-        chunk_size = read_uint32(in);
-        chunk_start = ftell(in);
+    /* a truncated file keeps the tracks, and the events of the last track, read before its end */
+    while ((number_of_tracks_read < number_of_tracks) && (reader.position <= size - 8)) {
+        chunk_id = read_bytes(&reader, 4);
+        chunk_size = read_uint32(&reader);
+        chunk_start = reader.position;
 
         if (memcmp(chunk_id, "MTrk", 4) == 0) {
             MidiFileTrack_t track = MidiFile_createTrack(midi_file);
@@ -382,15 +637,18 @@ MidiFile_t MidiFile_load(char* filename)
             unsigned char status, running_status = 0;
             int at_end_of_track = 0;
 
-            while ((ftell(in) < chunk_start + chunk_size) && !at_end_of_track) {
-                tick = read_variable_length_quantity(in) + previous_tick;
+            /* the decoders give zeros past the end of the chunk, and the events they were reading are dropped */
+            reader.end = (chunk_size < size - chunk_start) ? chunk_start + chunk_size : size;
+
+            while ((reader.position < reader.end) && !at_end_of_track) {
+                tick = read_variable_length_quantity(&reader) + previous_tick;
                 previous_tick = tick;
 
-                status = fgetc(in);
+                status = read_byte(&reader);
 
                 if ((status & 0x80) == 0x00) {
                     status = running_status;
-                    fseek(in, -1, SEEK_CUR);
+                    reader.position--;
                 } else {
                     running_status = status;
                 }
@@ -398,77 +656,89 @@ MidiFile_t MidiFile_load(char* filename)
                 switch (status & 0xF0) {
                 case 0x80: {
                     int channel = status & 0x0F;
-                    int note = fgetc(in);
-                    int velocity = fgetc(in);
-                    MidiFileTrack_createNoteOffEvent(track, tick, channel, note, velocity);
+                    int note = read_byte(&reader);
+                    int velocity = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createNoteOffEvent(track, tick, channel, note, velocity);
                     break;
                 }
                 case 0x90: {
                     int channel = status & 0x0F;
-                    int note = fgetc(in);
-                    int velocity = fgetc(in);
-                    MidiFileTrack_createNoteOnEvent(track, tick, channel, note, velocity);
+                    int note = read_byte(&reader);
+                    int velocity = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createNoteOnEvent(track, tick, channel, note, velocity);
                     break;
                 }
                 case 0xA0: {
                     int channel = status & 0x0F;
-                    int note = fgetc(in);
-                    int amount = fgetc(in);
-                    MidiFileTrack_createKeyPressureEvent(track, tick, channel, note, amount);
+                    int note = read_byte(&reader);
+                    int amount = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createKeyPressureEvent(track, tick, channel, note, amount);
                     break;
                 }
                 case 0xB0: {
                     int channel = status & 0x0F;
-                    int number = fgetc(in);
-                    int value = fgetc(in);
-                    MidiFileTrack_createControlChangeEvent(track, tick, channel, number, value);
+                    int number = read_byte(&reader);
+                    int value = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createControlChangeEvent(track, tick, channel, number, value);
                     break;
                 }
                 case 0xC0: {
                     int channel = status & 0x0F;
-                    int number = fgetc(in);
-                    MidiFileTrack_createProgramChangeEvent(track, tick, channel, number);
+                    int number = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createProgramChangeEvent(track, tick, channel, number);
                     break;
                 }
                 case 0xD0: {
                     int channel = status & 0x0F;
-                    int amount = fgetc(in);
-                    MidiFileTrack_createChannelPressureEvent(track, tick, channel, amount);
+                    int amount = read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createChannelPressureEvent(track, tick, channel, amount);
                     break;
                 }
                 case 0xE0: {
                     int channel = status & 0x0F;
-                    int value = fgetc(in);
-                    value = (value << 7) | fgetc(in);
-                    MidiFileTrack_createPitchWheelEvent(track, tick, channel, value);
+                    int value = read_byte(&reader);
+                    value = (value << 7) | read_byte(&reader);
+                    if (reader.position <= reader.end)
+                        MidiFileTrack_createPitchWheelEvent(track, tick, channel, value);
                     break;
                 }
                 case 0xF0: {
                     switch (status) {
                     case 0xF0:
                     case 0xF7: {
-                        int data_length = read_variable_length_quantity(in) + 1;
-                        unsigned char* data_buffer = malloc(data_length);
-                        data_buffer[0] = status;
-                        fread(data_buffer + 1, 1, data_length - 1, in);
-                        MidiFileTrack_createSysexEvent(track, tick, data_length, data_buffer);
-                        free(data_buffer);
+                        unsigned long data_length = read_variable_length_quantity(&reader);
+                        const unsigned char* data = read_bytes(&reader, data_length);
+
+                        /* dropped, like a truncated event, if there is no room to copy it */
+                        if ((data != NULL) && (grow_buffer(&data_buffer, &data_buffer_size, data_length + 1) == 0)) {
+                            data_buffer[0] = status;
+                            memcpy(data_buffer + 1, data, data_length);
+                            MidiFileTrack_createSysexEvent(track, tick, data_length + 1, data_buffer);
+                        }
+
                         break;
                     }
                     case 0xFF: {
-                        int number = fgetc(in);
-                        int data_length = read_variable_length_quantity(in);
-                        unsigned char* data_buffer = malloc(data_length);
-                        fread(data_buffer, 1, data_length, in);
+                        int number = read_byte(&reader);
+                        unsigned long data_length = read_variable_length_quantity(&reader);
+                        const unsigned char* data = read_bytes(&reader, data_length);
+
+                        if (data == NULL)
+                            break;
 
                         if (number == 0x2F) {
                             MidiFileTrack_setEndTick(track, tick);
                             at_end_of_track = 1;
                         } else {
-                            MidiFileTrack_createMetaEvent(track, tick, number, data_length, data_buffer);
+                            MidiFileTrack_createMetaEvent(track, tick, number, data_length, (unsigned char*)(data));
                         }
 
-                        free(data_buffer);
                         break;
                     }
                     }
@@ -478,14 +748,55 @@ MidiFile_t MidiFile_load(char* filename)
                 }
             }
 
+            reader.end = size;
             number_of_tracks_read++;
         }
 
         /* forwards compatibility:  skip over any unrecognized chunks, or extra data at the end of tracks */
-        fseek(in, chunk_start + chunk_size, SEEK_SET);
+        reader.position = chunk_start + chunk_size;
     }
 
-    fclose(in);
+    MidiFile_endBulkInsert(midi_file);
+    free(data_buffer);
+    return midi_file;
+}
+
+MidiFile_t MidiFile_load(char* filename)
+{
+    MidiFile_t midi_file = NULL;
+    struct stat file_status;
+    unsigned char* buffer;
+    long size;
+    int fd;
+
+    if ((filename == NULL) || ((fd = open(filename, O_RDONLY)) < 0))
+        return NULL;
+
+    if (fstat(fd, &file_status) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size = file_status.st_size;
+
+    /* pipes and devices have no size, read them until the end */
+    if (!S_ISREG(file_status.st_mode)) {
+        if ((buffer = read_stream(fd, &size)) != NULL) {
+            midi_file = MidiFile_loadFromBuffer(buffer, size);
+            free(buffer);
+        }
+    }
+
+    /* map large files, read small ones (or any file that cannot be mapped) at once */
+    else if ((size >= MMAP_THRESHOLD) && ((buffer = (unsigned char*)(mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0))) != MAP_FAILED)) {
+        midi_file = MidiFile_loadFromBuffer(buffer, size);
+        munmap(buffer, size);
+    } else if ((buffer = (unsigned char*)(malloc(size > 0 ? size : 1))) != NULL) {
+        midi_file = MidiFile_loadFromBuffer(buffer, read_file(fd, buffer, size));
+        free(buffer);
+    }
+
+    close(fd);
     return midi_file;
 }
 
@@ -628,6 +939,10 @@ int MidiFile_save(MidiFile_t midi_file, const char* filename)
 MidiFile_t MidiFile_new(int file_format, MidiFileDivisionType_t division_type, int resolution)
 {
     MidiFile_t midi_file = (MidiFile_t)(malloc(sizeof(struct MidiFile)));
+
+    if (midi_file == NULL)
+        return NULL;
+
     midi_file->file_format = file_format;
     midi_file->division_type = division_type;
     midi_file->resolution = resolution;
@@ -636,20 +951,26 @@ MidiFile_t MidiFile_new(int file_format, MidiFileDivisionType_t division_type, i
     midi_file->last_track = NULL;
     midi_file->first_event = NULL;
     midi_file->last_event = NULL;
+    midi_file->bulk_inserting = 0;
+    midi_file->arena_blocks = NULL;
+    midi_file->arena_cursor = NULL;
+    midi_file->arena_bytes_left = 0;
+    midi_file->arena_next_block_size = ARENA_FIRST_BLOCK_SIZE;
+    midi_file->free_tracks = NULL;
+    midi_file->free_events = NULL;
     return midi_file;
 }
 
 int MidiFile_free(MidiFile_t midi_file)
 {
-    MidiFileTrack_t track, next_track;
+    struct MidiFileArenaBlock *block, *next_block;
 
     if (midi_file == NULL)
         return -1;
 
-    for (track = midi_file->first_track; track != NULL; track = next_track) {
-        next_track = track->next_track;
-        free_events_in_track(track);
-        free(track);
+    for (block = midi_file->arena_blocks; block != NULL; block = next_block) {
+        next_block = block->next_block;
+        free(block);
     }
 
     free(midi_file);
@@ -708,7 +1029,9 @@ MidiFileTrack_t MidiFile_createTrack(MidiFile_t midi_file)
     if (midi_file == NULL)
         return NULL;
 
-    new_track = (MidiFileTrack_t)(malloc(sizeof(struct MidiFileTrack)));
+    if ((new_track = allocate_track(midi_file)) == NULL)
+        return NULL;
+
     new_track->midi_file = midi_file;
     new_track->number = midi_file->number_of_tracks;
     new_track->end_tick = 0;
@@ -771,6 +1094,23 @@ MidiFileTrack_t MidiFile_getLastTrack(MidiFile_t midi_file)
     return midi_file->last_track;
 }
 
+int MidiFile_beginBulkInsert(MidiFile_t midi_file)
+{
+    if ((midi_file == NULL) || midi_file->bulk_inserting)
+        return -1;
+    midi_file->bulk_inserting = 1;
+    return 0;
+}
+
+int MidiFile_endBulkInsert(MidiFile_t midi_file)
+{
+    if ((midi_file == NULL) || !midi_file->bulk_inserting)
+        return -1;
+    midi_file->bulk_inserting = 0;
+    link_events_in_file(midi_file);
+    return 0;
+}
+
 MidiFileEvent_t MidiFile_getFirstEvent(MidiFile_t midi_file)
 {
     if (midi_file == NULL)
@@ -959,8 +1299,9 @@ int MidiFileTrack_delete(MidiFileTrack_t track)
         track->next_track->previous_track = track->previous_track;
     }
 
-    free_events_in_track(track);
-    free(track);
+    release_events_in_track(track);
+    track->next_track = track->midi_file->free_tracks;
+    track->midi_file->free_tracks = track;
     return 0;
 }
 
@@ -1000,7 +1341,9 @@ MidiFileTrack_t MidiFileTrack_createTrackBefore(MidiFileTrack_t track)
     if (track == NULL)
         return NULL;
 
-    new_track = (MidiFileTrack_t)(malloc(sizeof(struct MidiFileTrack)));
+    if ((new_track = allocate_track(track->midi_file)) == NULL)
+        return NULL;
+
     new_track->midi_file = track->midi_file;
     new_track->number = track->number;
     new_track->end_tick = 0;
@@ -1045,7 +1388,9 @@ MidiFileEvent_t MidiFileTrack_createNoteOffEvent(MidiFileTrack_t track, long tic
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_NOTE_OFF;
@@ -1065,7 +1410,9 @@ MidiFileEvent_t MidiFileTrack_createNoteOnEvent(MidiFileTrack_t track, long tick
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_NOTE_ON;
@@ -1085,7 +1432,9 @@ MidiFileEvent_t MidiFileTrack_createKeyPressureEvent(MidiFileTrack_t track, long
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_KEY_PRESSURE;
@@ -1105,7 +1454,9 @@ MidiFileEvent_t MidiFileTrack_createControlChangeEvent(MidiFileTrack_t track, lo
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_CONTROL_CHANGE;
@@ -1125,7 +1476,9 @@ MidiFileEvent_t MidiFileTrack_createProgramChangeEvent(MidiFileTrack_t track, lo
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_PROGRAM_CHANGE;
@@ -1144,7 +1497,9 @@ MidiFileEvent_t MidiFileTrack_createChannelPressureEvent(MidiFileTrack_t track,
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_CHANNEL_PRESSURE;
@@ -1163,7 +1518,9 @@ MidiFileEvent_t MidiFileTrack_createPitchWheelEvent(MidiFileTrack_t track, long
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_PITCH_WHEEL;
@@ -1178,17 +1535,19 @@ MidiFileEvent_t MidiFileTrack_createPitchWheelEvent(MidiFileTrack_t track, long
 MidiFileEvent_t MidiFileTrack_createSysexEvent(MidiFileTrack_t track, long tick, int data_length, unsigned char* data_buffer)
 {
     MidiFileEvent_t new_event;
+    unsigned char* data_copy;
 
     if ((track == NULL) || (data_length < 1) || (data_buffer == NULL))
-        NULL;
+        return NULL;
+
+    if (((data_copy = arena_copy_data(track->midi_file, data_length, data_buffer)) == NULL) || ((new_event = allocate_event(track)) == NULL))
+        return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_SYSEX;
     new_event->u.sysex.data_length = data_length;
-    new_event->u.sysex.data_buffer = malloc(data_length);
-    memcpy(new_event->u.sysex.data_buffer, data_buffer, data_length);
+    new_event->u.sysex.data_buffer = data_copy;
     new_event->should_be_visited = 0;
     add_event(new_event);
 
@@ -1198,18 +1557,20 @@ MidiFileEvent_t MidiFileTrack_createSysexEvent(MidiFileTrack_t track, long tick,
 MidiFileEvent_t MidiFileTrack_createMetaEvent(MidiFileTrack_t track, long tick, int number, int data_length, unsigned char* data_buffer)
 {
     MidiFileEvent_t new_event;
+    unsigned char* data_copy;
 
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if (((data_copy = arena_copy_data(track->midi_file, data_length, data_buffer)) == NULL) || ((new_event = allocate_event(track)) == NULL))
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     new_event->type = MIDI_FILE_EVENT_TYPE_META;
     new_event->u.meta.number = number;
     new_event->u.meta.data_length = data_length;
-    new_event->u.meta.data_buffer = malloc(data_length);
-    memcpy(new_event->u.meta.data_buffer, data_buffer, data_length);
+    new_event->u.meta.data_buffer = data_copy;
     new_event->should_be_visited = 0;
     add_event(new_event);
 
@@ -1240,7 +1601,9 @@ MidiFileEvent_t MidiFileTrack_createVoiceEvent(MidiFileTrack_t track, long tick,
     if (track == NULL)
         return NULL;
 
-    new_event = (MidiFileEvent_t)(malloc(sizeof(struct MidiFileEvent)));
+    if ((new_event = allocate_event(track)) == NULL)
+        return NULL;
+
     new_event->track = track;
     new_event->tick = tick;
     MidiFileVoiceEvent_setData(new_event, data);
@@ -1291,19 +1654,7 @@ int MidiFileEvent_delete(MidiFileEvent_t event)
     if (event == NULL)
         return -1;
     remove_event(event);
-
-    switch (event->type) {
-    case MIDI_FILE_EVENT_TYPE_SYSEX: {
-        free(event->u.sysex.data_buffer);
-        break;
-    }
-    case MIDI_FILE_EVENT_TYPE_META: {
-        free(event->u.meta.data_buffer);
-        break;
-    }
-    }
-
-    free(event);
+    release_event(event);
     return 0;
 }
 
@@ -1697,10 +2048,14 @@ int MidiFileSysexEvent_setData(MidiFileEvent_t event, int data_length, unsigned
 {
     if ((event == NULL) || (event->type != MIDI_FILE_EVENT_TYPE_SYSEX) || (data_length < 1) || (data_buffer == NULL))
         return -1;
-    free(event->u.sysex.data_buffer);
+    /* reuse the buffer when the data fits, the arena never gives memory back */
+    if (data_length <= event->u.sysex.data_length)
+        memcpy(event->u.sysex.data_buffer, data_buffer, data_length);
+    else if ((data_buffer = arena_copy_data(event->track->midi_file, data_length, data_buffer)) != NULL)
+        event->u.sysex.data_buffer = data_buffer;
+    else
+        return -1;
     event->u.sysex.data_length = data_length;
-    event->u.sysex.data_buffer = malloc(data_length);
-    memcpy(event->u.sysex.data_buffer, data_buffer, data_length);
     return 0;
 }
 
@@ -1737,10 +2092,14 @@ int MidiFileMetaEvent_setData(MidiFileEvent_t event, int data_length, unsigned c
 {
     if ((event == NULL) || (event->type != MIDI_FILE_EVENT_TYPE_META) || (data_length < 1) || (data_buffer == NULL))
         return -1;
-    free(event->u.meta.data_buffer);
+    /* reuse the buffer when the data fits, the arena never gives memory back */
+    if (data_length <= event->u.meta.data_length)
+        memcpy(event->u.meta.data_buffer, data_buffer, data_length);
+    else if ((data_buffer = arena_copy_data(event->track->midi_file, data_length, data_buffer)) != NULL)
+        event->u.meta.data_buffer = data_buffer;
+    else
+        return -1;
     event->u.meta.data_length = data_length;
-    event->u.meta.data_buffer = malloc(data_length);
-    memcpy(event->u.meta.data_buffer, data_buffer, data_length);
     return 0;
 }
 
@@ -23,7 +23,10 @@
  *
  * 4.  Any data passed into these functions is memory-managed by the caller.
  *     Any data returned from these functions is memory-managed by the API.
- *     Don't forget to call MidiFile_free().
+ *     Don't forget to call MidiFile_free().  Tracks, events and their data
+ *     live in an arena owned by their MidiFile_t, released all at once by
+ *     MidiFile_free(); deleted tracks and events are reused by later ones.
+ *     Pointers into a file's data are only valid until it is freed.
  *
  * 5.  This API is not thread-safe.
  *
@@ -83,6 +86,7 @@ typedef enum {
 } MidiFileEventType_t;
 
 MidiFile_t MidiFile_load(char* filename);
+MidiFile_t MidiFile_loadFromBuffer(const unsigned char* buffer, long size); /* a whole file already in memory */
 int MidiFile_save(MidiFile_t midi_file, const char* filename);
 
 MidiFile_t MidiFile_new(int file_format, MidiFileDivisionType_t division_type, int resolution);
@@ -98,6 +102,8 @@ int MidiFile_getNumberOfTracks(MidiFile_t midi_file);
 MidiFileTrack_t MidiFile_getTrackByNumber(MidiFile_t midi_file, int number, int create);
 MidiFileTrack_t MidiFile_getFirstTrack(MidiFile_t midi_file);
 MidiFileTrack_t MidiFile_getLastTrack(MidiFile_t midi_file);
+int MidiFile_beginBulkInsert(MidiFile_t midi_file); /* until MidiFile_endBulkInsert(), new events are only sorted within their track, and events cannot be navigated or visited in file order */
+int MidiFile_endBulkInsert(MidiFile_t midi_file); /* merges the tracks in file order at once:  events of the same tick are sorted by track */
 MidiFileEvent_t MidiFile_getFirstEvent(MidiFile_t midi_file);
 MidiFileEvent_t MidiFile_getLastEvent(MidiFile_t midi_file);
 int MidiFile_visitEvents(MidiFile_t midi_file, MidiFileEventVisitorCallback_t visitor_callback, void* user_data);
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "midi_render.h"
+#include "midifile.h"
+#include "sound_writer.h"
+
+#define SAMPLE_RATE 44100
+#define VOICES 32
+
+static void
+usage(char* progname)
+{
+    fprintf(stderr, "Usage: %s [-v voices] <input> <output>.\n", progname);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+    int voices = VOICES;
+    for (int option; (option = getopt(argc, argv, "v:")) != -1;)
+        if (option != 'v' || (voices = atoi(optarg)) <= 0)
+            usage(argv[0]);
+
+    if (argc - optind != 2)
+        usage(argv[0]);
+
+    MidiFile_t md = MidiFile_load(argv[optind]);
+    if (md == NULL) {
+        fprintf(stderr, "Could not load %s.\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    sound_writer* const writer = sound_writer_open(argv[optind + 1], 1, SAMPLE_RATE);
+    if (writer == NULL) {
+        fprintf(stderr, "Could not open %s.\n", argv[optind + 1]);
+        MidiFile_free(md);
+        return EXIT_FAILURE;
+    }
+
+    const long samples = midi_render(md, writer, SAMPLE_RATE, voices);
+    const int closed = sound_writer_close(writer);
+    MidiFile_free(md);
+    if (samples < 0 || closed < 0) {
+        fprintf(stderr, "Could not render %s.\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%s: %.1f s.\n", argv[optind + 1], (double)samples / SAMPLE_RATE);
+    return EXIT_SUCCESS;
+}
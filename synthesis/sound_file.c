@@ -2,25 +2,22 @@
 
 #include <stdlib.h>
 
-FILE* sound_file_open_write(const char* const raw_filename)
+sound_writer* sound_file_open_write(const char* const out_filename, const int num_channels, const int sample_rate)
 {
-    return fopen(raw_filename, "wb");
+    sound_writer* const out_file = sound_writer_open(out_filename, num_channels, sample_rate);
+    if (out_file == NULL)
+        exit(EXIT_FAILURE);
+    return out_file;
 }
 
-void sound_file_write(FILE* const raw_file, const double* const frame_buffer, const int frame_size)
+void sound_file_write(sound_writer* const out_file, const double* const frame_buffer, const int frame_size)
 {
-    int i;
-    short tmp[frame_size];
-    for (i = 0; i < frame_size; i++)
-        tmp[i] = (short)(frame_buffer[i] * 32768);
-    fwrite(tmp, sizeof(short), frame_size, raw_file);
+    if (sound_writer_write(out_file, frame_buffer, frame_size) < frame_size)
+        exit(EXIT_FAILURE);
 }
 
-void sound_file_close_write(FILE* const raw_file, const char* const raw_filename, const char* const out_filename, const int num_channels, const int sample_rate)
+void sound_file_close_write(sound_writer* const out_file)
 {
-    fclose(raw_file);
-
-    char cmd[256];
-    snprintf(cmd, 256, "sox -c %d -r %d -e signed-integer -b 16 %s %s", num_channels, sample_rate, raw_filename, out_filename);
-    system(cmd);
+    if (sound_writer_close(out_file) != 0)
+        exit(EXIT_FAILURE);
 }
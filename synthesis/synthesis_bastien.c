@@ -1,18 +1,48 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "fm.h"
 #include "sinusoid.h"
 #include "sound_file.h"
+#include "wavetable.h"
 
 #define DURATION 60
 #define CHANNELS 1
 #define SAMPLE_RATE 44100
 #define FRAME_SIZE 1024
+#define NOTE_FRAMES 8 // ~190 ms per note.
+#define CHORD_FRAMES 86 // ~2 s per chord.
+#define CHORD_NOTES 6
+#define VOICES 24
 
-static const char* const RAW_FILENAME = "outputs/raw_bastien.raw";
 static const char* const OUT_FILENAME = "outputs/out_bastien.wav";
 
+// A minor arpeggio over four octaves, to go through the wavetable octaves.
+static const double ARPEGGIO[] = { 55., 65.406, 82.407, 110., 130.813, 164.814, 220., 261.626, 329.628, 440., 523.251, 659.255, 880. };
+
+// Am, F, C, G, voiced over three octaves.
+static const double CHORDS[][CHORD_NOTES] = {
+    { 110., 164.814, 220., 261.626, 329.628, 440. },
+    { 87.307, 174.614, 220., 261.626, 349.228, 440. },
+    { 130.813, 195.998, 261.626, 329.628, 391.995, 523.251 },
+    { 97.999, 195.998, 246.942, 293.665, 391.995, 493.883 },
+};
+
+// Two stacks (1 > 0, 3 > 2), the second one detuned an octave up, with slow envelopes.
+static const fm_patch PAD = {
+    .algorithm = 4,
+    .feedback = .3,
+    .operators = {
+        { .ratio = 1., .level = .08, .attack = .4, .decay = 1., .sustain = .8, .release = 1.5 },
+        { .ratio = 1., .level = 1.2, .attack = .6, .decay = 1.5, .sustain = .5, .release = 1.5 },
+        { .ratio = 2.003, .level = .04, .attack = .4, .decay = 1., .sustain = .8, .release = 1.5 },
+        { .ratio = 1., .level = .8, .attack = .8, .decay = 1.5, .sustain = .4, .release = 1.5 },
+    },
+};
+
 // static double
 // additive_value(const int frame, const int sample)
 // {
@@ -39,43 +69,78 @@ static const char* const OUT_FILENAME = "outputs/out_bastien.wav";
 //     return a_value;
 // }
 
-static double
-fm_value(const int frame, const int sample)
+static void
+fm_frame(fm_engine* const engine, double* const frame_buffer, const int frame)
 {
-    const double constant = 0;
+    static int voices[CHORD_NOTES];
+    if (frame % CHORD_FRAMES == 0) {
+        const double* const chord = CHORDS[frame / CHORD_FRAMES % (sizeof(CHORDS) / sizeof(CHORDS[0]))];
+        for (int note = 0; note < CHORD_NOTES && frame > 0; note++)
+            fm_engine_note_off(engine, voices[note]);
+        for (int note = 0; note < CHORD_NOTES; note++)
+            voices[note] = fm_engine_note_on(engine, chord[note], 1.);
+    }
 
-    // sinusoid b = create_sinusoid(M_PI, 220.);
-    sinusoid b = create_sinusoid(M_PI, 123.);
-    double b_value = get_sinusoid_value(b, frame, FRAME_SIZE, sample, SAMPLE_RATE);
+    fm_engine_render(engine, frame_buffer, FRAME_SIZE);
+}
 
-    sinusoid a = create_sinusoid(.5, constant + b_value);
-    double a_value = get_sinusoid_value(a, frame, FRAME_SIZE, sample, SAMPLE_RATE);
+static void
+wavetable_frame(wavetable_voice* const voice, double* const frame_buffer, const int frame)
+{
+    const int notes = sizeof(ARPEGGIO) / sizeof(ARPEGGIO[0]);
+    wavetable_voice_render(voice, frame_buffer, FRAME_SIZE, ARPEGGIO[frame / NOTE_FRAMES % notes], .5);
+}
 
-    return a_value;
+static void
+usage(const char* const program)
+{
+    printf("Usage: %s [-w saw|square] [output]\n.", program);
+    exit(EXIT_FAILURE);
 }
 
 int main(int argc, char** argv)
 {
-    if (argc != 1) {
-        printf("Usage: %s\n.", argv[0]);
-        exit(EXIT_FAILURE);
-    }
-
-    FILE* const sound_file = sound_file_open_write(RAW_FILENAME);
+    const char* waveform = NULL;
+    for (int option; (option = getopt(argc, argv, "w:")) != -1;)
+        if (option == 'w' && (strcmp(optarg, "saw") == 0 || strcmp(optarg, "square") == 0))
+            waveform = optarg;
+        else
+            usage(argv[0]);
+
+    if (argc - optind > 1)
+        usage(argv[0]);
+
+    wavetable* table = NULL;
+    fm_engine* engine = NULL;
+    if (waveform != NULL)
+        table = strcmp(waveform, "saw") == 0 ? wavetable_create_saw(SAMPLE_RATE) : wavetable_create_square(SAMPLE_RATE);
+    else
+        engine = fm_engine_create(&PAD, VOICES, SAMPLE_RATE);
+    if (table == NULL && engine == NULL)
+        return EXIT_FAILURE;
+
+    sound_writer* const sound_file = sound_file_open_write(optind < argc ? argv[optind] : OUT_FILENAME, CHANNELS, SAMPLE_RATE);
+    wavetable_voice voice = wavetable_voice_create(table);
 
     int frame = 0;
     double frame_buffer[FRAME_SIZE];
     while (frame * FRAME_SIZE < DURATION * SAMPLE_RATE) {
-        for (int sample = 0; sample < FRAME_SIZE; sample++) {
-            // frame_buffer[sample] = additive_value(frame, sample);
-            // frame_buffer[sample] = am_value(frame, sample);
-            frame_buffer[sample] = fm_value(frame, sample);
+        if (table != NULL)
+            wavetable_frame(&voice, frame_buffer, frame);
+        else {
+            // for (int sample = 0; sample < FRAME_SIZE; sample++) {
+            //     frame_buffer[sample] = additive_value(frame, sample);
+            //     frame_buffer[sample] = am_value(frame, sample);
+            // }
+            fm_frame(engine, frame_buffer, frame);
         }
 
         sound_file_write(sound_file, frame_buffer, FRAME_SIZE);
         frame++;
     }
 
-    sound_file_close_write(sound_file, RAW_FILENAME, OUT_FILENAME, CHANNELS, SAMPLE_RATE);
+    wavetable_destroy(table);
+    fm_engine_destroy(engine);
+    sound_file_close_write(sound_file);
     return EXIT_SUCCESS;
 }
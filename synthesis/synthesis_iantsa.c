@@ -9,17 +9,16 @@
 #define N DUREE* FE // 1024
 // #define DUREE_TRAME N / FE
 
-static const char* const RAW_FILENAME = "outputs/raw_iantsa.raw";
 static const char* const OUT_FILENAME = "outputs/out_iantsa.wav";
 
 int main(int argc, char** argv)
 {
-    if (argc != 1) {
-        printf("Usage: %s\n.", argv[0]);
+    if (argc > 2) {
+        printf("Usage: %s [output]\n.", argv[0]);
         exit(EXIT_FAILURE);
     }
 
-    FILE* const sound_file = sound_file_open_write(RAW_FILENAME);
+    sound_writer* const sound_file = sound_file_open_write(argc == 2 ? argv[1] : OUT_FILENAME, 1, FE);
     double s[N];
 
     double amp1 = 0.6;
@@ -67,6 +66,6 @@ int main(int argc, char** argv)
     // nb_frame++;
     //}
 
-    sound_file_close_write(sound_file, RAW_FILENAME, OUT_FILENAME, 1, FE);
+    sound_file_close_write(sound_file);
     return EXIT_SUCCESS;
 }